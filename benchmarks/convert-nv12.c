@@ -0,0 +1,273 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Standalone check and benchmark of the NV12 conversion kernels of
+ * gst-libs/mfx/gstmfxconvert_priv.h.
+ *
+ * Each set of kernels that gstmfxconvert.c selects at runtime is first
+ * compared with the scalar kernels for every width up to 300 pixels, which
+ * covers the vector loops and their scalar tails, including odd widths.
+ * The program fails if any output differs. The AVX2 set splits packed
+ * 4:2:2 input with the SSE2 kernel, as gstmfxconvert.c does.
+ *
+ * The conversion of 1080p and 4K I420 and YUY2 frames into NV12 is then
+ * timed for each kernel, next to a plain copy of the frame, which is what
+ * the upload did before the conversion was fused into it. The copy does
+ * not include the VPP pass that converted the copy afterwards.
+ *
+ *   gcc -O2 -I. $(pkg-config --cflags glib-2.0) \
+ *       -o convert-nv12 benchmarks/convert-nv12.c
+ *   ./convert-nv12 [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gst-libs/mfx/gstmfxconvert_priv.h"
+
+#define MAX_CHECK_WIDTH 300
+#define PITCH_ALIGN 64
+
+typedef struct
+{
+  const char *name;
+  GstMfxInterleaveFunc interleave;
+  GstMfxSplitPackedFunc split;
+  gboolean supported;
+} Kernels;
+
+static Kernels kernels[] = {
+  {"c", interleave_uv_c, split_packed_c, TRUE},
+#ifdef USE_X86_SIMD
+  {"sse2", interleave_uv_sse2, split_packed_sse2, FALSE},
+  {"avx2", interleave_uv_avx2, split_packed_sse2, FALSE},
+#endif
+};
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+fill_random (guint8 * data, gsize size)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    data[i] = rand () & 0xff;
+}
+
+static guint
+round_up (guint value, guint align)
+{
+  return (value + align - 1) / align * align;
+}
+
+/* Compares the output of @k with the scalar kernels, guard bytes included
+ * to catch writes past the end of a row */
+static gboolean
+check_kernels (const Kernels * k)
+{
+  const gsize size = 4 * MAX_CHECK_WIDTH + 64;
+  guint8 *src0 = malloc (size), *src1 = malloc (size);
+  guint8 *ref[3], *out[3];
+  guint width, luma, i;
+  gboolean ok = TRUE;
+
+  for (i = 0; i < 3; i++) {
+    ref[i] = malloc (size);
+    out[i] = malloc (size);
+  }
+  fill_random (src0, size);
+  fill_random (src1, size);
+
+  for (width = 1; width <= MAX_CHECK_WIDTH && ok; width++) {
+    for (i = 0; i < 3; i++) {
+      memset (ref[i], 0xa5, size);
+      memset (out[i], 0xa5, size);
+    }
+
+    interleave_uv_c (ref[0], src0, src1, width);
+    k->interleave (out[0], src0, src1, width);
+    if (memcmp (ref[0], out[0], size)) {
+      printf ("%s: interleave_uv differs at width %u\n", k->name, width);
+      ok = FALSE;
+    }
+
+    for (luma = 0; luma < 2; luma++) {
+      split_packed_c (ref[0], ref[1], ref[2], src0, src1, width, luma);
+      k->split (out[0], out[1], out[2], src0, src1, width, luma);
+      for (i = 0; i < 3; i++) {
+        if (memcmp (ref[i], out[i], size)) {
+          printf ("%s: split_packed (%s) differs at width %u\n", k->name,
+              luma ? "UYVY" : "YUY2", width);
+          ok = FALSE;
+          break;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < 3; i++) {
+    free (ref[i]);
+    free (out[i]);
+  }
+  free (src0);
+  free (src1);
+  return ok;
+}
+
+static void
+convert_i420 (const Kernels * k, guint8 * dst, guint dst_pitch,
+    const guint8 * src, guint width, guint height)
+{
+  const guint8 *const src_u = src + width * height;
+  const guint8 *const src_v = src_u + (width / 2) * (height / 2);
+  guint8 *const dst_uv = dst + dst_pitch * height;
+  guint i;
+
+  for (i = 0; i < height; i++)
+    memcpy (dst + i * dst_pitch, src + i * width, width);
+  for (i = 0; i < height / 2; i++)
+    k->interleave (dst_uv + i * dst_pitch, src_u + i * (width / 2),
+        src_v + i * (width / 2), width / 2);
+}
+
+static void
+convert_yuy2 (const Kernels * k, guint8 * dst, guint dst_pitch,
+    const guint8 * src, guint width, guint height)
+{
+  guint8 *const dst_uv = dst + dst_pitch * height;
+  guint i;
+
+  for (i = 0; i < height; i += 2)
+    k->split (dst + i * dst_pitch, dst + (i + 1) * dst_pitch,
+        dst_uv + (i / 2) * dst_pitch, src + i * 2 * width,
+        src + (i + 1) * 2 * width, width, 0);
+}
+
+static void
+copy_frame (guint8 * dst, guint dst_pitch, const guint8 * src,
+    guint row_size, guint rows)
+{
+  guint i;
+
+  for (i = 0; i < rows; i++)
+    memcpy (dst + i * dst_pitch, src + i * row_size, row_size);
+}
+
+static void
+run_size (guint width, guint height, guint iterations)
+{
+  const gsize i420_size = (gsize) width * height * 3 / 2;
+  const gsize yuy2_size = (gsize) width * height * 2;
+  const guint pitch = round_up (2 * width, PITCH_ALIGN);
+  guint8 *i420 = malloc (i420_size), *yuy2 = malloc (yuy2_size);
+  guint8 *dst = malloc ((gsize) pitch * height * 2);
+  double start, ms;
+  guint i, n;
+
+  fill_random (i420, i420_size);
+  fill_random (yuy2, yuy2_size);
+  memset (dst, 0, (gsize) pitch * height * 2);
+
+  /* The copy keeps the layout of the source, i.e. the row size of the
+   * first plane for all rows of a planar frame */
+  start = now ();
+  for (n = 0; n < iterations; n++)
+    copy_frame (dst, round_up (width, PITCH_ALIGN), i420, width,
+        height * 3 / 2);
+  ms = (now () - start) * 1e3 / iterations;
+  printf ("%4ux%-4u  I420  copy        %6.2f ms  %5.2f GB/s\n", width,
+      height, ms, i420_size / ms / 1e6);
+
+  for (i = 0; i < G_N_ELEMENTS (kernels); i++) {
+    if (!kernels[i].supported)
+      continue;
+    start = now ();
+    for (n = 0; n < iterations; n++)
+      convert_i420 (&kernels[i], dst, round_up (width, PITCH_ALIGN), i420,
+          width, height);
+    ms = (now () - start) * 1e3 / iterations;
+    printf ("%4ux%-4u  I420  nv12 %-6s %6.2f ms  %5.2f GB/s\n", width,
+        height, kernels[i].name, ms, i420_size / ms / 1e6);
+  }
+
+  start = now ();
+  for (n = 0; n < iterations; n++)
+    copy_frame (dst, pitch, yuy2, 2 * width, height);
+  ms = (now () - start) * 1e3 / iterations;
+  printf ("%4ux%-4u  YUY2  copy        %6.2f ms  %5.2f GB/s\n", width,
+      height, ms, yuy2_size / ms / 1e6);
+
+  for (i = 0; i < G_N_ELEMENTS (kernels); i++) {
+    if (!kernels[i].supported)
+      continue;
+    start = now ();
+    for (n = 0; n < iterations; n++)
+      convert_yuy2 (&kernels[i], dst, round_up (width, PITCH_ALIGN), yuy2,
+          width, height);
+    ms = (now () - start) * 1e3 / iterations;
+    printf ("%4ux%-4u  YUY2  nv12 %-6s %6.2f ms  %5.2f GB/s\n", width,
+        height, kernels[i].name, ms, yuy2_size / ms / 1e6);
+  }
+
+  free (i420);
+  free (yuy2);
+  free (dst);
+}
+
+int
+main (int argc, char *argv[])
+{
+  const guint iterations = argc > 1 ? atoi (argv[1]) : 100;
+  gboolean ok = TRUE;
+  guint i;
+
+#ifdef USE_X86_SIMD
+  __builtin_cpu_init ();
+  kernels[1].supported = __builtin_cpu_supports ("sse2");
+  kernels[2].supported = __builtin_cpu_supports ("avx2");
+#endif
+
+  for (i = 1; i < G_N_ELEMENTS (kernels); i++) {
+    if (!kernels[i].supported) {
+      printf ("%s: not supported by this CPU\n", kernels[i].name);
+      continue;
+    }
+    if (check_kernels (&kernels[i]))
+      printf ("%s: matches the scalar kernels\n", kernels[i].name);
+    else
+      ok = FALSE;
+  }
+  if (!ok)
+    return 1;
+
+  printf ("\nsize       input  path        time/frame  source rate\n");
+  run_size (1920, 1080, iterations);
+  run_size (3840, 2160, iterations);
+  return 0;
+}
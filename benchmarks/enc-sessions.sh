@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+#  Copyright (C) 2017 Intel Corporation
+#
+#  This library is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU Lesser General Public License
+#  as published by the Free Software Foundation; either version 2.1
+#  of the License, or (at your option) any later version.
+#
+#  This library is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#  Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public
+#  License along with this library; if not, write to the Free
+#  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#  Boston, MA 02110-1301 USA
+#
+# Throughput of mfxh264enc and mfxh265enc for 1, 2 and 4 sessions
+# encoding chunks of a 1080p NV12 stream in system memory, and the
+# speedup of each run over the single session one. The frames are
+# generated up front into a file, so that the source does not limit the
+# throughput. The sessions only help when the implementation in use
+# leaves the hardware, or the CPU for the software one, partly idle with
+# a single session; the implementation is printed for each run.
+#
+#   ./benchmarks/enc-sessions.sh [frames] [chunk-size]
+
+FRAMES=${1:-600}
+CHUNK_SIZE=${2:-30}
+INPUT=${TMPDIR:-/tmp}/enc-sessions-$$.nv12
+
+trap 'rm -f "$INPUT"' EXIT
+
+gst-launch-1.0 -q videotestsrc num-buffers="$FRAMES" pattern=ball ! \
+    video/x-raw,format=NV12,width=1920,height=1080,framerate=30/1 ! \
+    filesink location="$INPUT" || exit 1
+
+run ()
+{
+  element=$1
+  sessions=$2
+
+  start=$(date +%s.%N)
+  impl=$(GST_DEBUG=mfx*:4 gst-launch-1.0 -q \
+      filesrc location="$INPUT" blocksize=3110400 ! \
+      rawvideoparse format=nv12 width=1920 height=1080 framerate=30/1 ! \
+      "$element" sessions="$sessions" chunk-size="$CHUNK_SIZE" ! \
+      fakesink sync=false 2>&1 | \
+      sed -n 's/.*MFX session using \(.*\) implementation.*/\1/p' | \
+      head -n 1)
+  end=$(date +%s.%N)
+
+  echo "$element $sessions $start $end ${impl:-unknown}" | \
+      awk -v frames="$FRAMES" -v base="${BASE:-0}" '{
+        impl = $5
+        for (i = 6; i <= NF; i++)
+          impl = impl " " $i
+        fps = frames / ($4 - $3)
+        speedup = base > 0 ? fps / base : 1
+        printf "%-11s  %8d  %8.1f fps  %6.2fx  (%s)\n", $1, $2, fps,
+            speedup, impl
+      }'
+}
+
+echo "element      sessions  throughput    speedup"
+for element in mfxh264enc mfxh265enc; do
+  BASE=
+  for sessions in 1 2 4; do
+    line=$(run "$element" "$sessions")
+    echo "$line"
+    if [ -z "$BASE" ]; then
+      BASE=$(echo "$line" | awk '{ print $3 }')
+    fi
+  done
+done
@@ -0,0 +1,153 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Standalone benchmark of the system memory surface allocation strategies
+ * of gst_mfx_surface_alloc_data(): plain malloc(), posix_memalign() with
+ * several alignments, and mmap() with huge pages (MAP_HUGETLB, falling back
+ * to transparent huge pages). For each strategy it measures the cost of
+ * allocating and first touching a set of 1080p NV12 surfaces, then the
+ * throughput of copying frames into them, as a decoder or upload would.
+ *
+ *   gcc -O2 -o surface-alloc benchmarks/surface-alloc.c
+ *   ./surface-alloc [num-surfaces] [iterations]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define WIDTH 1920
+#define HEIGHT 1088
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+enum { MODE_MALLOC, MODE_ALIGN, MODE_HUGETLB, MODE_THP };
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+alloc_frame (int mode, size_t alignment, size_t * alloc_size)
+{
+  size_t size = (FRAME_SIZE + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  void *data = NULL;
+
+  *alloc_size = FRAME_SIZE;
+  switch (mode) {
+    case MODE_MALLOC:
+      return malloc (FRAME_SIZE);
+    case MODE_ALIGN:
+      return posix_memalign (&data, alignment, FRAME_SIZE) ? NULL : data;
+    case MODE_HUGETLB:
+#ifdef MAP_HUGETLB
+      data = mmap (NULL, size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+      *alloc_size = size;
+      return data == MAP_FAILED ? NULL : data;
+    case MODE_THP:
+      data = mmap (NULL, size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+      madvise (data, size, MADV_HUGEPAGE);
+#endif
+      *alloc_size = size;
+      return data;
+  }
+  return NULL;
+}
+
+static void
+free_frame (int mode, void *data, size_t alloc_size)
+{
+  if (mode == MODE_HUGETLB || mode == MODE_THP)
+    munmap (data, alloc_size);
+  else
+    free (data);
+}
+
+static void
+run (const char *name, int mode, size_t alignment, int num_surfaces,
+    int iterations, const unsigned char *src)
+{
+  void **frames = calloc (num_surfaces, sizeof (void *));
+  size_t alloc_size = 0;
+  double t0, t1, t2;
+  int i, n;
+
+  t0 = now ();
+  for (i = 0; i < num_surfaces; i++) {
+    frames[i] = alloc_frame (mode, alignment, &alloc_size);
+    if (!frames[i]) {
+      printf ("%-18s unavailable\n", name);
+      while (i--)
+        free_frame (mode, frames[i], alloc_size);
+      free (frames);
+      return;
+    }
+    memset (frames[i], 0, FRAME_SIZE);
+  }
+  t1 = now ();
+
+  for (n = 0; n < iterations; n++)
+    for (i = 0; i < num_surfaces; i++)
+      memcpy (frames[i], src, FRAME_SIZE);
+  t2 = now ();
+
+  printf ("%-18s alloc+touch %7.3f ms/surface   copy %7.2f GB/s\n", name,
+      (t1 - t0) * 1e3 / num_surfaces,
+      (double) FRAME_SIZE * num_surfaces * iterations / (t2 - t1) / 1e9);
+
+  for (i = 0; i < num_surfaces; i++)
+    free_frame (mode, frames[i], alloc_size);
+  free (frames);
+}
+
+int
+main (int argc, char **argv)
+{
+  int num_surfaces = argc > 1 ? atoi (argv[1]) : 16;
+  int iterations = argc > 2 ? atoi (argv[2]) : 50;
+  unsigned char *src = malloc (FRAME_SIZE);
+
+  memset (src, 0x80, FRAME_SIZE);
+
+  printf ("%d NV12 %dx%d surfaces, %d copy iterations\n", num_surfaces,
+      WIDTH, HEIGHT, iterations);
+  run ("malloc", MODE_MALLOC, 0, num_surfaces, iterations, src);
+  run ("align 16", MODE_ALIGN, 16, num_surfaces, iterations, src);
+  run ("align 64", MODE_ALIGN, 64, num_surfaces, iterations, src);
+  run ("align 4096", MODE_ALIGN, 4096, num_surfaces, iterations, src);
+  run ("hugetlb", MODE_HUGETLB, 0, num_surfaces, iterations, src);
+  run ("thp (madvise)", MODE_THP, 0, num_surfaces, iterations, src);
+
+  free (src);
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/* Standalone benchmark of the surface download kernels of
+ * gst/mfx/gstmfxvideocopy.h: memcpy() against SSE4.1 streaming loads, on
+ * 1080p and 4K luma planes, copied by one or several threads in bands of
+ * rows as copy_plane() does. The source is either hot in the cache or
+ * flushed from it before each copy.
+ *
+ * Mapped VA surfaces are write-combined, which this program can not
+ * allocate, so it measures the overhead of the kernels on cacheable
+ * memory rather than the gain on surfaces.
+ *
+ *   gcc -O2 -pthread -I. $(pkg-config --cflags glib-2.0) \
+ *       -o surface-download benchmarks/surface-download.c
+ *   ./surface-download [threads] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "gst/mfx/gstmfxvideocopy.h"
+
+#define MAX_THREADS 4
+
+typedef struct
+{
+  CopyFunc func;
+  guint8 *dst;
+  const guint8 *src;
+  gsize size;
+} Band;
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+flush_cache (const guint8 * data, gsize size)
+{
+#ifdef HAVE_STREAM_COPY
+  gsize i;
+
+  for (i = 0; i < size; i += 64)
+    _mm_clflush (data + i);
+#endif
+  copy_stream_fence ();
+}
+
+static void *
+copy_band (void *data)
+{
+  Band *const band = data;
+
+  band->func (band->dst, band->src, band->size);
+  return NULL;
+}
+
+static void
+copy_plane (CopyFunc func, guint8 * dst, const guint8 * src, gsize size,
+    int n_threads)
+{
+  pthread_t threads[MAX_THREADS];
+  Band bands[MAX_THREADS];
+  gsize band_size = (size / n_threads + 63) & ~(gsize) 63;
+  int i;
+
+  for (i = 0; i < n_threads; i++) {
+    gsize offset = MIN (i * band_size, size);
+
+    bands[i].func = func;
+    bands[i].dst = dst + offset;
+    bands[i].src = src + offset;
+    bands[i].size = MIN (band_size, size - offset);
+    if (i > 0)
+      pthread_create (&threads[i], NULL, copy_band, &bands[i]);
+  }
+  copy_band (&bands[0]);
+  for (i = 1; i < n_threads; i++)
+    pthread_join (threads[i], NULL);
+}
+
+static void
+run (const char *name, CopyFunc func, gsize size, int n_threads,
+    int iterations, gboolean cold)
+{
+  guint8 *src = aligned_alloc (64, size);
+  guint8 *dst = aligned_alloc (64, size);
+  double elapsed = 0, t0;
+  int i;
+
+  memset (src, 0x80, size);
+  memset (dst, 0, size);
+
+  for (i = 0; i < iterations; i++) {
+    if (cold)
+      flush_cache (src, size);
+    t0 = now ();
+    copy_plane (func, dst, src, size, n_threads);
+    elapsed += now () - t0;
+  }
+
+  if (memcmp (dst, src, size))
+    printf ("%s: copy mismatch\n", name);
+
+  printf ("%-8s %-4s %8.2f GB/s\n", name, cold ? "cold" : "hot",
+      (double) size * iterations / elapsed / 1e9);
+
+  free (src);
+  free (dst);
+}
+
+int
+main (int argc, char **argv)
+{
+  int n_threads = argc > 1 ? CLAMP (atoi (argv[1]), 1, MAX_THREADS) : 1;
+  int iterations = argc > 2 ? atoi (argv[2]) : 100;
+  const gsize sizes[] = { 1920 * 1080, 3840 * 2160 };
+  int i, cold;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    printf ("%" G_GSIZE_FORMAT " bytes, %d thread(s)\n", sizes[i], n_threads);
+    for (cold = 0; cold <= 1; cold++) {
+      run ("memcpy", copy_memcpy, sizes[i], n_threads, iterations, cold);
+#ifdef HAVE_STREAM_COPY
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("sse4.1"))
+        run ("movntdqa", copy_stream_sse41, sizes[i], n_threads, iterations,
+            cold);
+#endif
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+#  Copyright (C) 2017 Intel Corporation
+#
+#  This library is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU Lesser General Public License
+#  as published by the Free Software Foundation; either version 2.1
+#  of the License, or (at your option) any later version.
+#
+#  This library is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#  Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public
+#  License along with this library; if not, write to the Free
+#  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+#  Boston, MA 02110-1301 USA
+#
+# Throughput of mfxvpp for each scaling-mode and interpolation-method,
+# downscaling 1080p NV12 to 720p and upscaling it to 4K. Every pipeline
+# runs in system memory, so the numbers include the upload and the
+# download of each frame; compare the rows with each other rather than
+# with other elements.
+#
+# The session uses MFX_IMPL_AUTO_ANY, which picks the hardware
+# implementation when there is one. To measure the software
+# implementation, run this on a machine without a Media SDK capable GPU
+# or with the software library first in the dispatcher search path.
+# The implementation in use is printed for each run.
+#
+#   ./benchmarks/vpp-scaling.sh [frames]
+
+FRAMES=${1:-300}
+
+run ()
+{
+  width=$1
+  height=$2
+  mode=$3
+  interp=$4
+
+  start=$(date +%s.%N)
+  impl=$(GST_DEBUG=mfx*:4 gst-launch-1.0 -q \
+      videotestsrc num-buffers="$FRAMES" pattern=smpte ! \
+      video/x-raw,format=NV12,width=1920,height=1080 ! \
+      mfxvpp width="$width" height="$height" \
+          scaling-mode="$mode" interpolation-method="$interp" ! \
+      video/x-raw,format=NV12 ! fakesink sync=false 2>&1 | \
+      sed -n 's/.*MFX session using \(.*\) implementation.*/\1/p' | \
+      head -n 1)
+  end=$(date +%s.%N)
+
+  echo "$width $height $mode $interp $start $end ${impl:-unknown}" | \
+      awk -v frames="$FRAMES" '{
+        impl = $7
+        for (i = 8; i <= NF; i++)
+          impl = impl " " $i
+        printf "%4dx%-4d  %-8s  %-8s  %8.1f fps  (%s)\n",
+            $1, $2, $3, $4, frames / ($6 - $5), impl
+      }'
+}
+
+echo "size       mode      interp    throughput"
+for size in "1280 720" "3840 2160"; do
+  for mode in auto lowpower quality; do
+    run $size $mode auto
+  done
+  for interp in nearest bilinear advanced; do
+    run $size auto $interp
+  done
+done
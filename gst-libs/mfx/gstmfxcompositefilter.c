@@ -29,6 +29,8 @@
 #include "gstmfxsurface.h"
 #include "gstmfxsurface_vaapi.h"
 #include "gstmfxsurfacecomposition.h"
+#include "gstmfxsurfacepool.h"
+#include "video-format.h"
 
 
 struct _GstMfxCompositeFilter
@@ -37,39 +39,122 @@ struct _GstMfxCompositeFilter
   GstMfxMiniObject parent_instance;
   GstMfxTaskAggregator *aggregator;
   GstMfxTask *vpp;
-  GstMfxSurface *out_surface;
+  GstMfxSurfacePool *out_pool;
   gboolean inited;
+  gboolean prepared;
 
   mfxSession session;
   mfxFrameInfo frame_info;
   mfxVideoParam params;
+  mfxFrameAllocResponse response;
+
+  /* Output size and format, inherited from the base surface if unset */
+  GstVideoInfo out_info;
+  gboolean has_out_info;
 
   mfxExtBuffer *ext_buffer;
   mfxExtVPPComposite composite;
-  guint num_rect;
+
+  /* Layout of the next frame when it differs from the one the VPP was
+   * initialized with, passed along with the frame instead of a reset */
+  mfxExtVPPComposite frame_composite;
+  mfxVPPCompInputStream *frame_streams;
+  guint num_frame_streams;
+  mfxExtBuffer **frame_ext_buf;
+  guint frame_ext_buf_len;
+  gboolean no_frame_params;
 };
 
 static void
 gst_mfx_composite_filter_finalize (GstMfxCompositeFilter * filter)
 {
+  MFXVideoVPP_Close (filter->session);
+
   /* Free allocated memory for filters */
   if (filter->composite.InputStream)
     g_slice_free1 ((sizeof (mfxVPPCompInputStream) * filter->composite.NumInputStream), filter->composite.InputStream);
-
-  gst_mfx_surface_replace (&filter->out_surface, NULL);
+  if (filter->frame_streams)
+    g_slice_free1 ((sizeof (mfxVPPCompInputStream) * filter->num_frame_streams),
+        filter->frame_streams);
+  g_free (filter->frame_ext_buf);
+
+  gst_mfx_surface_pool_replace (&filter->out_pool, NULL);
+  if (filter->prepared)
+    gst_mfx_task_frame_free (filter->vpp, &filter->response);
+  gst_mfx_task_aggregator_remove_current_task (filter->aggregator,
+      filter->vpp);
   gst_mfx_task_aggregator_unref (filter->aggregator);
 
-  MFXVideoVPP_Close (filter->session);
-
   gst_mfx_task_replace(&filter->vpp, NULL);
 }
 
+static guint
+get_num_input_streams (GstMfxSurfaceComposition * composition)
+{
+  return gst_mfx_surface_composition_get_num_subpictures (composition) +
+      (gst_mfx_surface_composition_get_base_surface (composition) ? 1 : 0);
+}
+
+static GstMfxSurface *
+get_input_surface (GstMfxSurfaceComposition * composition, guint index)
+{
+  GstMfxSurface *base_surface =
+      gst_mfx_surface_composition_get_base_surface (composition);
+  GstMfxSubpicture *subpicture;
+
+  if (base_surface) {
+    if (!index)
+      return base_surface;
+    index--;
+  }
+
+  subpicture = gst_mfx_surface_composition_get_subpicture (composition, index);
+  return subpicture ? subpicture->surface : NULL;
+}
+
+static gboolean
+fill_input_streams (GstMfxCompositeFilter * filter,
+    GstMfxSurfaceComposition * composition, mfxVPPCompInputStream * streams)
+{
+  GstMfxSubpicture *subpicture = NULL;
+  guint i, n = 0, num_rect;
+
+  num_rect = gst_mfx_surface_composition_get_num_subpictures (composition);
+  memset (streams, 0,
+      get_num_input_streams (composition) * sizeof (mfxVPPCompInputStream));
+
+  /* Fill the base picture */
+  if (gst_mfx_surface_composition_get_base_surface (composition)) {
+    streams[0].DstX = filter->frame_info.CropX;
+    streams[0].DstY = filter->frame_info.CropY;
+    streams[0].DstW = filter->frame_info.CropW;
+    streams[0].DstH = filter->frame_info.CropH;
+    n++;
+  }
+
+  /* Fill the subpicture info */
+  for (i = 0; i < num_rect; i++, n++) {
+    subpicture = gst_mfx_surface_composition_get_subpicture (composition, i);
+    if (!subpicture)
+      return FALSE;
+    streams[n].DstX = subpicture->sub_rect.x;
+    streams[n].DstY = subpicture->sub_rect.y;
+    streams[n].DstH = subpicture->sub_rect.height;
+    streams[n].DstW = subpicture->sub_rect.width;
+    streams[n].PixelAlphaEnable = subpicture->pixel_alpha;
+    if (subpicture->global_alpha < 1.0) {
+      streams[n].GlobalAlphaEnable = 1;
+      streams[n].GlobalAlpha = subpicture->global_alpha * 255;
+    }
+  }
+  return TRUE;
+}
+
 static gboolean
 configure_composite_filter (GstMfxCompositeFilter * filter,
   GstMfxSurfaceComposition * composition)
 {
-  GstMfxSubpicture *subpicture = NULL;
-  guint num_rect = 0;
+  guint num_streams;
 
   g_return_val_if_fail (filter != NULL, FALSE);
   g_return_val_if_fail (composition != NULL, FALSE);
@@ -83,18 +168,20 @@ configure_composite_filter (GstMfxCompositeFilter * filter,
     filter->composite.V = 0x80;
   }
 
-  num_rect = gst_mfx_surface_composition_get_num_subpictures (composition);
+  num_streams = get_num_input_streams (composition);
+  if (!num_streams)
+    return FALSE;
 
-  if (filter->num_rect != num_rect && filter->composite.InputStream) {
-    g_slice_free1(((num_rect+1)*sizeof (mfxVPPCompInputStream)),
-        filter->composite.InputStream);
+  if (filter->composite.InputStream &&
+      filter->composite.NumInputStream != num_streams) {
+    g_slice_free1 ((filter->composite.NumInputStream *
+        sizeof (mfxVPPCompInputStream)), filter->composite.InputStream);
+    filter->composite.InputStream = NULL;
   }
 
-  filter->num_rect = num_rect;
-
   /* Set number of input stream to composed
    * Input Stream = Number of rectangle + number of base surface*/
-  filter->composite.NumInputStream = num_rect + 1;
+  filter->composite.NumInputStream = num_streams;
 
   if(!filter->composite.InputStream) {
     filter->composite.InputStream =
@@ -104,23 +191,8 @@ configure_composite_filter (GstMfxCompositeFilter * filter,
       return FALSE;
   }
 
-  /* Fill the base picture */
-  filter->composite.InputStream[0].DstX = filter->frame_info.CropX;
-  filter->composite.InputStream[0].DstY = filter->frame_info.CropY;
-  filter->composite.InputStream[0].DstW = filter->frame_info.CropW;
-  filter->composite.InputStream[0].DstH = filter->frame_info.CropH;
-
-  /* Fill the subpicture info */
-  for (guint i=1; i < filter->composite.NumInputStream; i++) {
-    subpicture = gst_mfx_surface_composition_get_subpicture (composition, i-1);
-    if (!subpicture)
-      return FALSE;
-    filter->composite.InputStream[i].DstX = subpicture->sub_rect.x;
-    filter->composite.InputStream[i].DstY = subpicture->sub_rect.y;
-    filter->composite.InputStream[i].DstH = subpicture->sub_rect.height;
-    filter->composite.InputStream[i].DstW = subpicture->sub_rect.width;
-    filter->composite.InputStream[i].PixelAlphaEnable = 1;
-  }
+  if (!fill_input_streams (filter, composition, filter->composite.InputStream))
+    return FALSE;
 
   filter->ext_buffer = (mfxExtBuffer *) &filter->composite;
   filter->params.NumExtParam = 1;
@@ -152,6 +224,47 @@ gst_mfx_composite_filter_reset (GstMfxCompositeFilter * filter,
   return TRUE;
 }
 
+/* Compares the layout of @composition with the one the VPP was initialized
+ * with. A different layout is stored in frame_streams to go along with
+ * each frame where the API allows it; a change in the number of streams
+ * always needs a reset */
+static gboolean
+update_input_streams (GstMfxCompositeFilter * filter,
+    GstMfxSurfaceComposition * composition, gboolean * changed)
+{
+  guint num_streams = get_num_input_streams (composition);
+
+  *changed = FALSE;
+  if (num_streams != filter->composite.NumInputStream)
+    return gst_mfx_composite_filter_reset (filter, composition);
+
+  if (filter->num_frame_streams != num_streams) {
+    if (filter->frame_streams)
+      g_slice_free1 ((filter->num_frame_streams *
+          sizeof (mfxVPPCompInputStream)), filter->frame_streams);
+    filter->frame_streams =
+        g_slice_alloc (num_streams * sizeof (mfxVPPCompInputStream));
+    filter->num_frame_streams = num_streams;
+  }
+
+  if (!fill_input_streams (filter, composition, filter->frame_streams))
+    return FALSE;
+
+  if (!memcmp (filter->frame_streams, filter->composite.InputStream,
+          num_streams * sizeof (mfxVPPCompInputStream)))
+    return TRUE;
+
+#if MSDK_CHECK_VERSION(1,19)
+  if (!filter->no_frame_params) {
+    filter->frame_composite = filter->composite;
+    filter->frame_composite.InputStream = filter->frame_streams;
+    *changed = TRUE;
+    return TRUE;
+  }
+#endif
+  return gst_mfx_composite_filter_reset (filter, composition);
+}
+
 static gboolean
 gst_mfx_composite_filter_init (GstMfxCompositeFilter * filter,
     GstMfxTaskAggregator * aggregator, gboolean memtype_is_system)
@@ -164,7 +277,6 @@ gst_mfx_composite_filter_init (GstMfxCompositeFilter * filter,
         MFX_IOPATTERN_IN_VIDEO_MEMORY | MFX_IOPATTERN_OUT_VIDEO_MEMORY;
   filter->aggregator = gst_mfx_task_aggregator_ref (aggregator);
   filter->inited = FALSE;
-  filter->num_rect = 0;
 
   filter->vpp =
       gst_mfx_task_new (filter->aggregator, GST_MFX_TASK_VPP_OUT);
@@ -233,12 +345,38 @@ gst_mfx_composite_filter_replace(GstMfxCompositeFilter ** old_filter_ptr,
     GST_MFX_MINI_OBJECT(new_filter));
 }
 
+static void
+frame_info_from_video_info (mfxFrameInfo * frame_info,
+    const GstVideoInfo * info)
+{
+  frame_info->FourCC =
+      gst_video_format_to_mfx_fourcc (GST_VIDEO_INFO_FORMAT (info));
+  frame_info->ChromaFormat = MFX_CHROMAFORMAT_YUV420;
+  frame_info->PicStruct = MFX_PICSTRUCT_PROGRESSIVE;
+  frame_info->CropX = 0;
+  frame_info->CropY = 0;
+  frame_info->CropW = GST_VIDEO_INFO_WIDTH (info);
+  frame_info->CropH = GST_VIDEO_INFO_HEIGHT (info);
+  frame_info->Width = GST_ROUND_UP_16 (GST_VIDEO_INFO_WIDTH (info));
+  frame_info->Height = GST_ROUND_UP_16 (GST_VIDEO_INFO_HEIGHT (info));
+  if (GST_VIDEO_INFO_FPS_N (info) && GST_VIDEO_INFO_FPS_D (info)) {
+    frame_info->FrameRateExtN = GST_VIDEO_INFO_FPS_N (info);
+    frame_info->FrameRateExtD = GST_VIDEO_INFO_FPS_D (info);
+  }
+  else {
+    frame_info->FrameRateExtN = 30;
+    frame_info->FrameRateExtD = 1;
+  }
+}
+
 static gboolean
 init_params (GstMfxCompositeFilter * filter,
     GstMfxSurfaceComposition * composition)
 {
   filter->params.vpp.In = filter->frame_info;
   filter->params.vpp.Out = filter->frame_info;
+  if (filter->has_out_info)
+    frame_info_from_video_info (&filter->params.vpp.Out, &filter->out_info);
 
   if (!configure_composite_filter (filter, composition)) {
     GST_ERROR ("Error initializing composite filter params.");
@@ -248,39 +386,167 @@ init_params (GstMfxCompositeFilter * filter,
   return TRUE;
 }
 
+/* Takes the input frame description from the largest input */
+static void
+update_frame_info (GstMfxCompositeFilter * filter,
+    GstMfxSurfaceComposition * composition)
+{
+  mfxFrameInfo *info;
+  guint i, num_streams = get_num_input_streams (composition);
+
+  for (i = 0; i < num_streams; i++) {
+    info = &gst_mfx_surface_get_frame_surface (
+        get_input_surface (composition, i))->Info;
+    if (!i)
+      filter->frame_info = *info;
+    filter->frame_info.Width = MAX (filter->frame_info.Width, info->Width);
+    filter->frame_info.Height = MAX (filter->frame_info.Height, info->Height);
+  }
+}
+
+/**
+ * gst_mfx_composite_filter_set_output_info:
+ * @filter: a #GstMfxCompositeFilter
+ * @info: the #GstVideoInfo of the composed output
+ *
+ * Sets the size and format of the output of @filter, which otherwise
+ * inherits those of the base surface of the compositions.
+ */
+void
+gst_mfx_composite_filter_set_output_info (GstMfxCompositeFilter * filter,
+    const GstVideoInfo * info)
+{
+  g_return_if_fail (filter != NULL);
+  g_return_if_fail (info != NULL);
+  g_return_if_fail (!filter->inited);
+
+  filter->out_info = *info;
+  filter->has_out_info = TRUE;
+}
+
+/**
+ * gst_mfx_composite_filter_prepare:
+ * @filter: a #GstMfxCompositeFilter
+ * @in_info: the #GstVideoInfo of the largest input
+ * @num_streams: the number of streams in the compositions
+ *
+ * Publishes the VPP task of @filter as the current task of its aggregator,
+ * with the allocation request of its output, so that a downstream MFX
+ * element can share the output surfaces. The output pool is allocated
+ * through the task on the first composition. Must be called after
+ * gst_mfx_composite_filter_set_output_info().
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_mfx_composite_filter_prepare (GstMfxCompositeFilter * filter,
+    const GstVideoInfo * in_info, guint num_streams)
+{
+  mfxFrameAllocRequest request[2];
+  mfxVPPCompInputStream *streams;
+  mfxExtBuffer *ext_buffer;
+  mfxExtVPPComposite composite;
+  mfxStatus sts;
+  guint i;
+
+  g_return_val_if_fail (filter != NULL, FALSE);
+  g_return_val_if_fail (filter->has_out_info, FALSE);
+  g_return_val_if_fail (num_streams > 0, FALSE);
+
+  frame_info_from_video_info (&filter->frame_info, in_info);
+  filter->params.vpp.In = filter->frame_info;
+  frame_info_from_video_info (&filter->params.vpp.Out, &filter->out_info);
+
+  /* Full frame streams stand in for the layout of the first frame */
+  streams = g_new0 (mfxVPPCompInputStream, num_streams);
+  for (i = 0; i < num_streams; i++) {
+    streams[i].DstW = GST_VIDEO_INFO_WIDTH (&filter->out_info);
+    streams[i].DstH = GST_VIDEO_INFO_HEIGHT (&filter->out_info);
+  }
+  memset (&composite, 0, sizeof (mfxExtVPPComposite));
+  composite.Header.BufferId = MFX_EXTBUFF_VPP_COMPOSITE;
+  composite.Header.BufferSz = sizeof (mfxExtVPPComposite);
+  composite.NumInputStream = num_streams;
+  composite.InputStream = streams;
+  ext_buffer = (mfxExtBuffer *) &composite;
+  filter->params.NumExtParam = 1;
+  filter->params.ExtParam = &ext_buffer;
+
+  sts = MFXVideoVPP_QueryIOSurf (filter->session, &filter->params, request);
+  filter->params.NumExtParam = 0;
+  filter->params.ExtParam = NULL;
+  g_free (streams);
+  if (sts < 0) {
+    GST_ERROR ("Unable to query composite VPP allocation request %d", sts);
+    return FALSE;
+  }
+
+  request[1].Type |= MFX_MEMTYPE_FROM_VPPOUT;
+  gst_mfx_task_set_request (filter->vpp, &request[1]);
+  gst_mfx_task_set_video_params (filter->vpp, &filter->params);
+  gst_mfx_task_aggregator_set_current_task (filter->aggregator, filter->vpp);
+
+  filter->prepared = TRUE;
+  return TRUE;
+}
+
 static gboolean
 gst_mfx_composite_filter_start (GstMfxCompositeFilter * filter,
   GstMfxSurfaceComposition * composition)
 {
   GstMfxSurface *base_surface;
+  GstMfxDisplay *display;
   mfxStatus sts = MFX_ERR_NONE;
+  gboolean memtype_is_system;
   GstVideoInfo info;
 
   gst_video_info_init(&info);
 
-  base_surface = gst_mfx_surface_composition_get_base_surface (composition);
-  filter->frame_info = gst_mfx_surface_get_frame_surface (base_surface)->Info;
+  update_frame_info (filter, composition);
 
   if (!init_params (filter, composition)) {
     GST_ERROR ("Error initializing composite filter params.");
     return FALSE;
   }
 
-  gst_video_info_set_format(&info, GST_MFX_SURFACE_FORMAT (base_surface),
-    GST_MFX_SURFACE_WIDTH (base_surface), GST_MFX_SURFACE_HEIGHT (base_surface));
+  memtype_is_system =
+      !(filter->params.IOPattern & MFX_IOPATTERN_OUT_VIDEO_MEMORY);
+  if (!memtype_is_system)
+    gst_mfx_task_use_video_memory (filter->vpp);
 
-  /* Allocate output surface for final composition */
-  if (filter->params.IOPattern & MFX_IOPATTERN_OUT_VIDEO_MEMORY) {
-    GstMfxDisplay *display =
-        gst_mfx_surface_vaapi_get_display (base_surface);
-    filter->out_surface = gst_mfx_surface_vaapi_new (display, &info, NULL);
-    gst_mfx_display_unref (display);
+  /* Allocate the output surfaces for the compositions */
+  if (filter->prepared) {
+    /* Get updated video params if modified by peer MFX element */
+    gst_mfx_task_update_video_params (filter->vpp, &filter->params);
 
-    gst_mfx_task_use_video_memory (filter->vpp);
-  } else {
-    filter->out_surface = gst_mfx_surface_new (&info);
+    if (!memtype_is_system) {
+      sts = gst_mfx_task_frame_alloc (filter->vpp,
+          gst_mfx_task_get_request (filter->vpp), &filter->response);
+      if (MFX_ERR_NONE != sts)
+        return FALSE;
+    }
+    else {
+      gst_mfx_task_ensure_memtype_is_system (filter->vpp);
+    }
+    filter->out_pool = gst_mfx_surface_pool_new_with_task (filter->vpp);
   }
-  if (!filter->out_surface)
+  else {
+    if (filter->has_out_info) {
+      info = filter->out_info;
+    }
+    else {
+      base_surface = get_input_surface (composition, 0);
+      gst_video_info_set_format(&info, GST_MFX_SURFACE_FORMAT (base_surface),
+        GST_MFX_SURFACE_WIDTH (base_surface),
+        GST_MFX_SURFACE_HEIGHT (base_surface));
+    }
+
+    display = gst_mfx_task_get_display (filter->vpp);
+    filter->out_pool = gst_mfx_surface_pool_new (display, &info,
+        memtype_is_system);
+    gst_mfx_display_unref (display);
+  }
+  if (!filter->out_pool)
     return FALSE;
 
   sts = MFXVideoVPP_Init (filter->session, &filter->params);
@@ -291,23 +557,95 @@ gst_mfx_composite_filter_start (GstMfxCompositeFilter * filter,
   return TRUE;
 }
 
+static mfxStatus
+run_composition (GstMfxCompositeFilter * filter,
+    GstMfxSurfaceComposition * composition, mfxFrameSurface1 * outsurf,
+    gboolean attach_layout, mfxSyncPoint * syncp)
+{
+  mfxFrameSurface1 *insurf;
+  mfxExtBuffer **ext_params = NULL;
+  mfxU16 num_ext_params = 0;
+  mfxStatus sts = MFX_ERR_NONE;
+  guint i, num_streams = get_num_input_streams (composition);
+
+  for (i = 0; i < num_streams; i++) {
+    insurf = gst_mfx_surface_get_frame_surface (
+        get_input_surface (composition, i));
+
+    /* The layout of the frame goes along with its first stream, after
+     * the ext buffers already carried by the surface */
+    if (!i && attach_layout) {
+      num_ext_params = insurf->Data.NumExtParam;
+      ext_params = insurf->Data.ExtParam;
+      if (filter->frame_ext_buf_len < num_ext_params + 1) {
+        filter->frame_ext_buf_len = num_ext_params + 1;
+        filter->frame_ext_buf = g_renew (mfxExtBuffer *,
+            filter->frame_ext_buf, filter->frame_ext_buf_len);
+      }
+      if (num_ext_params)
+        memcpy (filter->frame_ext_buf, ext_params,
+            num_ext_params * sizeof (mfxExtBuffer *));
+      filter->frame_ext_buf[num_ext_params] =
+          (mfxExtBuffer *) &filter->frame_composite;
+      insurf->Data.NumExtParam = num_ext_params + 1;
+      insurf->Data.ExtParam = filter->frame_ext_buf;
+    }
+
+    do {
+      sts =
+          MFXVideoVPP_RunFrameVPPAsync (filter->session,
+            insurf,
+            outsurf,
+            NULL,
+            syncp);
+
+      if (MFX_WRN_DEVICE_BUSY == sts)
+          g_usleep (500);
+    } while (MFX_WRN_DEVICE_BUSY == sts);
+
+    if (!i && attach_layout) {
+      insurf->Data.NumExtParam = num_ext_params;
+      insurf->Data.ExtParam = ext_params;
+    }
+
+    /* All streams but the last one are consumed without output */
+    if (i + 1 < num_streams && MFX_ERR_MORE_DATA != sts)
+      break;
+  }
+  return sts;
+}
+
+/**
+ * gst_mfx_composite_filter_apply_composition:
+ * @filter: a #GstMfxCompositeFilter
+ * @composition: the #GstMfxSurfaceComposition to blend
+ * @out_surface: return location for the composed surface
+ *
+ * Blends the surfaces of @composition in a single VPP pass. Changes of the
+ * position, size or opacity of the streams are passed along with the
+ * frame without resetting the VPP where the API allows it.
+ *
+ * The composed surface comes from the output pool of @filter and has a
+ * pending sync point, see gst_mfx_surface_sync(). The caller owns a
+ * reference to it and releases it with gst_mfx_surface_unref().
+ *
+ * Return value: %TRUE on success
+ */
 gboolean
 gst_mfx_composite_filter_apply_composition (GstMfxCompositeFilter * filter,
   GstMfxSurfaceComposition * composition, GstMfxSurface ** out_surface)
 {
   GstMfxSurface *surface;
-  GstMfxSubpicture *subpicture = NULL;
-  mfxFrameSurface1 *insurf, *outsurf = NULL;
-  mfxSyncPoint syncp;
+  mfxFrameSurface1 *outsurf = NULL;
+  mfxSyncPoint syncp = NULL;
   mfxStatus sts = MFX_ERR_NONE;
-  guint i, num_subpictures;
+  gboolean layout_changed = FALSE;
+  guint i;
 
-  num_subpictures =
-      gst_mfx_surface_composition_get_num_subpictures (composition);
+  g_return_val_if_fail (filter != NULL, FALSE);
+  g_return_val_if_fail (composition != NULL, FALSE);
 
-  /* Reset filter for every frame because subpicture dimension
-   * and position will be different for every frame. */
-  if (!gst_mfx_composite_filter_reset (filter, composition))
+  if (!get_num_input_streams (composition))
     return FALSE;
 
   if (!filter->inited) {
@@ -315,53 +653,49 @@ gst_mfx_composite_filter_apply_composition (GstMfxCompositeFilter * filter,
       return FALSE;
     filter->inited = TRUE;
   }
+  else if (!update_input_streams (filter, composition, &layout_changed))
+    return FALSE;
 
-  /* First composition with base surface */
-  surface = gst_mfx_surface_composition_get_base_surface(composition);
-  insurf = gst_mfx_surface_get_frame_surface (surface);
+  /* Inputs produced outside the sessions of the aggregator are not ordered
+   * by the SDK before the blending */
+  for (i = 0; i < get_num_input_streams (composition); i++)
+    if (!gst_mfx_surface_sync_for_aggregator (get_input_surface (composition,
+                i), filter->aggregator))
+      return FALSE;
 
   /* Get output surface */
-  outsurf = gst_mfx_surface_get_frame_surface (filter->out_surface);
-  do {
-    sts =
-        MFXVideoVPP_RunFrameVPPAsync (filter->session,
-          insurf,
-          outsurf,
-          NULL,
-          &syncp);
-
-    if (MFX_WRN_DEVICE_BUSY == sts)
-        g_usleep (100);
-  } while (MFX_WRN_DEVICE_BUSY == sts);
-
-  if (MFX_ERR_MORE_DATA == sts) {
-    for (i = 0; i < num_subpictures; i++) {
-      subpicture =
-          gst_mfx_surface_composition_get_subpicture (composition, i);
-      insurf = gst_mfx_surface_get_frame_surface (subpicture->surface);
-
-      do {
-        sts =
-            MFXVideoVPP_RunFrameVPPAsync (filter->session,
-              insurf,
-              outsurf,
-              NULL,
-              &syncp);
-
-        if (MFX_WRN_DEVICE_BUSY == sts)
-            g_usleep (500);
-      } while (MFX_WRN_DEVICE_BUSY == sts);
-    }
-  }
-
-  if (MFX_ERR_NONE != sts)
+  surface = gst_mfx_surface_pool_get_surface (filter->out_pool);
+  if (!surface)
     return FALSE;
+  outsurf = gst_mfx_surface_get_frame_surface (surface);
+
+  sts = run_composition (filter, composition, outsurf, layout_changed,
+      &syncp);
+
+  /* Fall back to resetting the VPP if the runtime rejects the layout
+   * passed along with the frame */
+  if (layout_changed && sts < 0 && MFX_ERR_MORE_DATA != sts) {
+    GST_WARNING ("Per-frame composition layout rejected (%d), "
+        "resetting VPP instead", sts);
+    filter->no_frame_params = TRUE;
+    layout_changed = FALSE;
+    if (!gst_mfx_composite_filter_reset (filter, composition))
+      goto error;
+    sts = run_composition (filter, composition, outsurf, FALSE, &syncp);
+  }
 
-  do {
-    sts = MFXVideoCORE_SyncOperation (filter->session, syncp, 1000);
-  } while (MFX_WRN_IN_EXECUTION == sts);
+  if (MFX_WRN_INCOMPATIBLE_VIDEO_PARAM == sts)
+    sts = MFX_ERR_NONE;
+  if (MFX_ERR_NONE != sts) {
+    GST_ERROR ("Error during MFX composition %d", sts);
+    goto error;
+  }
 
-  *out_surface = filter->out_surface;
+  gst_mfx_surface_set_syncpoint (surface, filter->session, syncp);
+  *out_surface = surface;
 
   return TRUE;
+error:
+  gst_mfx_surface_unref (surface);
+  return FALSE;
 }
@@ -49,6 +49,14 @@ void
 gst_mfx_composite_filter_replace(GstMfxCompositeFilter ** old_filter_ptr,
   GstMfxCompositeFilter * new_filter);
 
+void
+gst_mfx_composite_filter_set_output_info (GstMfxCompositeFilter * filter,
+  const GstVideoInfo * info);
+
+gboolean
+gst_mfx_composite_filter_prepare (GstMfxCompositeFilter * filter,
+  const GstVideoInfo * in_info, guint num_streams);
+
 gboolean
 gst_mfx_composite_filter_apply_composition (GstMfxCompositeFilter * filter,
   GstMfxSurfaceComposition * composition, GstMfxSurface ** out_surface);
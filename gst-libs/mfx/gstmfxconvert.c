@@ -0,0 +1,161 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstmfxconvert.h"
+#include "gstmfxconvert_priv.h"
+
+#define DEBUG 1
+#include "gstmfxdebug.h"
+
+static GstMfxInterleaveFunc interleave_uv;
+static GstMfxSplitPackedFunc split_packed;
+
+static void
+ensure_kernels (void)
+{
+  static gsize g_init = 0;
+
+  if (g_once_init_enter (&g_init)) {
+    const gchar *impl = "c";
+
+    interleave_uv = interleave_uv_c;
+    split_packed = split_packed_c;
+#ifdef USE_X86_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+      /* The packed 4:2:2 split is bound by memory, and lane crossing
+       * makes a 256-bit version slower than the SSE2 one */
+      interleave_uv = interleave_uv_avx2;
+      split_packed = split_packed_sse2;
+      impl = "avx2";
+    } else if (__builtin_cpu_supports ("sse2")) {
+      interleave_uv = interleave_uv_sse2;
+      split_packed = split_packed_sse2;
+      impl = "sse2";
+    }
+#endif
+    GST_DEBUG ("using %s NV12 conversion kernels", impl);
+    g_once_init_leave (&g_init, 1);
+  }
+}
+
+/**
+ * gst_mfx_convert_to_nv12_is_supported:
+ * @format: a #GstVideoFormat
+ *
+ * Checks whether frames of @format can be converted by
+ * gst_mfx_convert_frame_to_nv12().
+ *
+ * Return value: %TRUE if @format is supported
+ */
+gboolean
+gst_mfx_convert_to_nv12_is_supported (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:
+    case GST_VIDEO_FORMAT_YUY2:
+    case GST_VIDEO_FORMAT_UYVY:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/**
+ * gst_mfx_convert_frame_to_nv12:
+ * @dest: the mapped NV12 destination frame
+ * @src: the mapped source frame
+ *
+ * Converts @src to NV12 in a single pass over its pixels. Packed 4:2:2
+ * chroma is averaged vertically. The frames are cropped to the smaller
+ * of their sizes.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_mfx_convert_frame_to_nv12 (GstVideoFrame * dest, const GstVideoFrame * src)
+{
+  const GstVideoFormat format = GST_VIDEO_FRAME_FORMAT (src);
+  guint8 *dest_y, *dest_uv;
+  guint dest_y_stride, dest_uv_stride;
+  guint width, height, i;
+
+  g_return_val_if_fail (dest != NULL, FALSE);
+  g_return_val_if_fail (src != NULL, FALSE);
+  g_return_val_if_fail (GST_VIDEO_FRAME_FORMAT (dest) ==
+      GST_VIDEO_FORMAT_NV12, FALSE);
+
+  if (!gst_mfx_convert_to_nv12_is_supported (format))
+    return FALSE;
+
+  ensure_kernels ();
+
+  width = MIN (GST_VIDEO_FRAME_WIDTH (dest), GST_VIDEO_FRAME_WIDTH (src));
+  height = MIN (GST_VIDEO_FRAME_HEIGHT (dest), GST_VIDEO_FRAME_HEIGHT (src));
+
+  dest_y = GST_VIDEO_FRAME_PLANE_DATA (dest, 0);
+  dest_y_stride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, 0);
+  dest_uv = GST_VIDEO_FRAME_PLANE_DATA (dest, 1);
+  dest_uv_stride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, 1);
+
+  switch (format) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_YV12:{
+      /* Component indices hide the swapped planes of YV12 */
+      const guint8 *const src_y = GST_VIDEO_FRAME_COMP_DATA (src, 0);
+      const guint8 *const src_u = GST_VIDEO_FRAME_COMP_DATA (src, 1);
+      const guint8 *const src_v = GST_VIDEO_FRAME_COMP_DATA (src, 2);
+      const guint src_y_stride = GST_VIDEO_FRAME_COMP_STRIDE (src, 0);
+      const guint src_u_stride = GST_VIDEO_FRAME_COMP_STRIDE (src, 1);
+      const guint src_v_stride = GST_VIDEO_FRAME_COMP_STRIDE (src, 2);
+
+      for (i = 0; i < height; i++)
+        memcpy (dest_y + i * dest_y_stride, src_y + i * src_y_stride, width);
+      for (i = 0; i < (height + 1) / 2; i++)
+        interleave_uv (dest_uv + i * dest_uv_stride,
+            src_u + i * src_u_stride, src_v + i * src_v_stride,
+            (width + 1) / 2);
+      break;
+    }
+    case GST_VIDEO_FORMAT_YUY2:
+    case GST_VIDEO_FORMAT_UYVY:{
+      const guint8 *const src_data = GST_VIDEO_FRAME_PLANE_DATA (src, 0);
+      const guint src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (src, 0);
+      const guint luma = format == GST_VIDEO_FORMAT_UYVY ? 1 : 0;
+
+      for (i = 0; i < height; i += 2) {
+        /* The last row of an odd height is paired with itself */
+        const guint next = i + 1 < height ? 1 : 0;
+        const guint8 *const src0 = src_data + i * src_stride;
+        guint8 *const y0 = dest_y + i * dest_y_stride;
+
+        split_packed (y0, y0 + next * dest_y_stride,
+            dest_uv + (i / 2) * dest_uv_stride,
+            src0, src0 + next * src_stride, width, luma);
+      }
+      break;
+    }
+    default:
+      g_assert_not_reached ();
+  }
+  return TRUE;
+}
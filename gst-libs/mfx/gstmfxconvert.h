@@ -0,0 +1,37 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_CONVERT_H
+#define GST_MFX_CONVERT_H
+
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+gboolean
+gst_mfx_convert_to_nv12_is_supported (GstVideoFormat format);
+
+gboolean
+gst_mfx_convert_frame_to_nv12 (GstVideoFrame * dest,
+    const GstVideoFrame * src);
+
+G_END_DECLS
+
+#endif /* GST_MFX_CONVERT_H */
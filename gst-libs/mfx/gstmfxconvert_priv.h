@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_CONVERT_PRIV_H
+#define GST_MFX_CONVERT_PRIV_H
+
+#include <glib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define USE_X86_SIMD 1
+# include <immintrin.h>
+#endif
+
+/* Row kernels converting raw 4:2:0 and packed 4:2:2 input to NV12 as it is
+ * written into a surface, so that the encoder does not need a VPP session
+ * for the colorspace conversion. They only depend on GLib so that
+ * benchmarks/convert-nv12.c can check and time them */
+
+typedef void (*GstMfxInterleaveFunc) (guint8 * uv, const guint8 * u,
+    const guint8 * v, guint n);
+
+typedef void (*GstMfxSplitPackedFunc) (guint8 * y0, guint8 * y1, guint8 * uv,
+    const guint8 * src0, const guint8 * src1, guint width, guint luma);
+
+static void
+interleave_uv_c (guint8 * uv, const guint8 * u, const guint8 * v, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    uv[2 * i] = u[i];
+    uv[2 * i + 1] = v[i];
+  }
+}
+
+/* Splits two rows of packed 4:2:2 pixels into their luma rows and a row of
+ * interleaved chroma, averaged over both rows. @luma is the offset of the
+ * first luma sample in a macropixel, i.e. 0 for YUY2 and 1 for UYVY */
+static void
+split_packed_c (guint8 * y0, guint8 * y1, guint8 * uv,
+    const guint8 * src0, const guint8 * src1, guint width, guint luma)
+{
+  const guint chroma = 1 - luma;
+  guint x;
+
+  for (x = 0; x < width; x++) {
+    y0[x] = src0[2 * x + luma];
+    y1[x] = src1[2 * x + luma];
+    uv[x] = (src0[2 * x + chroma] + src1[2 * x + chroma] + 1) >> 1;
+  }
+  /* Odd widths still carry the chroma of the last macropixel */
+  if (width & 1)
+    uv[width] = (src0[2 * width + chroma] + src1[2 * width + chroma] + 1) >> 1;
+}
+
+#ifdef USE_X86_SIMD
+__attribute__ ((target ("sse2")))
+static void
+interleave_uv_sse2 (guint8 * uv, const guint8 * u, const guint8 * v, guint n)
+{
+  guint i;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    const __m128i mu = _mm_loadu_si128 ((const __m128i *) (u + i));
+    const __m128i mv = _mm_loadu_si128 ((const __m128i *) (v + i));
+
+    _mm_storeu_si128 ((__m128i *) (uv + 2 * i), _mm_unpacklo_epi8 (mu, mv));
+    _mm_storeu_si128 ((__m128i *) (uv + 2 * i + 16),
+        _mm_unpackhi_epi8 (mu, mv));
+  }
+  interleave_uv_c (uv + 2 * i, u + i, v + i, n - i);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+split_packed_sse2 (guint8 * y0, guint8 * y1, guint8 * uv,
+    const guint8 * src0, const guint8 * src1, guint width, guint luma)
+{
+  const __m128i mask = _mm_set1_epi16 (0x00ff);
+  const __m128i luma_shift = _mm_cvtsi32_si128 (luma * 8);
+  const __m128i chroma_shift = _mm_cvtsi32_si128 ((1 - luma) * 8);
+  guint x;
+
+  for (x = 0; x + 16 <= width; x += 16) {
+    const __m128i a0 = _mm_loadu_si128 ((const __m128i *) (src0 + 2 * x));
+    const __m128i a1 =
+        _mm_loadu_si128 ((const __m128i *) (src0 + 2 * x + 16));
+    const __m128i b0 = _mm_loadu_si128 ((const __m128i *) (src1 + 2 * x));
+    const __m128i b1 =
+        _mm_loadu_si128 ((const __m128i *) (src1 + 2 * x + 16));
+    const __m128i c0 = _mm_avg_epu8 (a0, b0);
+    const __m128i c1 = _mm_avg_epu8 (a1, b1);
+
+    _mm_storeu_si128 ((__m128i *) (y0 + x),
+        _mm_packus_epi16 (_mm_and_si128 (_mm_srl_epi16 (a0, luma_shift), mask),
+            _mm_and_si128 (_mm_srl_epi16 (a1, luma_shift), mask)));
+    _mm_storeu_si128 ((__m128i *) (y1 + x),
+        _mm_packus_epi16 (_mm_and_si128 (_mm_srl_epi16 (b0, luma_shift), mask),
+            _mm_and_si128 (_mm_srl_epi16 (b1, luma_shift), mask)));
+    _mm_storeu_si128 ((__m128i *) (uv + x),
+        _mm_packus_epi16 (_mm_and_si128 (_mm_srl_epi16 (c0, chroma_shift),
+                mask), _mm_and_si128 (_mm_srl_epi16 (c1, chroma_shift),
+                mask)));
+  }
+  split_packed_c (y0 + x, y1 + x, uv + x, src0 + 2 * x, src1 + 2 * x,
+      width - x, luma);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+interleave_uv_avx2 (guint8 * uv, const guint8 * u, const guint8 * v, guint n)
+{
+  guint i;
+
+  for (i = 0; i + 32 <= n; i += 32) {
+    const __m256i mu = _mm256_loadu_si256 ((const __m256i *) (u + i));
+    const __m256i mv = _mm256_loadu_si256 ((const __m256i *) (v + i));
+    const __m256i lo = _mm256_unpacklo_epi8 (mu, mv);
+    const __m256i hi = _mm256_unpackhi_epi8 (mu, mv);
+
+    /* Unpacking works within 128-bit lanes, so restore the sample order */
+    _mm256_storeu_si256 ((__m256i *) (uv + 2 * i),
+        _mm256_permute2x128_si256 (lo, hi, 0x20));
+    _mm256_storeu_si256 ((__m256i *) (uv + 2 * i + 32),
+        _mm256_permute2x128_si256 (lo, hi, 0x31));
+  }
+  interleave_uv_sse2 (uv + 2 * i, u + i, v + i, n - i);
+}
+#endif
+
+#endif /* GST_MFX_CONVERT_PRIV_H */
@@ -1128,13 +1128,10 @@ gst_mfx_decoder_decode (GstMfxDecoder * decoder,
     }
     decoder->has_ready_frames = TRUE;
 
-    if (!gst_mfx_task_has_type (decoder->decode, GST_MFX_TASK_ENCODER))
-      do {
-        sts = MFXVideoCORE_SyncOperation (decoder->session, syncp, 1000);
-        GST_DEBUG ("MFXVideoCORE_SyncOperation status: %d", sts);
-      } while (MFX_WRN_IN_EXECUTION == sts);
-
+    /* Joined sessions consume the surface in order, so only consumers
+     * needing the decoded pixels wait on the sync point */
     surface = gst_mfx_surface_pool_find_surface (decoder->pool, outsurf);
+    gst_mfx_surface_set_syncpoint (surface, decoder->session, syncp);
 
     /* Update stream properties if they have interlaced frames. An interlaced H264
      * can only be detected after decoding the first frame, hence the delayed VPP
@@ -1247,12 +1244,8 @@ gst_mfx_decoder_flush (GstMfxDecoder * decoder)
   } while (MFX_WRN_DEVICE_BUSY == sts);
 
   if (syncp) {
-    do {
-      sts = MFXVideoCORE_SyncOperation (decoder->session, syncp, 1000);
-      GST_DEBUG ("MFXVideoCORE_SyncOperation status: %d", sts);
-    } while (MFX_WRN_IN_EXECUTION == sts);
-
     surface = gst_mfx_surface_pool_find_surface (decoder->pool, outsurf);
+    gst_mfx_surface_set_syncpoint (surface, decoder->session, syncp);
 
     if (decoder->filter) {
       do {
@@ -1283,3 +1276,12 @@ gst_mfx_decoder_reset_async_depth (GstMfxDecoder *decoder, mfxU16 async_depth)
 {
    decoder->params.AsyncDepth = async_depth;
 }
+
+void
+gst_mfx_decoder_set_system_memory_params (GstMfxDecoder * decoder,
+    const GstMfxSystemMemoryParams * params)
+{
+  g_return_if_fail (decoder != NULL);
+
+  gst_mfx_task_set_system_memory_params (decoder->decode, params);
+}
@@ -117,6 +117,10 @@ gst_mfx_decoder_check_system_memory (GstMfxDecoder * decoder);
 void
 gst_mfx_decoder_reset_async_depth (GstMfxDecoder *decoder, mfxU16 async_depth);
 
+void
+gst_mfx_decoder_set_system_memory_params (GstMfxDecoder * decoder,
+    const GstMfxSystemMemoryParams * params);
+
 G_END_DECLS
 
 #endif /* GST_MFX_DECODER_H */
@@ -21,6 +21,7 @@
 #include <mfxplugin.h>
 #include "gstmfxencoder.h"
 #include "gstmfxencoder_priv.h"
+#include "gstmfxencodermeta.h"
 #include "gstmfxfilter.h"
 #include "gstmfxsurfacepool.h"
 #include "gstmfxsurface.h"
@@ -32,6 +33,117 @@
 #define DEFAULT_ENCODER_PRESET      GST_MFX_ENCODER_PRESET_MEDIUM
 #define DEFAULT_QUANTIZER           21
 #define DEFAULT_ASYNC_DEPTH         4
+#define DEFAULT_CHUNK_SIZE          120
+
+/* Coded data that fills less than this fraction of its chunk is copied
+ * into a buffer of its own, so that small frames queued downstream don't
+ * each hold on to a chunk sized for the largest ones */
+#define BITSTREAM_COPY_RATIO        4
+
+/* Pool of coded data storage. Chunks are wrapped without a copy in the
+ * buffers pushed downstream, and come back to the pool once released, so
+ * the pool is refcounted by its outstanding chunks */
+struct _GstMfxBitstreamPool
+{
+  gint ref_count;
+  GMutex lock;
+  GSList *free_chunks;
+  gsize chunk_size;
+};
+
+struct _GstMfxBitstreamChunk
+{
+  GstMfxBitstreamPool *pool;
+  gsize size;
+  guint8 *data;
+};
+
+static GstMfxBitstreamPool *
+bitstream_pool_new (gsize chunk_size)
+{
+  GstMfxBitstreamPool *const pool = g_slice_new0 (GstMfxBitstreamPool);
+
+  pool->ref_count = 1;
+  g_mutex_init (&pool->lock);
+  pool->chunk_size = chunk_size;
+  return pool;
+}
+
+static void
+bitstream_chunk_free (GstMfxBitstreamChunk * chunk)
+{
+  g_free (chunk->data);
+  g_slice_free (GstMfxBitstreamChunk, chunk);
+}
+
+static void
+bitstream_pool_unref (GstMfxBitstreamPool * pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->ref_count))
+    return;
+
+  g_slist_free_full (pool->free_chunks, (GDestroyNotify) bitstream_chunk_free);
+  g_mutex_clear (&pool->lock);
+  g_slice_free (GstMfxBitstreamPool, pool);
+}
+
+/* Sets the size of the chunks handed out from now on, dropping the
+ * smaller free ones */
+static void
+bitstream_pool_set_chunk_size (GstMfxBitstreamPool * pool, gsize chunk_size)
+{
+  GSList *free_chunks;
+
+  g_mutex_lock (&pool->lock);
+  pool->chunk_size = chunk_size;
+  free_chunks = pool->free_chunks;
+  pool->free_chunks = NULL;
+  g_mutex_unlock (&pool->lock);
+
+  g_slist_free_full (free_chunks, (GDestroyNotify) bitstream_chunk_free);
+}
+
+static GstMfxBitstreamChunk *
+bitstream_pool_acquire (GstMfxBitstreamPool * pool)
+{
+  GstMfxBitstreamChunk *chunk = NULL;
+  gsize chunk_size;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->free_chunks) {
+    chunk = pool->free_chunks->data;
+    pool->free_chunks =
+        g_slist_delete_link (pool->free_chunks, pool->free_chunks);
+  }
+  chunk_size = pool->chunk_size;
+  g_mutex_unlock (&pool->lock);
+
+  if (!chunk) {
+    chunk = g_slice_new (GstMfxBitstreamChunk);
+    chunk->size = chunk_size;
+    chunk->data = g_malloc (chunk_size);
+  }
+  chunk->pool = pool;
+  g_atomic_int_inc (&pool->ref_count);
+  return chunk;
+}
+
+static void
+bitstream_pool_release (GstMfxBitstreamChunk * chunk)
+{
+  GstMfxBitstreamPool *const pool = chunk->pool;
+
+  g_mutex_lock (&pool->lock);
+  if (chunk->size == pool->chunk_size) {
+    pool->free_chunks = g_slist_prepend (pool->free_chunks, chunk);
+    chunk = NULL;
+  }
+  g_mutex_unlock (&pool->lock);
+
+  if (chunk)
+    bitstream_chunk_free (chunk);
+  bitstream_pool_unref (pool);
+}
 
 /* Helper function to create a new encoder property object */
 static GstMfxEncoderPropData *
@@ -401,6 +513,47 @@ gst_mfx_encoder_properties_get_default (const GstMfxEncoderClass * klass)
           GST_MFX_TYPE_ENCODER_PRESET, DEFAULT_ENCODER_PRESET,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+ /**
+  * GstMfxEncoder:idr-on-reset
+  *
+  * Start a new IDR picture when a bitrate change is applied while
+  * encoding. Resolution changes always start one.
+  */
+  GST_MFX_ENCODER_PROPERTIES_APPEND (props,
+      GST_MFX_ENCODER_PROP_IDR_ON_RESET,
+      g_param_spec_boolean ("idr-on-reset",
+          "IDR on reset",
+          "Start a new IDR picture when applying bitrate changes while encoding",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+ /**
+  * GstMfxEncoder:sessions
+  *
+  * Number of encode sessions to split raw NV12 system memory input
+  * across, one chunk of frames at a time. Meant for offline encoding.
+  */
+  GST_MFX_ENCODER_PROPERTIES_APPEND (props,
+      GST_MFX_ENCODER_PROP_SESSIONS,
+      g_param_spec_uint ("sessions",
+          "Encode sessions",
+          "Number of sessions encoding chunks of the stream in parallel",
+          1, 16, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+ /**
+  * GstMfxEncoder:chunk-size
+  *
+  * Number of frames of a chunk when encoding with several sessions. Each
+  * chunk starts with an IDR picture, so this is best a multiple of the
+  * GOP size.
+  */
+  GST_MFX_ENCODER_PROPERTIES_APPEND (props,
+      GST_MFX_ENCODER_PROP_CHUNK_SIZE,
+      g_param_spec_uint ("chunk-size",
+          "Chunk size",
+          "Number of frames of a chunk when encoding with several sessions",
+          1, G_MAXUINT16, DEFAULT_CHUNK_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   return props;
 }
 
@@ -455,6 +608,21 @@ gst_mfx_encoder_set_frame_info (GstMfxEncoder * encoder)
   }
 }
 
+static void
+free_slots (GstMfxEncoder * encoder)
+{
+  guint i;
+
+  for (i = 0; i < encoder->num_slots; i++)
+    if (encoder->slots[i].chunk)
+      bitstream_pool_release (encoder->slots[i].chunk);
+  g_free (encoder->slots);
+  encoder->slots = NULL;
+  encoder->num_slots = 0;
+  encoder->slot_head = 0;
+  encoder->num_busy_slots = 0;
+}
+
 static void
 init_encoder_task (GstMfxEncoder * encoder)
 {
@@ -525,11 +693,7 @@ gst_mfx_encoder_init_properties (GstMfxEncoder * encoder,
   if (!encoder->encode)
     return FALSE;
 
-  encoder->bs.MaxLength = info->width * info->height * 4;
-  encoder->bitstream = g_byte_array_sized_new (encoder->bs.MaxLength);
-  if (!encoder->bitstream)
-    return FALSE;
-  encoder->bs.Data = encoder->bitstream->data;
+  encoder->bs_pool = bitstream_pool_new (info->width * info->height * 4);
   encoder->async_depth = DEFAULT_ASYNC_DEPTH;
 
   encoder->info = *info;
@@ -590,7 +754,9 @@ gst_mfx_encoder_finalize (GstMfxEncoder * encoder)
 
   klass->finalize (encoder);
 
-  g_byte_array_unref (encoder->bitstream);
+  free_slots (encoder);
+  if (encoder->bs_pool)
+    bitstream_pool_unref (encoder->bs_pool);
   gst_mfx_task_aggregator_unref (encoder->aggregator);
 
   if (encoder->properties) {
@@ -599,6 +765,8 @@ gst_mfx_encoder_finalize (GstMfxEncoder * encoder)
   }
 
   MFXVideoENCODE_Close (encoder->session);
+  g_list_free_full (encoder->locked_surfaces,
+      (GDestroyNotify) gst_mfx_surface_unref);
 
   gst_mfx_filter_replace (&encoder->filter, NULL);
   gst_mfx_task_replace (&encoder->encode, NULL);
@@ -910,6 +1078,25 @@ gst_mfx_encoder_set_encoding_params (GstMfxEncoder * encoder)
   }
 }
 
+/* Reads back the parameters the session runs with */
+static void
+update_video_params (GstMfxEncoder * encoder)
+{
+  memset (&encoder->params, 0, sizeof(mfxVideoParam));
+  MFXVideoENCODE_GetVideoParam (encoder->session, &encoder->params);
+
+  /* Size the coded data storage from the buffer the encoder asks for, so
+   * that frames rarely need a second attempt with a larger one */
+  if (encoder->params.mfx.BufferSizeInKB) {
+    gsize buffer_size = (gsize) encoder->params.mfx.BufferSizeInKB * 1000 *
+        MAX (encoder->params.mfx.BRCParamMultiplier, 1);
+
+    GST_DEBUG ("sizing bitstream buffers to %" G_GSIZE_FORMAT " bytes",
+        buffer_size);
+    bitstream_pool_set_chunk_size (encoder->bs_pool, buffer_size);
+  }
+}
+
 GstMfxEncoderStatus
 gst_mfx_encoder_start (GstMfxEncoder *encoder)
 {
@@ -1017,8 +1204,13 @@ gst_mfx_encoder_start (GstMfxEncoder *encoder)
     return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
   }
 
-  memset (&encoder->params, 0, sizeof(mfxVideoParam));
-  MFXVideoENCODE_GetVideoParam (encoder->session, &encoder->params);
+  update_video_params (encoder);
+  encoder->reset_pending = FALSE;
+
+  /* One slot per operation the encoder runs ahead of synchronization */
+  free_slots (encoder);
+  encoder->num_slots = MAX (encoder->params.AsyncDepth, 1);
+  encoder->slots = g_new0 (GstMfxEncoderSlot, encoder->num_slots);
 
   GST_INFO ("Initialized MFX encoder task using input %s memory surfaces",
     memtype_is_system ? "system" : "video");
@@ -1027,11 +1219,298 @@ gst_mfx_encoder_start (GstMfxEncoder *encoder)
 }
 
 static void
-calculate_new_pts_and_dts (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
+calculate_new_pts_and_dts (GstMfxEncoder * encoder, GstVideoCodecFrame * frame,
+    const mfxBitstream * bs)
 {
   frame->duration = encoder->duration;
-  frame->pts = (encoder->bs.TimeStamp / (gdouble) 90000) * 1000000000;
-  frame->dts = (encoder->bs.DecodeTimeStamp / (gdouble) 90000) * 1000000000;
+  frame->pts = (bs->TimeStamp / (gdouble) 90000) * 1000000000;
+  frame->dts = (bs->DecodeTimeStamp / (gdouble) 90000) * 1000000000;
+}
+
+/* Input surfaces stay locked by the encoder until the operations that
+ * read them, which may be later ones when frames are reordered, are
+ * complete */
+static void
+release_unlocked_surfaces (GstMfxEncoder * encoder)
+{
+  GList *l = encoder->locked_surfaces;
+
+  while (l) {
+    GList *const next = l->next;
+    GstMfxSurface *const surface = l->data;
+
+    if (!gst_mfx_surface_get_frame_surface (surface)->Data.Locked) {
+      gst_mfx_surface_unref (surface);
+      encoder->locked_surfaces =
+          g_list_delete_link (encoder->locked_surfaces, l);
+    }
+    l = next;
+  }
+}
+
+/* Maps the GstVideoRegionOfInterestMeta of @buffer to @roi, with the
+ * rectangles widened to whole coding blocks. Returns FALSE if there are
+ * no regions to encode differently */
+static gboolean
+set_roi_params (GstMfxEncoder * encoder, mfxExtEncoderROI * roi,
+    GstBuffer * buffer)
+{
+  const mfxFrameInfo *const info = &encoder->params.mfx.FrameInfo;
+  const guint block_size = MFX_CODEC_HEVC == encoder->codec ? 32 : 16;
+  gboolean use_qp = GST_MFX_RATECONTROL_CQP == encoder->rc_method;
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  if (!encoder->roi_delta_qp || !buffer)
+    return FALSE;
+
+  roi->NumROI = 0;
+
+  while ((meta = gst_buffer_iterate_meta (buffer, &state))
+      && roi->NumROI < G_N_ELEMENTS (roi->ROI)) {
+    GstVideoRegionOfInterestMeta *rmeta;
+    guint left, top, right, bottom;
+
+    if (meta->info->api != GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE)
+      continue;
+    rmeta = (GstVideoRegionOfInterestMeta *) meta;
+
+    left = GST_ROUND_DOWN_N (MIN (rmeta->x, info->CropW), block_size);
+    top = GST_ROUND_DOWN_N (MIN (rmeta->y, info->CropH), block_size);
+    right = MIN (GST_ROUND_UP_N (MIN (rmeta->x + rmeta->w, info->CropW),
+            block_size), info->Width);
+    bottom = MIN (GST_ROUND_UP_N (MIN (rmeta->y + rmeta->h, info->CropH),
+            block_size), info->Height);
+    if (right <= left || bottom <= top)
+      continue;
+
+    memset (&roi->ROI[roi->NumROI], 0, sizeof (roi->ROI[0]));
+    roi->ROI[roi->NumROI].Left = left;
+    roi->ROI[roi->NumROI].Top = top;
+    roi->ROI[roi->NumROI].Right = right;
+    roi->ROI[roi->NumROI].Bottom = bottom;
+    /* Bitrate controlled modes take a priority from -3 to 3 instead */
+    roi->ROI[roi->NumROI].Priority = use_qp ? encoder->roi_delta_qp :
+        CLAMP (-encoder->roi_delta_qp, -3, 3);
+    roi->NumROI++;
+  }
+
+  if (!roi->NumROI)
+    return FALSE;
+
+  roi->Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+  roi->Header.BufferSz = sizeof (mfxExtEncoderROI);
+#if MSDK_CHECK_VERSION(1,22)
+  roi->ROIMode = use_qp ? MFX_ROI_MODE_QP_DELTA : MFX_ROI_MODE_PRIORITY;
+#endif
+  return TRUE;
+}
+
+/* Sets up the controls of @slot for @frame. Returns NULL when the frame
+ * is encoded with the session parameters alone */
+static mfxEncodeCtrl *
+prepare_encode_ctrl (GstMfxEncoder * encoder, GstMfxEncoderSlot * slot,
+    GstVideoCodecFrame * frame)
+{
+  mfxEncodeCtrl *const ctrl = &slot->ctrl;
+
+  if (!frame)
+    return NULL;
+
+  memset (ctrl, 0, sizeof (mfxEncodeCtrl));
+  ctrl->ExtParam = slot->ctrl_params;
+
+  /* Start a new GOP on the frames downstream asked a key unit for, so that
+   * receivers joining or recovering from losses do not wait for the next
+   * one */
+  if (GST_VIDEO_CODEC_FRAME_IS_FORCE_KEYFRAME (frame)
+      && encoder->codec != MFX_CODEC_JPEG) {
+    ctrl->FrameType = MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF;
+    if (MFX_CODEC_AVC == encoder->codec || MFX_CODEC_HEVC == encoder->codec)
+      ctrl->FrameType |= MFX_FRAMETYPE_IDR;
+    GST_DEBUG ("forcing key frame %u", frame->system_frame_number);
+  }
+
+  if (set_roi_params (encoder, &slot->roi, frame->input_buffer))
+    ctrl->ExtParam[ctrl->NumExtParam++] = (mfxExtBuffer *) &slot->roi;
+
+  return (ctrl->FrameType || ctrl->NumExtParam) ? ctrl : NULL;
+}
+
+/* Submits @insurf of @frame, or drains the encoder if %NULL, into the next
+ * free slot. The slot becomes busy if an operation was started */
+static mfxStatus
+submit_slot (GstMfxEncoder * encoder, GstVideoCodecFrame * frame,
+    mfxFrameSurface1 * insurf)
+{
+  GstMfxEncoderSlot *const slot = &encoder->slots[(encoder->slot_head +
+          encoder->num_busy_slots) % encoder->num_slots];
+  mfxEncodeCtrl *const ctrl = prepare_encode_ctrl (encoder, slot, frame);
+  mfxStatus sts;
+
+  if (!slot->chunk)
+    slot->chunk = bitstream_pool_acquire (encoder->bs_pool);
+  slot->submit_time = g_get_monotonic_time ();
+  slot->done_time = 0;
+
+  do {
+    memset (&slot->bs, 0, sizeof (mfxBitstream));
+    slot->bs.Data = slot->chunk->data;
+    slot->bs.MaxLength = slot->chunk->size;
+    slot->syncp = NULL;
+#if MSDK_CHECK_VERSION(1,8)
+    /* The AVC encoder reports the QP of the picture along with it */
+    if (MFX_CODEC_AVC == encoder->codec) {
+      memset (&slot->frame_info, 0, sizeof (mfxExtAVCEncodedFrameInfo));
+      slot->frame_info.Header.BufferId = MFX_EXTBUFF_ENCODED_FRAME_INFO;
+      slot->frame_info.Header.BufferSz = sizeof (mfxExtAVCEncodedFrameInfo);
+      slot->bs_params[0] = (mfxExtBuffer *) &slot->frame_info;
+      slot->bs.ExtParam = slot->bs_params;
+      slot->bs.NumExtParam = 1;
+    }
+#endif
+
+    sts = MFXVideoENCODE_EncodeFrameAsync (encoder->session,
+            ctrl, insurf, &slot->bs, &slot->syncp);
+
+    if (MFX_WRN_DEVICE_BUSY == sts)
+      g_usleep (500);
+    else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
+      /* Grow geometrically so that the retries stay few */
+      GST_DEBUG ("bitstream buffer of %" G_GSIZE_FORMAT " bytes too small",
+          slot->chunk->size);
+      bitstream_pool_set_chunk_size (encoder->bs_pool,
+          MAX (slot->chunk->size * 2, encoder->bs_pool->chunk_size));
+      bitstream_pool_release (slot->chunk);
+      slot->chunk = bitstream_pool_acquire (encoder->bs_pool);
+    }
+  } while (MFX_WRN_DEVICE_BUSY == sts || MFX_ERR_NOT_ENOUGH_BUFFER == sts);
+
+  if (slot->syncp)
+    encoder->num_busy_slots++;
+  return sts;
+}
+
+/* Attaches the results of the operation of @slot to its coded data */
+static void
+add_stats_meta (GstMfxEncoder * encoder, GstMfxEncoderSlot * slot,
+    GstBuffer * buffer)
+{
+  GstMfxEncoderStatsMeta *const meta =
+      gst_buffer_add_mfx_encoder_stats_meta (buffer);
+  const mfxU16 frame_type = slot->bs.FrameType;
+
+  meta->frame_type = frame_type;
+  meta->size = slot->bs.DataLength;
+  meta->encode_time = (slot->done_time - slot->submit_time) * GST_USECOND;
+
+  if (MFX_CODEC_JPEG == encoder->codec)
+    return;
+
+  /* Constant QP pictures are coded with the QP of their type */
+  if (GST_MFX_RATECONTROL_CQP == encoder->rc_method) {
+    if (frame_type & MFX_FRAMETYPE_I)
+      meta->qp = encoder->params.mfx.QPI;
+    else if (frame_type & MFX_FRAMETYPE_P)
+      meta->qp = encoder->params.mfx.QPP;
+    else
+      meta->qp = encoder->params.mfx.QPB;
+  }
+#if MSDK_CHECK_VERSION(1,8)
+  else if (slot->bs.NumExtParam)
+    meta->qp = slot->frame_info.QP;
+#endif
+}
+
+/* Notes the time the operations in flight completed at, without waiting
+ * for them. Their coded data is only taken once the ring is full, so this
+ * keeps the time spent waiting in the ring out of their encode time */
+static void
+poll_slots (GstMfxEncoder * encoder)
+{
+  guint i;
+
+  for (i = 0; i < encoder->num_busy_slots; i++) {
+    GstMfxEncoderSlot *const slot =
+        &encoder->slots[(encoder->slot_head + i) % encoder->num_slots];
+
+    if (!slot->done_time
+        && MFX_ERR_NONE == MFXVideoCORE_SyncOperation (encoder->session,
+            slot->syncp, 0))
+      slot->done_time = g_get_monotonic_time ();
+  }
+}
+
+/* Waits for the oldest operation in flight and lends its coded data to
+ * @frame. Small coded data is copied instead, otherwise the slot gets new
+ * storage from the pool on its next use */
+static GstMfxEncoderStatus
+complete_slot (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
+{
+  GstMfxEncoderSlot *const slot = &encoder->slots[encoder->slot_head];
+  mfxStatus sts = MFX_ERR_NONE;
+
+  /* An operation already seen completed is not waited for again */
+  if (!slot->done_time) {
+    do {
+      sts = MFXVideoCORE_SyncOperation (encoder->session, slot->syncp, 1000);
+    } while (MFX_WRN_IN_EXECUTION == sts);
+    slot->done_time = g_get_monotonic_time ();
+  }
+
+  slot->syncp = NULL;
+  encoder->slot_head = (encoder->slot_head + 1) % encoder->num_slots;
+  encoder->num_busy_slots--;
+  release_unlocked_surfaces (encoder);
+
+  if (MFX_ERR_NONE != sts)
+    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+
+  /* Keep twice the largest frame seen as headroom, so that steady state
+   * encoding never runs out of buffer */
+  if (slot->bs.DataLength > encoder->max_frame_size) {
+    encoder->max_frame_size = slot->bs.DataLength;
+    if (2 * (gsize) encoder->max_frame_size > encoder->bs_pool->chunk_size)
+      bitstream_pool_set_chunk_size (encoder->bs_pool,
+          2 * (gsize) encoder->max_frame_size);
+  }
+
+  if ((gsize) slot->bs.DataLength * BITSTREAM_COPY_RATIO < slot->chunk->size) {
+    frame->output_buffer =
+        gst_buffer_new_allocate (NULL, slot->bs.DataLength, NULL);
+    if (!frame->output_buffer)
+      return GST_MFX_ENCODER_STATUS_ERROR_ALLOCATION_FAILED;
+    gst_buffer_fill (frame->output_buffer, 0,
+        slot->chunk->data + slot->bs.DataOffset, slot->bs.DataLength);
+
+    /* The slot keeps its chunk for the next operation, unless the pool
+     * has moved on to larger ones */
+    if (slot->chunk->size != encoder->bs_pool->chunk_size) {
+      bitstream_pool_release (slot->chunk);
+      slot->chunk = NULL;
+    }
+  }
+  else {
+    /* The chunk belongs to the buffer alone, so leave it writable for the
+     * in-place repackaging of the coded data downstream */
+    frame->output_buffer =
+        gst_buffer_new_wrapped_full (0,
+          slot->chunk->data, slot->chunk->size,
+          slot->bs.DataOffset, slot->bs.DataLength, slot->chunk,
+          (GDestroyNotify) bitstream_pool_release);
+    slot->chunk = NULL;
+  }
+  add_stats_meta (encoder, slot, frame->output_buffer);
+
+  calculate_new_pts_and_dts (encoder, frame, &slot->bs);
+
+  if (slot->bs.FrameType & MFX_FRAMETYPE_IDR
+      || slot->bs.FrameType & MFX_FRAMETYPE_xIDR)
+    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
+  else
+    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
+
+  return GST_MFX_ENCODER_STATUS_SUCCESS;
 }
 
 GstMfxEncoderStatus
@@ -1039,8 +1518,8 @@ gst_mfx_encoder_encode (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
 {
   GstMfxSurface *surface, *filter_surface;
   GstMfxFilterStatus filter_sts;
+  GstMfxEncoderStatus status = GST_MFX_ENCODER_STATUS_MORE_DATA;
   mfxFrameSurface1 *insurf;
-  mfxSyncPoint syncp;
   mfxStatus sts = MFX_ERR_NONE;
 
   surface = gst_video_codec_frame_get_user_data (frame);
@@ -1055,6 +1534,12 @@ gst_mfx_encoder_encode (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
     surface = filter_surface;
   }
 
+  /* Surfaces produced outside the sessions of the aggregator, e.g. by the
+   * upstream element for an encoder running a chunk session of its own,
+   * are not ordered by the SDK before the encode operation */
+  if (!gst_mfx_surface_sync_for_aggregator (surface, encoder->aggregator))
+    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+
   insurf = gst_mfx_surface_get_frame_surface (surface);
 
   if (!GST_CLOCK_TIME_IS_VALID(encoder->current_pts))
@@ -1067,108 +1552,190 @@ gst_mfx_encoder_encode (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
       gst_util_uint64_scale (encoder->current_pts, 90000, GST_SECOND);
   encoder->current_pts += encoder->duration;
 
-  do {
-    sts = MFXVideoENCODE_EncodeFrameAsync (encoder->session,
-            NULL, insurf, &encoder->bs, &syncp);
+  /* Only wait for an operation once the ring is full, so that up to
+   * async-depth frames are encoded in parallel */
+  poll_slots (encoder);
+  if (encoder->num_busy_slots == encoder->num_slots) {
+    status = complete_slot (encoder, frame);
+    if (GST_MFX_ENCODER_STATUS_SUCCESS != status)
+      return status;
+  }
 
-    if (MFX_WRN_DEVICE_BUSY == sts)
-      g_usleep (500);
-    else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-      encoder->bs.MaxLength += 1024 * 16;
-      encoder->bitstream = g_byte_array_set_size (encoder->bitstream,
-          encoder->bs.MaxLength);
-      encoder->bs.Data = encoder->bitstream->data;
-    }
-  } while (MFX_WRN_DEVICE_BUSY == sts || MFX_ERR_NOT_ENOUGH_BUFFER == sts);
+  sts = submit_slot (encoder, frame, insurf);
 
   if (MFX_ERR_MORE_BITSTREAM == sts)
     return GST_MFX_ENCODER_STATUS_NO_BUFFER;
-  else if (MFX_ERR_MORE_DATA == sts)
-    return GST_MFX_ENCODER_STATUS_MORE_DATA;
 
   if (sts != MFX_ERR_NONE
-      && sts != MFX_ERR_MORE_BITSTREAM
+      && sts != MFX_ERR_MORE_DATA
       && sts != MFX_WRN_VIDEO_PARAM_CHANGED) {
     GST_ERROR ("Error during MFX encoding.");
     return GST_MFX_ENCODER_STATUS_ERROR_UNKNOWN;
   }
 
-  if (syncp) {
-    do {
-      sts = MFXVideoCORE_SyncOperation (encoder->session, syncp, 1000);
-    } while (MFX_WRN_IN_EXECUTION == sts);
+  encoder->locked_surfaces = g_list_prepend (encoder->locked_surfaces,
+      gst_mfx_surface_ref (surface));
 
-    frame->output_buffer =
-        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-          encoder->bs.Data, encoder->bs.MaxLength,
-          encoder->bs.DataOffset, encoder->bs.DataLength, NULL, NULL);
+  return status;
+}
 
-    calculate_new_pts_and_dts (encoder, frame);
+/**
+ * gst_mfx_encoder_flush:
+ * @encoder: a #GstMfxEncoder
+ * @frame: the #GstVideoCodecFrame to receive the coded data
+ *
+ * Drains one coded picture of the frames @encoder still holds, and lends
+ * it to @frame with its timestamps and sync point flag. Pictures come out
+ * in the order their frames went in, so @frame is normally the oldest
+ * frame that has no coded data yet.
+ *
+ * Return value: %GST_MFX_ENCODER_STATUS_SUCCESS if @frame got coded data,
+ *   or an error once @encoder holds no more frames
+ */
+GstMfxEncoderStatus
+gst_mfx_encoder_flush (GstMfxEncoder * encoder, GstVideoCodecFrame * frame)
+{
+  mfxStatus sts;
 
-    encoder->bs.DataLength = 0;
-  }
+  g_return_val_if_fail (encoder != NULL,
+      GST_MFX_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
+  g_return_val_if_fail (frame != NULL,
+      GST_MFX_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
 
-  if (encoder->bs.FrameType & MFX_FRAMETYPE_IDR
-      || encoder->bs.FrameType & MFX_FRAMETYPE_xIDR)
-    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
-  else
-    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
+  if (!encoder->num_slots)
+    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
 
-  return GST_MFX_ENCODER_STATUS_SUCCESS;
+  /* Complete the operations in flight before draining the encoder */
+  if (!encoder->num_busy_slots) {
+    sts = submit_slot (encoder, NULL, NULL);
+    if (MFX_ERR_NONE != sts || !encoder->num_busy_slots)
+      return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  }
+
+  return complete_slot (encoder, frame);
 }
 
-GstMfxEncoderStatus
-gst_mfx_encoder_flush (GstMfxEncoder * encoder, GstVideoCodecFrame ** frame)
+/* Expresses a BRC parameter counted in units of @from in units of @to */
+static mfxU16
+rescale_brc_param (mfxU16 value, mfxU16 from, mfxU16 to)
 {
-  mfxSyncPoint syncp;
-  mfxStatus sts = MFX_ERR_NONE;
+  return MIN ((guint32) value * MAX (from, 1) / MAX (to, 1), G_MAXUINT16);
+}
 
-  do {
-    sts = MFXVideoENCODE_EncodeFrameAsync (encoder->session,
-            NULL, NULL, &encoder->bs, &syncp);
+/**
+ * gst_mfx_encoder_needs_reset:
+ * @encoder: a #GstMfxEncoder
+ *
+ * Checks whether bitrate or resolution changes were made since @encoder
+ * started, which gst_mfx_encoder_reset() applies.
+ *
+ * Return value: %TRUE if @encoder has changes to apply
+ */
+gboolean
+gst_mfx_encoder_needs_reset (GstMfxEncoder * encoder)
+{
+  g_return_val_if_fail (encoder != NULL, FALSE);
 
-    if (MFX_WRN_DEVICE_BUSY == sts)
-      g_usleep (500);
-    else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-      encoder->bs.MaxLength += 1024 * 16;
-      encoder->bitstream = g_byte_array_set_size (encoder->bitstream,
-          encoder->bs.MaxLength);
-      encoder->bs.Data = encoder->bitstream->data;
-    }
-  } while (MFX_WRN_DEVICE_BUSY == sts || MFX_ERR_NOT_ENOUGH_BUFFER == sts);
+  return encoder->reset_pending;
+}
 
-  if (MFX_ERR_NONE != sts)
-    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+/**
+ * gst_mfx_encoder_reset:
+ * @encoder: a #GstMfxEncoder
+ *
+ * Applies the pending bitrate and resolution changes to the running
+ * session, without reallocating it nor its surfaces. @encoder must have
+ * been drained with gst_mfx_encoder_flush() beforehand.
+ *
+ * Return value: a #GstMfxEncoderStatus
+ */
+GstMfxEncoderStatus
+gst_mfx_encoder_reset (GstMfxEncoder * encoder)
+{
+  mfxVideoParam params;
+  mfxStatus sts;
+#if MSDK_CHECK_VERSION(1,7)
+  mfxExtEncoderResetOption reset_option;
+  mfxExtBuffer *extparams[1];
+#endif
 
-  if (syncp) {
-    do {
-      sts = MFXVideoCORE_SyncOperation (encoder->session, syncp, 1000);
-    } while (MFX_WRN_IN_EXECUTION == sts);
+  g_return_val_if_fail (encoder != NULL,
+      GST_MFX_ENCODER_STATUS_ERROR_INVALID_PARAMETER);
 
-    if (MFX_ERR_NONE != sts)
-      return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+  if (!encoder->reset_pending)
+    return GST_MFX_ENCODER_STATUS_SUCCESS;
+  if (!encoder->num_slots || encoder->num_busy_slots)
+    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
 
-    *frame = g_slice_new0 (GstVideoCodecFrame);
+  params = encoder->params;
+
+  if (encoder->codec != MFX_CODEC_JPEG && encoder->bitrate
+      && encoder->rc_method != GST_MFX_RATECONTROL_CQP
+      && encoder->rc_method != GST_MFX_RATECONTROL_ICQ
+      && encoder->rc_method != GST_MFX_RATECONTROL_LA_ICQ) {
+    mfxU16 multiplier = params.mfx.BRCParamMultiplier;
+
+    params.mfx.BRCParamMultiplier = encoder->brc_multiplier;
+    params.mfx.BufferSizeInKB = rescale_brc_param (params.mfx.BufferSizeInKB,
+        multiplier, encoder->brc_multiplier);
+    params.mfx.InitialDelayInKB =
+        rescale_brc_param (params.mfx.InitialDelayInKB, multiplier,
+        encoder->brc_multiplier);
+    params.mfx.TargetKbps = encoder->bitrate;
+    if (encoder->vbv_max_bitrate > encoder->bitrate)
+      params.mfx.MaxKbps = encoder->vbv_max_bitrate;
+    else
+      params.mfx.MaxKbps = MAX (encoder->bitrate,
+          rescale_brc_param (params.mfx.MaxKbps, multiplier,
+              encoder->brc_multiplier));
+  }
 
-    (*frame)->output_buffer =
-        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-          encoder->bs.Data, encoder->bs.MaxLength,
-          encoder->bs.DataOffset, encoder->bs.DataLength, NULL, NULL);
+#if MSDK_CHECK_VERSION(1,7)
+  if (encoder->reset_new_sequence || encoder->idr_on_reset) {
+    memset (&reset_option, 0, sizeof (reset_option));
+    reset_option.Header.BufferId = MFX_EXTBUFF_ENCODER_RESET_OPTION;
+    reset_option.Header.BufferSz = sizeof (reset_option);
+    reset_option.StartNewSequence = MFX_CODINGOPTION_ON;
 
-    calculate_new_pts_and_dts (encoder, *frame);
+    extparams[0] = (mfxExtBuffer *) &reset_option;
+    params.ExtParam = extparams;
+    params.NumExtParam = 1;
+  }
+#endif
 
-    encoder->bs.DataLength = 0;
+  sts = MFXVideoENCODE_Reset (encoder->session, &params);
+  if (sts < 0) {
+    GST_ERROR ("Error resetting the MFX video encoder %d", sts);
+    return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
   }
 
-  if (encoder->bs.FrameType & MFX_FRAMETYPE_IDR
-      || encoder->bs.FrameType & MFX_FRAMETYPE_xIDR)
-    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (*frame);
-  else
-    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (*frame);
+  update_video_params (encoder);
+  encoder->reset_pending = FALSE;
+  encoder->reset_new_sequence = FALSE;
+
+  GST_INFO ("Reset MFX encoder to %ux%u at %u kbps",
+      encoder->params.mfx.FrameInfo.CropW, encoder->params.mfx.FrameInfo.CropH,
+      encoder->params.mfx.TargetKbps);
 
   return GST_MFX_ENCODER_STATUS_SUCCESS;
 }
 
+/**
+ * gst_mfx_encoder_request_new_sequence:
+ * @encoder: a #GstMfxEncoder
+ *
+ * Makes the next gst_mfx_encoder_reset() start a new sequence, which
+ * begins with an IDR picture and references no frame encoded before.
+ */
+void
+gst_mfx_encoder_request_new_sequence (GstMfxEncoder * encoder)
+{
+  g_return_if_fail (encoder != NULL);
+
+  encoder->reset_pending = TRUE;
+  encoder->reset_new_sequence = TRUE;
+}
+
 /**
  * gst_mfx_encoder_set_property:
  * @encoder: a #GstMfxEncoder
@@ -1205,12 +1772,16 @@ set_property (GstMfxEncoder * encoder, gint prop_id, const GValue * value)
       encoder->rc_method = g_value_get_enum (value);
       break;
     case GST_MFX_ENCODER_PROP_BITRATE:
+      if (encoder->bitrate != g_value_get_uint (value))
+        encoder->reset_pending = TRUE;
       encoder->bitrate = g_value_get_uint (value);
       break;
     case GST_MFX_ENCODER_PROP_MAX_BUFFER_SIZE:
       encoder->max_buffer_size = g_value_get_uint (value);
       break;
     case GST_MFX_ENCODER_PROP_VBV_MAX_BITRATE:
+      if (encoder->vbv_max_bitrate != g_value_get_uint (value))
+        encoder->reset_pending = TRUE;
       encoder->vbv_max_bitrate = g_value_get_uint (value);
       break;
     case GST_MFX_ENCODER_PROP_BRC_MULTIPLIER:
@@ -1277,6 +1848,13 @@ set_property (GstMfxEncoder * encoder, gint prop_id, const GValue * value)
       success = gst_mfx_encoder_set_async_depth (encoder,
           g_value_get_uint (value));
       break;
+    case GST_MFX_ENCODER_PROP_IDR_ON_RESET:
+      encoder->idr_on_reset = g_value_get_boolean (value);
+      break;
+    case GST_MFX_ENCODER_PROP_SESSIONS:
+    case GST_MFX_ENCODER_PROP_CHUNK_SIZE:
+      /* Handled by the element, which runs one encoder per session */
+      break;
     default:
       success = FALSE;
       break;
@@ -1340,6 +1918,22 @@ error_invalid_framerate:
   }
 }
 
+/* Checks whether the running session can switch to @vip in place. It keeps
+ * the input surfaces and processing it was initialized with, so only the
+ * resolution and framerate may change, within the initial resolution */
+static gboolean
+can_reset_video_info (GstMfxEncoder * encoder, const GstVideoInfo * vip)
+{
+  if (encoder->shared || encoder->filter)
+    return FALSE;
+  if (GST_VIDEO_INFO_FORMAT (vip) != GST_VIDEO_INFO_FORMAT (&encoder->info)
+      || GST_VIDEO_INFO_INTERLACE_MODE (vip) !=
+          GST_VIDEO_INFO_INTERLACE_MODE (&encoder->info))
+    return FALSE;
+  return vip->width <= encoder->frame_info.CropW
+      && vip->height <= encoder->frame_info.CropH;
+}
+
 /**
  * gst_mfx_encoder_set_codec_state:
  * @encoder: a #GstMfxEncoder
@@ -1354,6 +1948,9 @@ error_invalid_framerate:
  * match the new properties and any other change beyond this point has
  * zero effect.
  *
+ * Once the encoder is started, only resolution and framerate changes
+ * which gst_mfx_encoder_reset() can apply are accepted.
+ *
  * Return value: a #GstMfxEncoderStatus
  */
 GstMfxEncoderStatus
@@ -1368,6 +1965,26 @@ gst_mfx_encoder_set_codec_state (GstMfxEncoder * encoder,
   GstMfxEncoderClass *const klass = GST_MFX_ENCODER_GET_CLASS (encoder);
   GstMfxEncoderStatus status;
 
+  if (encoder->num_slots) {
+    if (gst_video_info_is_equal (&state->info, &encoder->info))
+      return GST_MFX_ENCODER_STATUS_SUCCESS;
+    if (!can_reset_video_info (encoder, &state->info))
+      return GST_MFX_ENCODER_STATUS_ERROR_OPERATION_FAILED;
+
+    status = check_video_info (encoder, &state->info);
+    if (status != GST_MFX_ENCODER_STATUS_SUCCESS)
+      return status;
+    encoder->info = state->info;
+    if (encoder->info.fps_n)
+      encoder->duration =
+          (encoder->info.fps_d / (gdouble)encoder->info.fps_n) * 1000000000;
+
+    gst_mfx_encoder_set_frame_info (encoder);
+    encoder->reset_pending = TRUE;
+    encoder->reset_new_sequence = TRUE;
+    return GST_MFX_ENCODER_STATUS_SUCCESS;
+  }
+
   if (!gst_video_info_is_equal (&state->info, &encoder->info)) {
     status = check_video_info (encoder, &state->info);
     if (status != GST_MFX_ENCODER_STATUS_SUCCESS)
@@ -120,6 +120,9 @@ typedef enum {
   GST_MFX_ENCODER_PROP_ACCURACY,
   GST_MFX_ENCODER_PROP_CONVERGENCE,
   GST_MFX_ENCODER_PROP_ASYNC_DEPTH,
+  GST_MFX_ENCODER_PROP_IDR_ON_RESET,
+  GST_MFX_ENCODER_PROP_SESSIONS,
+  GST_MFX_ENCODER_PROP_CHUNK_SIZE,
 } GstMfxEncoderProp;
 
 /**
@@ -193,7 +196,16 @@ GstMfxEncoderStatus
 gst_mfx_encoder_encode (GstMfxEncoder * encoder, GstVideoCodecFrame * frame);
 
 GstMfxEncoderStatus
-gst_mfx_encoder_flush (GstMfxEncoder * encoder, GstVideoCodecFrame ** frame);
+gst_mfx_encoder_flush (GstMfxEncoder * encoder, GstVideoCodecFrame * frame);
+
+gboolean
+gst_mfx_encoder_needs_reset (GstMfxEncoder * encoder);
+
+GstMfxEncoderStatus
+gst_mfx_encoder_reset (GstMfxEncoder * encoder);
+
+void
+gst_mfx_encoder_request_new_sequence (GstMfxEncoder * encoder);
 
 G_END_DECLS
 
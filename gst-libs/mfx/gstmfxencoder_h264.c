@@ -250,6 +250,9 @@ gst_mfx_encoder_h264_set_property (GstMfxEncoder * base_encoder,
     case GST_MFX_ENCODER_H264_PROP_LOOKAHEAD_DS:
       base_encoder->look_ahead_downsampling = g_value_get_enum (value);
       break;
+    case GST_MFX_ENCODER_H264_PROP_ROI_DELTA_QP:
+      base_encoder->roi_delta_qp = g_value_get_int (value);
+      break;
     default:
       return GST_MFX_ENCODER_STATUS_ERROR_INVALID_PARAMETER;
   }
@@ -362,6 +365,20 @@ gst_mfx_encoder_h264_get_default_properties (void)
           GST_MFX_ENCODER_LOOKAHEAD_DS_AUTO,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMfxEncoderH264:roi-delta-qp
+   *
+   * QP delta applied to the regions of interest that upstream elements
+   * attach to frames as #GstVideoRegionOfInterestMeta. Bitrate controlled
+   * modes use its opposite, clamped to -3..3, as the region priority.
+   */
+  GST_MFX_ENCODER_PROPERTIES_APPEND (props,
+      GST_MFX_ENCODER_H264_PROP_ROI_DELTA_QP,
+      g_param_spec_int ("roi-delta-qp",
+          "ROI delta QP",
+          "QP delta for regions of interest (0: ignore regions of interest)",
+          -51, 51, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   return props;
 }
 
@@ -40,6 +40,7 @@ typedef struct _GstMfxEncoderH264 GstMfxEncoderH264;
  * @GST_MFX_ENCODER_H264_PROP_CABAC: Enable CABAC entropy coding mode (bool).
  * @GST_MFX_ENCODER_H264_PROP_TRELLIS:
  * @GST_MFX_ENCODER_H264_PROP_LOOKAHEAD_DS:
+ * @GST_MFX_ENCODER_H264_PROP_ROI_DELTA_QP:
  *
  * The set of H.264 encoder specific configurable properties.
  */
@@ -49,6 +50,7 @@ typedef enum {
   GST_MFX_ENCODER_H264_PROP_CABAC = -3,
   GST_MFX_ENCODER_H264_PROP_TRELLIS = -5,
   GST_MFX_ENCODER_H264_PROP_LOOKAHEAD_DS = -6,
+  GST_MFX_ENCODER_H264_PROP_ROI_DELTA_QP = -7,
 } GstMfxEncoderH264Prop;
 
 GstMfxEncoder *
@@ -34,12 +34,14 @@ typedef struct _GstMfxEncoderH265 GstMfxEncoderH265;
  * GstMfxEncoderH265Prop:
  * @GST_MFX_ENCODER_H265_PROP_LA_DEPTH:
  * @GST_MFX_ENCODER_H265_PROP_LOOKAHEAD_DS:
+ * @GST_MFX_ENCODER_H265_PROP_ROI_DELTA_QP:
  *
  * The set of H.265 encoder specific configurable properties.
  */
 typedef enum {
   GST_MFX_ENCODER_H265_PROP_LA_DEPTH = -1,
   GST_MFX_ENCODER_H265_PROP_LOOKAHEAD_DS = -2,
+  GST_MFX_ENCODER_H265_PROP_ROI_DELTA_QP = -3,
 } GstMfxEncoderH265Prop;
 
 GstMfxEncoder *
@@ -124,6 +124,31 @@ G_BEGIN_DECLS
 
 typedef struct _GstMfxEncoderClass GstMfxEncoderClass;
 typedef struct _GstMfxEncoderClassData GstMfxEncoderClassData;
+typedef struct _GstMfxBitstreamPool GstMfxBitstreamPool;
+typedef struct _GstMfxBitstreamChunk GstMfxBitstreamChunk;
+
+/* An encode operation in flight, with the pooled storage of its coded
+ * data. The storage is lent downstream once the operation completes,
+ * unless the coded data is small enough to be copied out */
+typedef struct {
+  mfxBitstream bs;
+  mfxSyncPoint syncp;
+  GstMfxBitstreamChunk *chunk;
+
+  /* Per-frame controls, which must outlive the operation */
+  mfxEncodeCtrl ctrl;
+  mfxExtEncoderROI roi;
+  mfxExtBuffer *ctrl_params[1];
+
+  /* Per-frame results, reported along with the coded data. The done time
+   * is 0 until the operation is seen completed */
+  gint64 submit_time;
+  gint64 done_time;
+#if MSDK_CHECK_VERSION(1,8)
+  mfxExtAVCEncodedFrameInfo frame_info;
+  mfxExtBuffer *bs_params[1];
+#endif
+} GstMfxEncoderSlot;
 
 /* Private GstMfxEncoderPropInfo definition */
 typedef struct {
@@ -155,14 +180,12 @@ struct _GstMfxEncoder
   GstMfxTaskAggregator   *aggregator;
   GstMfxTask             *encode;
   GstMfxFilter           *filter;
-  GByteArray             *bitstream;
   gboolean                memtype_is_system;
   gboolean                shared;
 
   mfxSession              session;
   mfxVideoParam           params;
   mfxFrameInfo            frame_info;
-  mfxBitstream            bs;
   mfxU32                  codec;
   gchar                  *plugin_uid;
   GstVideoInfo            info;
@@ -170,6 +193,19 @@ struct _GstMfxEncoder
   GstClockTime            current_pts;
   GstClockTime            duration;
 
+  /* Ring of encode operations in flight, oldest at slot_head */
+  GstMfxBitstreamPool    *bs_pool;
+  GstMfxEncoderSlot      *slots;
+  guint                   num_slots;
+  guint                   slot_head;
+  guint                   num_busy_slots;
+  GList                  *locked_surfaces;
+  mfxU32                  max_frame_size;
+
+  /* Changes waiting to be applied with MFXVideoENCODE_Reset */
+  gboolean                reset_pending;
+  gboolean                reset_new_sequence;
+
   /* Encoder params */
   GstMfxEncoderPreset     preset;
   GstMfxRateControl       rc_method;
@@ -191,6 +227,7 @@ struct _GstMfxEncoder
   mfxU16                  avbr_accuracy;
   mfxU16                  avbr_convergence;
   mfxU16                  jpeg_quality;
+  gboolean                idr_on_reset;
 
   mfxExtCodingOption      extco;
   mfxExtCodingOption2     extco2;
@@ -202,6 +239,9 @@ struct _GstMfxEncoder
   gboolean                use_cabac;
   gint                    max_slice_size;
 
+  /* QP delta for the regions of interest of a frame, 0 to ignore them */
+  gint                    roi_delta_qp;
+
   GstMfxOption            mbbrc;
   GstMfxOption            extbrc;
   GstMfxOption            b_strategy;
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+#include "gstmfxencodermeta.h"
+
+static gboolean
+gst_mfx_encoder_stats_meta_init (GstMfxEncoderStatsMeta * meta,
+    gpointer params, GstBuffer * buffer)
+{
+  meta->frame_type = 0;
+  meta->qp = -1;
+  meta->size = 0;
+  meta->encode_time = GST_CLOCK_TIME_NONE;
+  return TRUE;
+}
+
+static gboolean
+gst_mfx_encoder_stats_meta_transform (GstBuffer * dst_buffer, GstMeta * meta,
+    GstBuffer * src_buffer, GQuark type, gpointer data)
+{
+  GstMfxEncoderStatsMeta *const src_meta = (GstMfxEncoderStatsMeta *) meta;
+  GstMfxEncoderStatsMeta *dst_meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    dst_meta = gst_buffer_add_mfx_encoder_stats_meta (dst_buffer);
+    dst_meta->frame_type = src_meta->frame_type;
+    dst_meta->qp = src_meta->qp;
+    dst_meta->size = src_meta->size;
+    dst_meta->encode_time = src_meta->encode_time;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+GType
+gst_mfx_encoder_stats_meta_api_get_type (void)
+{
+  static gsize g_type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&g_type)) {
+    GType type =
+        gst_meta_api_type_register ("GstMfxEncoderStatsMetaAPI", tags);
+    g_once_init_leave (&g_type, type);
+  }
+  return g_type;
+}
+
+const GstMetaInfo *
+gst_mfx_encoder_stats_meta_get_info (void)
+{
+  static gsize g_meta_info;
+
+  if (g_once_init_enter (&g_meta_info)) {
+    gsize meta_info =
+        GPOINTER_TO_SIZE (gst_meta_register
+        (GST_MFX_ENCODER_STATS_META_API_TYPE, "GstMfxEncoderStatsMeta",
+            sizeof (GstMfxEncoderStatsMeta),
+            (GstMetaInitFunction) gst_mfx_encoder_stats_meta_init,
+            (GstMetaFreeFunction) NULL,
+            (GstMetaTransformFunction) gst_mfx_encoder_stats_meta_transform));
+    g_once_init_leave (&g_meta_info, meta_info);
+  }
+  return GSIZE_TO_POINTER (g_meta_info);
+}
+
+/**
+ * gst_buffer_add_mfx_encoder_stats_meta:
+ * @buffer: a #GstBuffer
+ *
+ * Attaches a #GstMfxEncoderStatsMeta to @buffer, to be filled in by the
+ * caller.
+ *
+ * Returns: (transfer none): the #GstMfxEncoderStatsMeta on @buffer
+ */
+GstMfxEncoderStatsMeta *
+gst_buffer_add_mfx_encoder_stats_meta (GstBuffer * buffer)
+{
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  return (GstMfxEncoderStatsMeta *) gst_buffer_add_meta (buffer,
+      gst_mfx_encoder_stats_meta_get_info (), NULL);
+}
+
+/**
+ * gst_buffer_get_mfx_encoder_stats_meta:
+ * @buffer: a #GstBuffer
+ *
+ * Returns: (transfer none): the #GstMfxEncoderStatsMeta of @buffer, or
+ *   %NULL if it has none
+ */
+GstMfxEncoderStatsMeta *
+gst_buffer_get_mfx_encoder_stats_meta (GstBuffer * buffer)
+{
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  return (GstMfxEncoderStatsMeta *) gst_buffer_get_meta (buffer,
+      GST_MFX_ENCODER_STATS_META_API_TYPE);
+}
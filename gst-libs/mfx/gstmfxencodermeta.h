@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_ENCODER_META_H
+#define GST_MFX_ENCODER_META_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_MFX_ENCODER_STATS_META_API_TYPE \
+  gst_mfx_encoder_stats_meta_api_get_type ()
+
+/**
+ * GstMfxEncoderStatsMeta:
+ * @meta: parent #GstMeta
+ * @frame_type: the MFX_FRAMETYPE_* flags the picture was coded with
+ * @qp: the average quantization parameter of the picture, or -1 if the
+ *   encoder did not report it
+ * @size: the size of the coded picture, in bytes
+ * @encode_time: the time from the submission of the picture to the
+ *   encoder to the completion of its operation. Completion is checked on
+ *   each frame submitted after it, so this can exceed the actual encode
+ *   time by up to one frame interval
+ *
+ * The results of encoding the picture held by a buffer.
+ */
+typedef struct {
+  GstMeta meta;
+
+  guint frame_type;
+  gint qp;
+  gsize size;
+  GstClockTime encode_time;
+} GstMfxEncoderStatsMeta;
+
+GType
+gst_mfx_encoder_stats_meta_api_get_type (void);
+
+const GstMetaInfo *
+gst_mfx_encoder_stats_meta_get_info (void);
+
+GstMfxEncoderStatsMeta *
+gst_buffer_add_mfx_encoder_stats_meta (GstBuffer * buffer);
+
+GstMfxEncoderStatsMeta *
+gst_buffer_get_mfx_encoder_stats_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* GST_MFX_ENCODER_META_H */
@@ -78,6 +78,22 @@ struct _GstMfxFilter
 
   mfxExtBuffer **ext_buffer;
   mfxExtVPPDoUse vpp_use;
+
+  /* Scaler configuration, not a filter algorithm of its own */
+  GstMfxScalingMode scaling_mode;
+  GstMfxInterpolationMethod interpolation;
+#if MSDK_CHECK_VERSION(1,19)
+  mfxExtVPPScaling ext_scaling;
+#endif
+
+  /* Parameters changed since the last init / reset, applied to the next
+   * processed frame */
+  guint pending_ops;
+  gboolean needs_reset;
+  mfxExtVPPProcAmp frame_procamp;
+  mfxExtVPPDenoise frame_denoise;
+  mfxExtVPPDetail frame_detail;
+  mfxExtBuffer *frame_ext_buf[8];
 };
 
 static const GstMfxFilterMap filter_map[] = {
@@ -188,49 +204,71 @@ configure_filters (GstMfxFilter * filter)
 {
   GstMfxFilterOpData *op;
   mfxExtBuffer *ext_buf;
-  guint i, len;
+  guint i, len, num_ext;
   len = filter->filter_op_data->len;
 
   if (!filter->inited) {
     check_supported_filters (filter);
   }
 
-  /* If AlgList is available when filter is already initialized
-  and if current number of filter is not equal to new number of
-  filter requested, deallocate resources when resetting */
-  if (filter->vpp_use.AlgList &&
-      (len != filter->vpp_use.NumAlg)) {
-    g_slice_free1 ((filter->vpp_use.NumAlg * sizeof (mfxU32)),
-        filter->vpp_use.AlgList);
-    g_slice_free1 (((filter->vpp_use.NumAlg + 1) * sizeof (mfxExtBuffer *)),
+  /* Release the buffers of the previous configuration when resetting */
+  if (filter->ext_buffer) {
+    if (filter->vpp_use.AlgList)
+      g_slice_free1 ((filter->vpp_use.NumAlg * sizeof (mfxU32)),
+          filter->vpp_use.AlgList);
+    g_slice_free1 ((filter->params.NumExtParam * sizeof (mfxExtBuffer *)),
         filter->ext_buffer);
+    filter->ext_buffer = NULL;
+    filter->params.NumExtParam = 0;
+    filter->params.ExtParam = NULL;
   }
-  if (!len)
-    return FALSE;
-
   memset (&filter->vpp_use, 0, sizeof (mfxExtVPPDoUse));
-  filter->vpp_use.Header.BufferId = MFX_EXTBUFF_VPP_DOUSE;
-  filter->vpp_use.Header.BufferSz = sizeof (mfxExtVPPDoUse);
-  filter->vpp_use.NumAlg = len;
-  filter->vpp_use.AlgList = g_slice_alloc (len * sizeof (mfxU32));
-  if (!filter->vpp_use.AlgList)
+
+  num_ext = len ? len + 1 : 0;
+#if MSDK_CHECK_VERSION(1,19)
+  if (filter->scaling_mode || filter->interpolation)
+    num_ext++;
+#endif
+  if (!num_ext)
     return FALSE;
 
-  filter->ext_buffer = g_slice_alloc (
-      (len + 1) * sizeof (mfxExtBuffer *));
+  filter->ext_buffer = g_slice_alloc (num_ext * sizeof (mfxExtBuffer *));
   if (!filter->ext_buffer)
     return FALSE;
+  num_ext = 0;
+
+  if (len) {
+    filter->vpp_use.Header.BufferId = MFX_EXTBUFF_VPP_DOUSE;
+    filter->vpp_use.Header.BufferSz = sizeof (mfxExtVPPDoUse);
+    filter->vpp_use.NumAlg = len;
+    filter->vpp_use.AlgList = g_slice_alloc (len * sizeof (mfxU32));
+    if (!filter->vpp_use.AlgList)
+      return FALSE;
 
-  for (i = 0; i < len; i++) {
-    op = (GstMfxFilterOpData *) g_ptr_array_index (filter->filter_op_data, i);
-    ext_buf = (mfxExtBuffer *) op->filter;
-    filter->vpp_use.AlgList[i] = ext_buf->BufferId;
-    filter->ext_buffer[i + 1] = (mfxExtBuffer *) op->filter;
+    filter->ext_buffer[num_ext++] = (mfxExtBuffer *) & filter->vpp_use;
+
+    for (i = 0; i < len; i++) {
+      op = (GstMfxFilterOpData *) g_ptr_array_index (filter->filter_op_data, i);
+      ext_buf = (mfxExtBuffer *) op->filter;
+      filter->vpp_use.AlgList[i] = ext_buf->BufferId;
+      filter->ext_buffer[num_ext++] = ext_buf;
+    }
   }
 
-  filter->ext_buffer[0] = (mfxExtBuffer *) & filter->vpp_use;
+#if MSDK_CHECK_VERSION(1,19)
+  if (filter->scaling_mode || filter->interpolation) {
+    memset (&filter->ext_scaling, 0, sizeof (mfxExtVPPScaling));
+    filter->ext_scaling.Header.BufferId = MFX_EXTBUFF_VPP_SCALING;
+    filter->ext_scaling.Header.BufferSz = sizeof (mfxExtVPPScaling);
+    filter->ext_scaling.ScalingMode = filter->scaling_mode;
+#if MSDK_CHECK_VERSION(1,33)
+    filter->ext_scaling.InterpolationMethod = filter->interpolation;
+#endif
+    filter->ext_buffer[num_ext++] = (mfxExtBuffer *) & filter->ext_scaling;
+  }
+#endif
 
-  filter->params.NumExtParam = len + 1;
+  filter->params.NumExtParam = num_ext;
   filter->params.ExtParam = (mfxExtBuffer **) & filter->ext_buffer[0];
 
   return TRUE;
@@ -363,6 +401,28 @@ find_filter_op_data (GstMfxFilter * filter, GstMfxFilterType type)
   return NULL;
 }
 
+/* Schedules a changed filter parameter. Algorithms enabled on the running
+ * VPP are updated at the next frame boundary, others need a VPP reset */
+static void
+update_filter_op (GstMfxFilter * filter, GstMfxFilterOpData * op)
+{
+  if (!filter->inited)
+    return;
+
+#if MSDK_CHECK_VERSION(1,19)
+  mfxExtBuffer *ext_buf = (mfxExtBuffer *) op->filter;
+  guint i;
+
+  for (i = 0; i < filter->vpp_use.NumAlg; i++) {
+    if (filter->vpp_use.AlgList[i] == ext_buf->BufferId) {
+      filter->pending_ops |= op->type;
+      return;
+    }
+  }
+#endif
+  filter->needs_reset = TRUE;
+}
+
 static void
 free_filter_op_data (gpointer data)
 {
@@ -686,7 +746,10 @@ gst_mfx_filter_set_saturation (GstMfxFilter * filter, gfloat value)
     g_ptr_array_add (filter->filter_op_data, op);
   }
   ext_procamp = (mfxExtVPPProcAmp *) op->filter;
-  ext_procamp->Saturation = value;
+  if (ext_procamp->Saturation != value) {
+    ext_procamp->Saturation = value;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -718,7 +781,10 @@ gst_mfx_filter_set_brightness (GstMfxFilter * filter, gfloat value)
   }
 
   ext_procamp = (mfxExtVPPProcAmp *) op->filter;
-  ext_procamp->Brightness = value;
+  if (ext_procamp->Brightness != value) {
+    ext_procamp->Brightness = value;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -750,7 +816,10 @@ gst_mfx_filter_set_contrast (GstMfxFilter * filter, gfloat value)
   }
 
   ext_procamp = (mfxExtVPPProcAmp *) op->filter;
-  ext_procamp->Contrast = value;
+  if (ext_procamp->Contrast != value) {
+    ext_procamp->Contrast = value;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -782,7 +851,10 @@ gst_mfx_filter_set_hue (GstMfxFilter * filter, gfloat value)
   }
 
   ext_procamp = (mfxExtVPPProcAmp *) op->filter;
-  ext_procamp->Hue = value;
+  if (ext_procamp->Hue != value) {
+    ext_procamp->Hue = value;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -813,7 +885,10 @@ gst_mfx_filter_set_denoising_level (GstMfxFilter * filter, guint level)
   }
 
   ext_denoise = (mfxExtVPPDenoise *) op->filter;
-  ext_denoise->DenoiseFactor = level;
+  if (ext_denoise->DenoiseFactor != level) {
+    ext_denoise->DenoiseFactor = level;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -843,7 +918,10 @@ gst_mfx_filter_set_detail_level (GstMfxFilter * filter, guint level)
   }
 
   ext_detail = (mfxExtVPPDetail *) op->filter;
-  ext_detail->DetailFactor = level;
+  if (ext_detail->DetailFactor != level) {
+    ext_detail->DetailFactor = level;
+    update_filter_op (filter, op);
+  }
 
   return TRUE;
 }
@@ -880,6 +958,49 @@ gst_mfx_filter_set_rotation (GstMfxFilter * filter, GstMfxRotation angle)
   return TRUE;
 }
 
+gboolean
+gst_mfx_filter_set_scaling_mode (GstMfxFilter * filter,
+    GstMfxScalingMode mode)
+{
+  g_return_val_if_fail (filter != NULL, FALSE);
+#if MSDK_CHECK_VERSION(1,19)
+  g_return_val_if_fail (GST_MFX_SCALING_MODE_DEFAULT == mode
+      || GST_MFX_SCALING_MODE_LOWPOWER == mode
+      || GST_MFX_SCALING_MODE_QUALITY == mode, FALSE);
+#else
+  g_return_val_if_fail (GST_MFX_SCALING_MODE_DEFAULT == mode, FALSE);
+#endif // MSDK_CHECK_VERSION
+
+  if (filter->scaling_mode != mode) {
+    filter->scaling_mode = mode;
+    if (filter->inited)
+      filter->needs_reset = TRUE;
+  }
+  return TRUE;
+}
+
+gboolean
+gst_mfx_filter_set_interpolation_method (GstMfxFilter * filter,
+    GstMfxInterpolationMethod method)
+{
+  g_return_val_if_fail (filter != NULL, FALSE);
+#if MSDK_CHECK_VERSION(1,33)
+  g_return_val_if_fail (GST_MFX_INTERPOLATION_DEFAULT == method
+      || GST_MFX_INTERPOLATION_NEAREST_NEIGHBOR == method
+      || GST_MFX_INTERPOLATION_BILINEAR == method
+      || GST_MFX_INTERPOLATION_ADVANCED == method, FALSE);
+#else
+  g_return_val_if_fail (GST_MFX_INTERPOLATION_DEFAULT == method, FALSE);
+#endif // MSDK_CHECK_VERSION
+
+  if (filter->interpolation != method) {
+    filter->interpolation = method;
+    if (filter->inited)
+      filter->needs_reset = TRUE;
+  }
+  return TRUE;
+}
+
 gboolean
 gst_mfx_filter_set_deinterlace_mode (GstMfxFilter * filter,
     GstMfxDeinterlaceMode mode)
@@ -937,6 +1058,19 @@ gst_mfx_filter_set_framerate (GstMfxFilter * filter,
   return TRUE;
 }
 
+void
+gst_mfx_filter_set_system_memory_params (GstMfxFilter * filter,
+    const GstMfxSystemMemoryParams * params)
+{
+  guint i;
+
+  g_return_if_fail (filter != NULL);
+
+  for (i = 0; i < 2; i++)
+    if (filter->vpp[i])
+      gst_mfx_task_set_system_memory_params (filter->vpp[i], params);
+}
+
 gboolean
 gst_mfx_filter_set_async_depth (GstMfxFilter * filter, mfxU16 async_depth)
 {
@@ -1004,9 +1138,67 @@ gst_mfx_filter_reset (GstMfxFilter * filter)
       GST_ERROR ("Error resetting MFX VPP %d", sts);
       return GST_MFX_FILTER_STATUS_ERROR_OPERATION_FAILED;
   }
+  filter->pending_ops = 0;
+  filter->needs_reset = FALSE;
   return GST_MFX_FILTER_STATUS_SUCCESS;
 }
 
+/**
+ * gst_mfx_filter_update:
+ * @filter: a #GstMfxFilter
+ *
+ * Applies the filter parameters changed since the last call. Parameters
+ * of algorithms already running take effect at the next processed frame
+ * without flushing the VPP, other changes go through gst_mfx_filter_reset().
+ *
+ * Return value: %GST_MFX_FILTER_STATUS_SUCCESS on success
+ */
+GstMfxFilterStatus
+gst_mfx_filter_update (GstMfxFilter * filter)
+{
+  g_return_val_if_fail (filter != NULL,
+      GST_MFX_FILTER_STATUS_ERROR_INVALID_PARAMETER);
+
+  if (!filter->inited || filter->needs_reset)
+    return gst_mfx_filter_reset (filter);
+
+  return GST_MFX_FILTER_STATUS_SUCCESS;
+}
+
+#if MSDK_CHECK_VERSION(1,19)
+/* Attaches a snapshot of the pending filter parameters to the input frame,
+ * after the ext buffers already carried by the surface */
+static mfxU16
+attach_frame_params (GstMfxFilter * filter, mfxFrameSurface1 * insurf)
+{
+  GstMfxFilterOpData *op;
+  mfxU16 n = insurf->Data.NumExtParam;
+
+  if (n + 3 > G_N_ELEMENTS (filter->frame_ext_buf))
+    return 0;
+
+  memcpy (filter->frame_ext_buf, insurf->Data.ExtParam,
+      n * sizeof (mfxExtBuffer *));
+
+  if ((filter->pending_ops & GST_MFX_FILTER_PROCAMP)
+      && (op = find_filter_op_data (filter, GST_MFX_FILTER_PROCAMP))) {
+    filter->frame_procamp = *(mfxExtVPPProcAmp *) op->filter;
+    filter->frame_ext_buf[n++] = (mfxExtBuffer *) &filter->frame_procamp;
+  }
+  if ((filter->pending_ops & GST_MFX_FILTER_DENOISE)
+      && (op = find_filter_op_data (filter, GST_MFX_FILTER_DENOISE))) {
+    filter->frame_denoise = *(mfxExtVPPDenoise *) op->filter;
+    filter->frame_ext_buf[n++] = (mfxExtBuffer *) &filter->frame_denoise;
+  }
+  if ((filter->pending_ops & GST_MFX_FILTER_DETAIL)
+      && (op = find_filter_op_data (filter, GST_MFX_FILTER_DETAIL))) {
+    filter->frame_detail = *(mfxExtVPPDetail *) op->filter;
+    filter->frame_ext_buf[n++] = (mfxExtBuffer *) &filter->frame_detail;
+  }
+  return n;
+}
+#endif
+
 static GstMfxFilterStatus
 gst_mfx_filter_start (GstMfxFilter * filter)
 {
@@ -1063,6 +1255,10 @@ gst_mfx_filter_process (GstMfxFilter * filter, GstMfxSurface * surface,
   mfxStatus sts = MFX_ERR_NONE;
   GstMfxFilterStatus ret = GST_MFX_FILTER_STATUS_SUCCESS;
   gboolean more_surface = FALSE;
+#if MSDK_CHECK_VERSION(1,19)
+  mfxExtBuffer **ext_params = NULL;
+  mfxU16 num_ext_params = 0;
+#endif
 
   /* Delayed VPP initialization to enable surface pool sharing with
    * encoder plugin */
@@ -1073,8 +1269,27 @@ gst_mfx_filter_process (GstMfxFilter * filter, GstMfxSurface * surface,
     filter->inited = TRUE;
   }
 
+  /* Surfaces produced outside the sessions of the aggregator are not
+   * ordered by the SDK before the VPP operation */
+  if (!gst_mfx_surface_sync_for_aggregator (surface, filter->aggregator))
+    return GST_MFX_FILTER_STATUS_ERROR_OPERATION_FAILED;
+
   insurf = gst_mfx_surface_get_frame_surface (surface);
 
+#if MSDK_CHECK_VERSION(1,19)
+  if (filter->pending_ops) {
+    num_ext_params = insurf->Data.NumExtParam;
+    ext_params = insurf->Data.ExtParam;
+    insurf->Data.NumExtParam = attach_frame_params (filter, insurf);
+    if (insurf->Data.NumExtParam)
+      insurf->Data.ExtParam = filter->frame_ext_buf;
+    else {
+      GST_WARNING ("Unable to attach per-frame VPP parameters");
+      insurf->Data.NumExtParam = num_ext_params;
+    }
+  }
+#endif
+
   do {
     *out_surface = gst_mfx_surface_new_from_pool (filter->vpp_pool[1]);
     if (!*out_surface)
@@ -1092,6 +1307,15 @@ gst_mfx_filter_process (GstMfxFilter * filter, GstMfxSurface * surface,
       g_usleep (500);
   } while (MFX_WRN_DEVICE_BUSY == sts);
 
+#if MSDK_CHECK_VERSION(1,19)
+  if (filter->pending_ops) {
+    insurf->Data.NumExtParam = num_ext_params;
+    insurf->Data.ExtParam = ext_params;
+    if (sts >= 0 || MFX_ERR_MORE_DATA == sts || MFX_ERR_MORE_SURFACE == sts)
+      filter->pending_ops = 0;
+  }
+#endif
+
   if (MFX_ERR_MORE_DATA == sts)
     return GST_MFX_FILTER_STATUS_ERROR_MORE_DATA;
 
@@ -1109,13 +1333,9 @@ gst_mfx_filter_process (GstMfxFilter * filter, GstMfxSurface * surface,
   }
 
   if (syncp) {
-    if (!gst_mfx_task_has_type (filter->vpp[1], GST_MFX_TASK_ENCODER))
-      do {
-        sts = MFXVideoCORE_SyncOperation (filter->session, syncp, 1000);
-      } while (MFX_WRN_IN_EXECUTION == sts);
-
     *out_surface =
         gst_mfx_surface_pool_find_surface (filter->vpp_pool[1], outsurf);
+    gst_mfx_surface_set_syncpoint (*out_surface, filter->session, syncp);
   }
 
   if (more_surface)
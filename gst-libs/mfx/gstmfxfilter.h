@@ -134,6 +134,40 @@ typedef enum {
     GST_MFX_FRC_FI_DISTRIBUTED_TIMESTAMP = MFX_FRCALGM_DISTRIBUTED_TIMESTAMP | MFX_FRCALGM_FRAME_INTERPOLATION,
 } GstMfxFrcAlgorithm;
 
+/**
+ * GstMfxScalingMode:
+ * @GST_MFX_SCALING_MODE_DEFAULT: the implementation picks the scaler.
+ * @GST_MFX_SCALING_MODE_LOWPOWER: fixed function scaler, favoring
+ *   throughput and power consumption.
+ * @GST_MFX_SCALING_MODE_QUALITY: EU based scaler, favoring quality.
+ */
+typedef enum {
+  GST_MFX_SCALING_MODE_DEFAULT = 0,
+#if MSDK_CHECK_VERSION(1,19)
+  GST_MFX_SCALING_MODE_LOWPOWER = MFX_SCALING_MODE_LOWPOWER,
+  GST_MFX_SCALING_MODE_QUALITY = MFX_SCALING_MODE_QUALITY,
+#endif
+} GstMfxScalingMode;
+
+/**
+ * GstMfxInterpolationMethod:
+ * @GST_MFX_INTERPOLATION_DEFAULT: the implementation picks the method.
+ * @GST_MFX_INTERPOLATION_NEAREST_NEIGHBOR: nearest neighbor, the fastest.
+ * @GST_MFX_INTERPOLATION_BILINEAR: bilinear interpolation.
+ * @GST_MFX_INTERPOLATION_ADVANCED: multi-tap filter, the best quality.
+ *
+ * Interpolation method of the scaler, honored by the software
+ * implementation.
+ */
+typedef enum {
+  GST_MFX_INTERPOLATION_DEFAULT = 0,
+#if MSDK_CHECK_VERSION(1,33)
+  GST_MFX_INTERPOLATION_NEAREST_NEIGHBOR = MFX_INTERPOLATION_NEAREST_NEIGHBOR,
+  GST_MFX_INTERPOLATION_BILINEAR = MFX_INTERPOLATION_BILINEAR,
+  GST_MFX_INTERPOLATION_ADVANCED = MFX_INTERPOLATION_ADVANCED,
+#endif
+} GstMfxInterpolationMethod;
+
 /**
  * GstMfxRotation:
  * @GST_MFX_ROTATION_0: the output surface is not rotated.
@@ -177,6 +211,9 @@ gst_mfx_filter_process (GstMfxFilter * filter, GstMfxSurface *surface,
 GstMfxFilterStatus
 gst_mfx_filter_reset (GstMfxFilter * filter);
 
+GstMfxFilterStatus
+gst_mfx_filter_update (GstMfxFilter * filter);
+
 gboolean
 gst_mfx_filter_has_filter (GstMfxFilter * filter, guint flags);
 
@@ -222,6 +259,14 @@ gst_mfx_filter_set_contrast (GstMfxFilter * filter, gfloat value);
 gboolean
 gst_mfx_filter_set_rotation (GstMfxFilter * filter, GstMfxRotation angle);
 
+gboolean
+gst_mfx_filter_set_scaling_mode (GstMfxFilter * filter,
+    GstMfxScalingMode mode);
+
+gboolean
+gst_mfx_filter_set_interpolation_method (GstMfxFilter * filter,
+    GstMfxInterpolationMethod method);
+
 gboolean
 gst_mfx_filter_set_deinterlace_mode (GstMfxFilter *filter,
     GstMfxDeinterlaceMode mode);
@@ -237,5 +282,9 @@ gst_mfx_filter_set_frc_algorithm (GstMfxFilter *filter,
 gboolean
 gst_mfx_filter_set_async_depth (GstMfxFilter * filter, mfxU16 async_depth);
 
+void
+gst_mfx_filter_set_system_memory_params (GstMfxFilter * filter,
+    const GstMfxSystemMemoryParams * params);
+
 
 #endif /* GST_MFX_FILTER_H */
@@ -42,6 +42,13 @@ struct _GstMfxPrimeBufferProxy
   VABufferInfo buf_info;
   guintptr fd;
   guint data_size;
+
+  /* Plane layout of the exported buffer */
+  gboolean is_exported;
+  guint64 modifier;
+  guint num_planes;
+  guint offsets[GST_VIDEO_MAX_PLANES];
+  guint pitches[GST_VIDEO_MAX_PLANES];
 };
 
 typedef VAStatus (*vaExtGetSurfaceHandle) (VADisplay dpy,
@@ -72,18 +79,82 @@ vpg_load_symbol (const gchar * vpg_extension)
   return TRUE;
 }
 
+#if VA_CHECK_VERSION(1,1,0)
+/* Exports the surface with the exact plane layout reported by the driver.
+ * Only single object exports are handled since the buffer is shared as a
+ * single fd. No consumer can be told a DRM format modifier, so only linear
+ * exports are kept */
 static gboolean
-gst_mfx_prime_buffer_proxy_acquire_handle (GstMfxPrimeBufferProxy * proxy)
+gst_mfx_prime_buffer_proxy_export_handle (GstMfxPrimeBufferProxy * proxy,
+    VASurfaceID surf)
+{
+  VADRMPRIMESurfaceDescriptor desc;
+  VAStatus va_status;
+  guint i;
+
+  memset (&desc, 0, sizeof (desc));
+
+  GST_MFX_DISPLAY_LOCK (proxy->display);
+  va_status = vaExportSurfaceHandle (GST_MFX_DISPLAY_VADISPLAY (proxy->display),
+      surf, VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+      VA_EXPORT_SURFACE_READ_ONLY | VA_EXPORT_SURFACE_COMPOSED_LAYERS, &desc);
+  GST_MFX_DISPLAY_UNLOCK (proxy->display);
+  if (va_status != VA_STATUS_SUCCESS)
+    return FALSE;
+
+  if (desc.num_objects != 1 || desc.num_layers != 1
+      || desc.layers[0].num_planes > GST_VIDEO_MAX_PLANES) {
+    GST_DEBUG ("unsupported export layout (%u objects, %u layers)",
+        desc.num_objects, desc.num_layers);
+    for (i = 0; i < desc.num_objects; i++)
+      close (desc.objects[i].fd);
+    return FALSE;
+  }
+
+  if (desc.objects[0].drm_format_modifier != DRM_FORMAT_MOD_LINEAR) {
+    GST_DEBUG ("surface %" GST_MFX_ID_FORMAT " has modifier 0x%016"
+        G_GINT64_MODIFIER "x, which the consumer can't be told",
+        GST_MFX_ID_ARGS (surf), desc.objects[0].drm_format_modifier);
+    close (desc.objects[0].fd);
+    return FALSE;
+  }
+
+  proxy->fd = desc.objects[0].fd;
+  proxy->data_size = desc.objects[0].size;
+  proxy->modifier = desc.objects[0].drm_format_modifier;
+  proxy->num_planes = desc.layers[0].num_planes;
+  for (i = 0; i < proxy->num_planes; i++) {
+    proxy->offsets[i] = desc.layers[0].offset[i];
+    proxy->pitches[i] = desc.layers[0].pitch[i];
+  }
+  proxy->is_exported = TRUE;
+
+  GST_DEBUG ("exported surface %" GST_MFX_ID_FORMAT " with modifier 0x%016"
+      G_GINT64_MODIFIER "x", GST_MFX_ID_ARGS (surf), proxy->modifier);
+  return TRUE;
+}
+#endif
+
+static gboolean
+gst_mfx_prime_buffer_proxy_acquire_handle (GstMfxPrimeBufferProxy * proxy,
+    gboolean use_export)
 {
   VASurfaceID surf;
   VAStatus va_status;
   VAImage va_img;
+  guint i;
 
   if (!proxy->surface)
     return FALSE;
 
   surf = GST_MFX_SURFACE_ID (proxy->surface);
   proxy->display = gst_mfx_surface_vaapi_get_display (proxy->surface);
+
+#if VA_CHECK_VERSION(1,1,0)
+  if (use_export && gst_mfx_prime_buffer_proxy_export_handle (proxy, surf))
+    return TRUE;
+#endif
+
   proxy->image = gst_mfx_surface_vaapi_derive_image (proxy->surface);
   if (!proxy->image) {
     GST_ERROR("Could not derive image.");
@@ -110,6 +181,12 @@ gst_mfx_prime_buffer_proxy_acquire_handle (GstMfxPrimeBufferProxy * proxy)
   }
 
   proxy->data_size = va_img.data_size;
+  proxy->modifier = DRM_FORMAT_MOD_INVALID;
+  proxy->num_planes = MIN (va_img.num_planes, GST_VIDEO_MAX_PLANES);
+  for (i = 0; i < proxy->num_planes; i++) {
+    proxy->offsets[i] = va_img.offsets[i];
+    proxy->pitches[i] = va_img.pitches[i];
+  }
 
   return TRUE;
 }
@@ -117,10 +194,10 @@ gst_mfx_prime_buffer_proxy_acquire_handle (GstMfxPrimeBufferProxy * proxy)
 static void
 gst_mfx_prime_buffer_proxy_finalize (GstMfxPrimeBufferProxy * proxy)
 {
-  if (g_va_get_surface_handle) {
+  if (proxy->is_exported || g_va_get_surface_handle) {
     close (proxy->fd);
   }
-  else {
+  else if (proxy->image) {
     VAImage va_img;
 
     vaapi_image_get_image (proxy->image, &va_img);
@@ -145,13 +222,11 @@ gst_mfx_prime_buffer_proxy_class (void)
   return &GstMfxPrimeBufferProxyClass;
 }
 
-GstMfxPrimeBufferProxy *
-gst_mfx_prime_buffer_proxy_new_from_surface (GstMfxSurface * surface)
+static GstMfxPrimeBufferProxy *
+gst_mfx_prime_buffer_proxy_new (GstMfxSurface * surface, gboolean use_export)
 {
   GstMfxPrimeBufferProxy *proxy;
 
-  g_return_val_if_fail (surface != NULL, NULL);
-
   proxy = (GstMfxPrimeBufferProxy *)
       gst_mfx_mini_object_new0 (gst_mfx_prime_buffer_proxy_class ());
   if (!proxy)
@@ -159,7 +234,7 @@ gst_mfx_prime_buffer_proxy_new_from_surface (GstMfxSurface * surface)
 
   proxy->surface = gst_mfx_surface_ref (surface);
 
-  if (!gst_mfx_prime_buffer_proxy_acquire_handle (proxy))
+  if (!gst_mfx_prime_buffer_proxy_acquire_handle (proxy, use_export))
     goto error_acquire_handle;
 
   return proxy;
@@ -170,6 +245,44 @@ error_acquire_handle:
   return NULL;
 }
 
+/**
+ * gst_mfx_prime_buffer_proxy_new_from_surface:
+ * @surface: a #GstMfxSurface
+ *
+ * Shares @surface through its derived image, with the implicit tiling of
+ * the underlying buffer object. The derived image is available through
+ * gst_mfx_prime_buffer_proxy_get_vaapi_image().
+ *
+ * Returns: the newly allocated #GstMfxPrimeBufferProxy, or %NULL on error
+ */
+GstMfxPrimeBufferProxy *
+gst_mfx_prime_buffer_proxy_new_from_surface (GstMfxSurface * surface)
+{
+  g_return_val_if_fail (surface != NULL, NULL);
+
+  return gst_mfx_prime_buffer_proxy_new (surface, FALSE);
+}
+
+/**
+ * gst_mfx_prime_buffer_proxy_export_surface:
+ * @surface: a #GstMfxSurface
+ *
+ * Exports @surface with vaExportSurfaceHandle() where available, which
+ * reports the exact plane layout. Tiled surfaces are shared with their
+ * implicit tiling instead, as by
+ * gst_mfx_prime_buffer_proxy_new_from_surface(), since a consumer that
+ * imports them without the modifier would read them as linear.
+ *
+ * Returns: the newly allocated #GstMfxPrimeBufferProxy, or %NULL on error
+ */
+GstMfxPrimeBufferProxy *
+gst_mfx_prime_buffer_proxy_export_surface (GstMfxSurface * surface)
+{
+  g_return_val_if_fail (surface != NULL, NULL);
+
+  return gst_mfx_prime_buffer_proxy_new (surface, TRUE);
+}
+
 GstMfxPrimeBufferProxy *
 gst_mfx_prime_buffer_proxy_ref (GstMfxPrimeBufferProxy * proxy)
 {
@@ -215,5 +328,48 @@ gst_mfx_prime_buffer_proxy_get_vaapi_image (GstMfxPrimeBufferProxy * proxy)
 {
   g_return_val_if_fail (proxy != NULL, 0);
 
-  return vaapi_image_ref (proxy->image);
+  return proxy->image ? vaapi_image_ref (proxy->image) : NULL;
+}
+
+/**
+ * gst_mfx_prime_buffer_proxy_get_modifier:
+ * @proxy: a #GstMfxPrimeBufferProxy
+ *
+ * Returns the DRM format modifier describing the tiling of the exported
+ * buffer, or %DRM_FORMAT_MOD_INVALID if the tiling is implicit.
+ */
+guint64
+gst_mfx_prime_buffer_proxy_get_modifier (GstMfxPrimeBufferProxy * proxy)
+{
+  g_return_val_if_fail (proxy != NULL, DRM_FORMAT_MOD_INVALID);
+
+  return proxy->modifier;
+}
+
+guint
+gst_mfx_prime_buffer_proxy_get_plane_count (GstMfxPrimeBufferProxy * proxy)
+{
+  g_return_val_if_fail (proxy != NULL, 0);
+
+  return proxy->num_planes;
+}
+
+guint
+gst_mfx_prime_buffer_proxy_get_offset (GstMfxPrimeBufferProxy * proxy,
+    guint plane)
+{
+  g_return_val_if_fail (proxy != NULL, 0);
+  g_return_val_if_fail (plane < proxy->num_planes, 0);
+
+  return proxy->offsets[plane];
+}
+
+guint
+gst_mfx_prime_buffer_proxy_get_pitch (GstMfxPrimeBufferProxy * proxy,
+    guint plane)
+{
+  g_return_val_if_fail (proxy != NULL, 0);
+  g_return_val_if_fail (plane < proxy->num_planes, 0);
+
+  return proxy->pitches[plane];
 }
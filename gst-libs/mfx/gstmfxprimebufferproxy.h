@@ -26,6 +26,13 @@
 
 G_BEGIN_DECLS
 
+#ifndef DRM_FORMAT_MOD_INVALID
+#define DRM_FORMAT_MOD_INVALID G_GUINT64_CONSTANT (0x00ffffffffffffff)
+#endif
+#ifndef DRM_FORMAT_MOD_LINEAR
+#define DRM_FORMAT_MOD_LINEAR G_GUINT64_CONSTANT (0)
+#endif
+
 #define GST_MFX_PRIME_BUFFER_PROXY(obj) \
   ((GstMfxPrimeBufferProxy *)(obj))
 
@@ -46,6 +53,9 @@ typedef struct _GstMfxPrimeBufferProxy GstMfxPrimeBufferProxy;
 GstMfxPrimeBufferProxy *
 gst_mfx_prime_buffer_proxy_new_from_surface (GstMfxSurface * surface);
 
+GstMfxPrimeBufferProxy *
+gst_mfx_prime_buffer_proxy_export_surface (GstMfxSurface * surface);
+
 GstMfxPrimeBufferProxy *
 gst_mfx_prime_buffer_proxy_ref (GstMfxPrimeBufferProxy * proxy);
 
@@ -65,6 +75,20 @@ gst_mfx_prime_buffer_proxy_get_size (GstMfxPrimeBufferProxy * proxy);
 VaapiImage *
 gst_mfx_prime_buffer_proxy_get_vaapi_image (GstMfxPrimeBufferProxy *proxy);
 
+guint64
+gst_mfx_prime_buffer_proxy_get_modifier (GstMfxPrimeBufferProxy * proxy);
+
+guint
+gst_mfx_prime_buffer_proxy_get_plane_count (GstMfxPrimeBufferProxy * proxy);
+
+guint
+gst_mfx_prime_buffer_proxy_get_offset (GstMfxPrimeBufferProxy * proxy,
+    guint plane);
+
+guint
+gst_mfx_prime_buffer_proxy_get_pitch (GstMfxPrimeBufferProxy * proxy,
+    guint plane);
+
 G_END_DECLS
 
 #endif /* GST_VAAPI_BUFFER_PROXY_H */
@@ -21,17 +21,125 @@
 #include "gstmfxsurface.h"
 #include "gstmfxsurface_priv.h"
 #include "gstmfxsurfacepool.h"
+#include "gstmfxsurfacearena.h"
 #include "gstmfxtask.h"
+#include "gstmfxtaskaggregator.h"
 #include "gstmfxdisplay.h"
 
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
 #define DEBUG 1
 #include "gstmfxdebug.h"
 
+#define DEFAULT_MEMORY_ALIGNMENT 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define MPOL_BIND 2
+
 /* Ensure those symbols are actually defined in the resulting libraries */
 #undef gst_mfx_surface_ref
 #undef gst_mfx_surface_unref
 #undef gst_mfx_surface_replace
 
+gboolean
+gst_mfx_surface_reserve_memory(GstMfxSurface * surface, guint64 size)
+{
+  GstMfxDisplay *owner = surface->display;
+
+  /* Surfaces are charged to the pipeline owning their display */
+  if (!owner && surface->task) {
+    GstMfxDisplay *display = gst_mfx_task_get_display(surface->task);
+    owner = display;
+    gst_mfx_display_unref(display);
+  }
+
+  if (!gst_mfx_surface_arena_reserve(owner, size))
+    return FALSE;
+
+  surface->arena_owner = owner;
+  surface->arena_size = size;
+  return TRUE;
+}
+
+static void
+bind_to_numa_node (gpointer data, gsize size, gint node)
+{
+#ifdef SYS_mbind
+  unsigned long nodemask;
+
+  if (node < 0 || node >= (gint) (sizeof (nodemask) * 8))
+    return;
+
+  nodemask = 1UL << node;
+  if (syscall (SYS_mbind, data, size, MPOL_BIND, &nodemask,
+          sizeof (nodemask) * 8, 0) < 0)
+    GST_WARNING ("Failed to bind surface memory to NUMA node %d", node);
+#endif
+}
+
+/* Allocates the surface data with the alignment requested by the task.
+ * Huge pages and NUMA binding require page-granular memory from mmap(),
+ * which has to be bound before it is first touched */
+static guint8 *
+gst_mfx_surface_alloc_data (GstMfxSurface * surface, GstMfxTask * task,
+    gsize size)
+{
+  const GstMfxSystemMemoryParams *params =
+      task ? gst_mfx_task_get_system_memory_params (task) : NULL;
+  guint alignment = DEFAULT_MEMORY_ALIGNMENT;
+  gpointer data = NULL;
+
+  /* posix_memalign() only takes powers of two, so round the requested
+   * alignment up to the next one */
+  if (params && params->alignment)
+    alignment = 1U << g_bit_storage (CLAMP (params->alignment, 16, 4096) - 1);
+
+  if (params && (params->use_hugepages || params->numa_node >= 0)) {
+    gsize alloc_size = params->use_hugepages ?
+        GST_ROUND_UP_N (size, HUGE_PAGE_SIZE) : size;
+
+#ifdef MAP_HUGETLB
+    if (params->use_hugepages)
+      data = mmap (NULL, alloc_size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (!data || data == MAP_FAILED) {
+      data = mmap (NULL, alloc_size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+      if (params->use_hugepages)
+        madvise (data, alloc_size, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (params->numa_node >= 0)
+      bind_to_numa_node (data, alloc_size, params->numa_node);
+
+    surface->alloc_size = alloc_size;
+    surface->data_is_mapped = TRUE;
+    return data;
+  }
+
+  if (posix_memalign (&data, alignment, size) != 0)
+    return NULL;
+
+  surface->alloc_size = size;
+  surface->data_is_mapped = FALSE;
+  return data;
+}
+
+static void
+gst_mfx_surface_free_data (GstMfxSurface * surface)
+{
+  if (surface->data_is_mapped)
+    munmap (surface->data, surface->alloc_size);
+  else
+    free (surface->data);
+  surface->data = NULL;
+}
+
 static gboolean
 gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
 {
@@ -42,6 +150,10 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
 
   frame_size = info->Width * info->Height;
 
+  if (!gst_mfx_surface_reserve_memory(surface,
+          gst_mfx_surface_arena_get_frame_size(info)))
+    return FALSE;
+
 #ifdef WITH_MSS_2016
   /* This offset value is required for Haswell when using MFX surfaces in
    * system memory. Don't ask me why... */
@@ -51,7 +163,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
   switch (info->FourCC) {
   case MFX_FOURCC_NV12:
     surface->data_size = frame_size * 3 / 2;
-    surface->data = g_slice_alloc(surface->data_size + offset);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size + offset);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = surface->pitches[1] = info->Width;
@@ -62,7 +175,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
     break;
   case MFX_FOURCC_YV12:
     surface->data_size = frame_size * 3 / 2;
-    surface->data = g_slice_alloc(surface->data_size);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = info->Width;
@@ -81,7 +195,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
     break;
   case MFX_FOURCC_YUY2:
     surface->data_size = frame_size * 2;
-    surface->data = g_slice_alloc(surface->data_size + offset);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size + offset);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = info->Width * 2;
@@ -93,7 +208,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
     break;
   case MFX_FOURCC_UYVY:
     surface->data_size = frame_size * 2;
-    surface->data = g_slice_alloc(surface->data_size);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = info->Width * 2;
@@ -105,7 +221,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
     break;
   case MFX_FOURCC_RGB4:
     surface->data_size = frame_size * 4;
-    surface->data = g_slice_alloc(surface->data_size + offset);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size + offset);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = info->Width * 4;
@@ -118,7 +235,8 @@ gst_mfx_surface_allocate_default (GstMfxSurface * surface, GstMfxTask * task)
     break;
   case MFX_FOURCC_P010:
     surface->data_size = frame_size * 3;
-    surface->data = g_slice_alloc(surface->data_size + offset);
+    surface->data =
+        gst_mfx_surface_alloc_data(surface, task, surface->data_size + offset);
     if (!surface->data)
       goto error;
     ptr->Pitch = surface->pitches[0] = surface->pitches[1] = info->Width * 2;
@@ -146,7 +264,7 @@ gst_mfx_surface_release_default (GstMfxSurface * surface)
   if (NULL != ptr) {
     ptr->Pitch = 0;
     if (surface->data)
-      g_slice_free1(surface->data_size, surface->data);
+      gst_mfx_surface_free_data(surface);
     ptr->Y = NULL;
     ptr->U = NULL;
     ptr->V = NULL;
@@ -275,6 +393,9 @@ gst_mfx_surface_finalize (GstMfxSurface * surface)
     g_slice_free (mfxExtBuffer *, surface->ext_buf);
   if (klass->release)
     klass->release(surface);
+  gst_mfx_surface_arena_release(surface->arena_owner, surface->arena_size);
+  if (surface->destroy_func)
+    surface->destroy_func(surface->user_data);
   gst_mfx_display_replace(&surface->display, NULL);
   gst_mfx_task_replace (&surface->task, NULL);
 }
@@ -328,6 +449,147 @@ gst_mfx_surface_new_from_pool(GstMfxSurfacePool * pool)
   return gst_mfx_surface_pool_get_surface(pool);
 }
 
+/* Checks whether externally allocated planes can be handed to the SDK as is,
+ * i.e. with a single pitch shared by all planes and enough rows for the
+ * 16-aligned frame height the SDK is allowed to touch */
+static gboolean
+gst_mfx_surface_check_data_layout(const mfxFrameInfo * info,
+    const GstVideoInfo * vip, guint8 * data, gsize size, guint8 * planes[],
+    const gint strides[])
+{
+  guint i, n_planes = GST_VIDEO_INFO_N_PLANES(vip);
+  gint pitch = strides[0];
+
+  if (((guintptr) planes[0] & 15) || (pitch & 15) || pitch > G_MAXUINT16
+      || pitch < info->Width * GST_VIDEO_INFO_COMP_PSTRIDE(vip, 0))
+    return FALSE;
+
+  for (i = 0; i < n_planes; i++) {
+    guint rows = i ? info->Height / 2 : info->Height;
+    gint stride = (n_planes == 3 && i) ? pitch / 2 : pitch;
+
+    if (strides[i] != stride)
+      return FALSE;
+    if (planes[i] < data || planes[i] + (gsize) stride * rows > data + size)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * gst_mfx_surface_new_from_data:
+ * @info: the #GstVideoInfo describing the external frame
+ * @data: the start of the mapped memory holding all planes
+ * @size: the size of the mapped memory
+ * @planes: the plane pointers inside @data
+ * @strides: the plane strides
+ * @user_data: data keeping @data alive, passed to @destroy_func
+ * @destroy_func: called with @user_data when the surface is destroyed
+ *
+ * Wraps externally allocated system memory in a #GstMfxSurface without
+ * copying it. This only succeeds if the layout matches what the SDK
+ * expects for system memory surfaces, in which case the surface takes
+ * ownership of @user_data. Otherwise %NULL is returned and the caller
+ * keeps ownership of @user_data.
+ *
+ * Return value: the newly allocated #GstMfxSurface object, or %NULL
+ */
+GstMfxSurface *
+gst_mfx_surface_new_from_data (const GstVideoInfo * info, guint8 * data,
+    gsize size, guint8 * planes[], const gint strides[], gpointer user_data,
+    GDestroyNotify destroy_func)
+{
+  GstMfxSurface *surface;
+  mfxFrameData *ptr;
+  guint i;
+
+  g_return_val_if_fail(info != NULL, NULL);
+  g_return_val_if_fail(data != NULL, NULL);
+
+#ifdef WITH_MSS_2016
+  /* System memory surfaces need the extra offset from allocate_default */
+  return NULL;
+#endif
+
+  switch (GST_VIDEO_INFO_FORMAT(info)) {
+  case GST_VIDEO_FORMAT_NV12:
+  case GST_VIDEO_FORMAT_I420:
+  case GST_VIDEO_FORMAT_YV12:
+  case GST_VIDEO_FORMAT_YUY2:
+  case GST_VIDEO_FORMAT_UYVY:
+  case GST_VIDEO_FORMAT_BGRA:
+  case GST_VIDEO_FORMAT_BGRx:
+    break;
+  default:
+    return NULL;
+  }
+
+  surface = (GstMfxSurface *)
+    gst_mfx_mini_object_new0(GST_MFX_MINI_OBJECT_CLASS(gst_mfx_surface_class()));
+  if (!surface)
+    return NULL;
+
+  surface->gem_bo_handle = -1;
+  surface->surface_id = GST_MFX_ID_INVALID;
+
+  gst_mfx_surface_derive_mfx_frame_info(surface, info);
+  surface->format = GST_VIDEO_INFO_FORMAT(info);
+
+  if (!gst_mfx_surface_check_data_layout(&surface->surface.Info, info,
+          data, size, planes, strides))
+    goto error;
+
+  ptr = &surface->surface.Data;
+  ptr->Pitch = strides[0];
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES(info); i++) {
+    surface->planes[i] = planes[i];
+    surface->pitches[i] = strides[i];
+  }
+
+  switch (surface->format) {
+  case GST_VIDEO_FORMAT_NV12:
+    ptr->Y = planes[0];
+    ptr->UV = planes[1];
+    break;
+  case GST_VIDEO_FORMAT_I420:
+    ptr->Y = planes[0];
+    ptr->U = planes[1];
+    ptr->V = planes[2];
+    break;
+  case GST_VIDEO_FORMAT_YV12:
+    ptr->Y = planes[0];
+    ptr->V = planes[1];
+    ptr->U = planes[2];
+    break;
+  case GST_VIDEO_FORMAT_YUY2:
+    ptr->Y = planes[0];
+    ptr->U = ptr->Y + 1;
+    ptr->V = ptr->Y + 3;
+    break;
+  case GST_VIDEO_FORMAT_UYVY:
+    ptr->U = planes[0];
+    ptr->Y = ptr->U + 1;
+    ptr->V = ptr->U + 2;
+    break;
+  default:
+    ptr->B = planes[0];
+    ptr->G = ptr->B + 1;
+    ptr->R = ptr->B + 2;
+    ptr->A = ptr->B + 3;
+    break;
+  }
+
+  gst_mfx_surface_init_properties(surface);
+
+  surface->user_data = user_data;
+  surface->destroy_func = destroy_func;
+  return surface;
+
+error:
+  gst_mfx_surface_unref_internal(surface);
+  return NULL;
+}
+
 GstMfxSurface *
 gst_mfx_surface_new_internal(const GstMfxSurfaceClass * klass,
     GstMfxDisplay * display, const GstVideoInfo * info, GstMfxTask * task,
@@ -340,6 +602,20 @@ gst_mfx_surface_new_internal(const GstMfxSurfaceClass * klass,
   if (!surface)
     return NULL;
 
+  if (!gst_mfx_surface_init_internal(surface, display, info, task, is_linear))
+    goto error;
+  return surface;
+
+error:
+  gst_mfx_surface_unref_internal(surface);
+  return NULL;
+}
+
+gboolean
+gst_mfx_surface_init_internal(GstMfxSurface * surface,
+    GstMfxDisplay * display, const GstVideoInfo * info, GstMfxTask * task,
+    gboolean is_linear)
+{
   surface->gem_bo_handle = -1;
   surface->is_gem_linear = is_linear;
 
@@ -347,13 +623,7 @@ gst_mfx_surface_new_internal(const GstMfxSurfaceClass * klass,
   if (display)
     surface->display = gst_mfx_display_ref(display);
 
-  if (!gst_mfx_surface_create(surface, info, task))
-    goto error;
-  return surface;
-
-error:
-  gst_mfx_surface_unref_internal(surface);
-  return NULL;
+  return gst_mfx_surface_create(surface, info, task);
 }
 
 GstMfxSurface *
@@ -495,10 +765,17 @@ gst_mfx_surface_map(GstMfxSurface * surface)
 {
   GstMfxSurfaceClass *const klass = GST_MFX_SURFACE_GET_CLASS(surface);
 
-  if (gst_mfx_surface_has_video_memory(surface) && !surface->mapped)
-    if (klass->map)
-      return (surface->mapped = klass->map(surface));
+  if (!gst_mfx_surface_sync(surface))
+    return FALSE;
+
+  if (!gst_mfx_surface_has_video_memory(surface))
+    return TRUE;
+
+  if (!surface->mapped && klass->map
+      && !(surface->mapped = klass->map(surface)))
+    return FALSE;
 
+  g_atomic_int_inc(&surface->map_count);
   return TRUE;
 }
 
@@ -507,13 +784,32 @@ gst_mfx_surface_unmap(GstMfxSurface * surface)
 {
   GstMfxSurfaceClass *const klass = GST_MFX_SURFACE_GET_CLASS(surface);
 
-  if (gst_mfx_surface_has_video_memory(surface) && surface->mapped)
+  if (!gst_mfx_surface_has_video_memory(surface))
+    return;
+
+  /* Each unmap balances a successful map */
+  if (g_atomic_int_dec_and_test(&surface->map_count) && surface->mapped)
     if (klass->unmap) {
       klass->unmap(surface);
       surface->mapped = FALSE;
     }
 }
 
+/* Drops the CPU mapping cached by the surface. This is a no-op while the
+ * surface is still mapped by anyone, as their plane pointers would dangle */
+void
+gst_mfx_surface_invalidate_mapping(GstMfxSurface * surface)
+{
+  GstMfxSurfaceClass *const klass = GST_MFX_SURFACE_GET_CLASS(surface);
+
+  if (g_atomic_int_get(&surface->map_count) > 0)
+    return;
+
+  if (klass->invalidate)
+    klass->invalidate(surface);
+  surface->mapped = FALSE;
+}
+
 gboolean
 gst_mfx_surface_is_queued(GstMfxSurface * surface)
 {
@@ -536,3 +832,90 @@ gst_mfx_surface_dequeue(GstMfxSurface * surface)
   if (surface)
     g_atomic_int_set(&surface->queued, 0);
 }
+
+/**
+ * gst_mfx_surface_set_syncpoint:
+ * @surface: a #GstMfxSurface
+ * @session: the MFX session that issued the operation
+ * @syncp: the sync point of the operation writing to @surface, or %NULL
+ *
+ * Records the asynchronous operation that produces the contents of
+ * @surface. Components of joined sessions may consume the surface right
+ * away, components of other sessions wait on it through
+ * gst_mfx_surface_sync_for_aggregator(), and CPU and external consumers
+ * through gst_mfx_surface_sync().
+ */
+void
+gst_mfx_surface_set_syncpoint(GstMfxSurface * surface, mfxSession session,
+    mfxSyncPoint syncp)
+{
+  g_return_if_fail(surface != NULL);
+
+  surface->sync_session = session;
+  g_atomic_pointer_set(&surface->syncp, syncp);
+}
+
+/**
+ * gst_mfx_surface_sync:
+ * @surface: a #GstMfxSurface
+ *
+ * Waits for the pending operation recorded on @surface, if any.
+ *
+ * Return value: %TRUE if the surface contents are ready, %FALSE if the
+ *   operation failed
+ */
+gboolean
+gst_mfx_surface_sync(GstMfxSurface * surface)
+{
+  mfxSyncPoint syncp;
+  mfxStatus sts;
+
+  g_return_val_if_fail(surface != NULL, FALSE);
+
+  syncp = g_atomic_pointer_get(&surface->syncp);
+  if (!syncp)
+    return TRUE;
+
+  do {
+    sts = MFXVideoCORE_SyncOperation(surface->sync_session, syncp, 1000);
+    GST_DEBUG("MFXVideoCORE_SyncOperation status: %d", sts);
+  } while (MFX_WRN_IN_EXECUTION == sts);
+
+  /* Another consumer completed the operation first */
+  if (!g_atomic_pointer_compare_and_exchange(&surface->syncp, syncp, NULL))
+    return TRUE;
+
+  if (sts < 0) {
+    GST_ERROR("Failed to sync surface %" GST_MFX_ID_FORMAT " (%d)",
+        GST_MFX_ID_ARGS(surface->surface_id), sts);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * gst_mfx_surface_sync_for_aggregator:
+ * @surface: a #GstMfxSurface
+ * @aggregator: the #GstMfxTaskAggregator of the session about to read
+ *   @surface
+ *
+ * Waits for the pending operation recorded on @surface, unless it was
+ * issued by a session of @aggregator. Such sessions are joined, so the SDK
+ * orders their operations on the surface by itself.
+ *
+ * Return value: %TRUE if the surface can be consumed, %FALSE if the
+ *   operation failed
+ */
+gboolean
+gst_mfx_surface_sync_for_aggregator(GstMfxSurface * surface,
+    GstMfxTaskAggregator * aggregator)
+{
+  g_return_val_if_fail(surface != NULL, FALSE);
+  g_return_val_if_fail(aggregator != NULL, FALSE);
+
+  if (g_atomic_pointer_get(&surface->syncp)
+      && gst_mfx_task_aggregator_has_session(aggregator,
+          surface->sync_session))
+    return TRUE;
+  return gst_mfx_surface_sync(surface);
+}
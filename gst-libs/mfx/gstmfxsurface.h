@@ -60,6 +60,11 @@ gst_mfx_surface_new_from_task (GstMfxTask * task);
 GstMfxSurface *
 gst_mfx_surface_new_from_pool(GstMfxSurfacePool * pool);
 
+GstMfxSurface *
+gst_mfx_surface_new_from_data (const GstVideoInfo * info, guint8 * data,
+    gsize size, guint8 * planes[], const gint strides[], gpointer user_data,
+    GDestroyNotify destroy_func);
+
 GstMfxSurface *
 gst_mfx_surface_copy (GstMfxSurface * surface);
 
@@ -122,6 +127,17 @@ gst_mfx_surface_queue(GstMfxSurface * surface);
 void
 gst_mfx_surface_dequeue(GstMfxSurface * surface);
 
+void
+gst_mfx_surface_set_syncpoint(GstMfxSurface * surface, mfxSession session,
+    mfxSyncPoint syncp);
+
+gboolean
+gst_mfx_surface_sync(GstMfxSurface * surface);
+
+gboolean
+gst_mfx_surface_sync_for_aggregator(GstMfxSurface * surface,
+    GstMfxTaskAggregator * aggregator);
+
 G_END_DECLS
 
 #endif /* GST_MFX_SURFACE_H */
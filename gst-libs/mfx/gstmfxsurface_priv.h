@@ -36,6 +36,7 @@ typedef gboolean(*GstMfxSurfaceAllocateFunc) (GstMfxSurface * surface, GstMfxTas
 typedef void(*GstMfxSurfaceReleaseFunc) (GstMfxSurface * surface);
 typedef gboolean(*GstMfxSurfaceMapFunc) (GstMfxSurface * surface);
 typedef void(*GstMfxSurfaceUnmapFunc) (GstMfxSurface * surface);
+typedef void(*GstMfxSurfaceInvalidateFunc) (GstMfxSurface * surface);
 
 struct _GstMfxSurface
 {
@@ -54,14 +55,30 @@ struct _GstMfxSurface
   guint height;
   guint data_size;
   guint8 *data;
+  gsize alloc_size;
+  gboolean data_is_mapped;
   guchar *planes[3];
   guint16 pitches[3];
   gboolean mapped;
+  /* Number of users of the CPU mapping, which is only dropped at zero */
+  gint map_count;
   gboolean has_video_memory;
   mfxExtVPPVideoSignalInfo siginfo;
   mfxExtBuffer **ext_buf;
   guint queued;
 
+  /* Pending device operation writing to the surface */
+  mfxSession sync_session;
+  mfxSyncPoint syncp;
+
+  /* External memory wrapped by the surface */
+  gpointer user_data;
+  GDestroyNotify destroy_func;
+
+  /* Memory charged to the surface arena */
+  GstMfxDisplay *arena_owner;
+  guint64 arena_size;
+
   gint gem_bo_handle;
   gboolean is_gem_linear;
 
@@ -79,6 +96,7 @@ struct _GstMfxSurfaceClass
   GstMfxSurfaceReleaseFunc release;
   GstMfxSurfaceMapFunc map;
   GstMfxSurfaceUnmapFunc unmap;
+  GstMfxSurfaceInvalidateFunc invalidate;
 };
 
 GstMfxSurface *
@@ -86,6 +104,17 @@ gst_mfx_surface_new_internal(const GstMfxSurfaceClass * klass,
     GstMfxDisplay * display, const GstVideoInfo * info, GstMfxTask * task,
     gboolean is_linear);
 
+gboolean
+gst_mfx_surface_init_internal(GstMfxSurface * surface,
+    GstMfxDisplay * display, const GstVideoInfo * info, GstMfxTask * task,
+    gboolean is_linear);
+
+void
+gst_mfx_surface_invalidate_mapping(GstMfxSurface * surface);
+
+gboolean
+gst_mfx_surface_reserve_memory(GstMfxSurface * surface, guint64 size);
+
 #define gst_mfx_surface_ref_internal(surface) \
   ((gpointer)gst_mfx_mini_object_ref(GST_MFX_MINI_OBJECT(surface)))
 
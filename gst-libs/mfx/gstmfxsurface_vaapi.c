@@ -21,6 +21,7 @@
 #include "gstmfxsurface.h"
 #include "gstmfxsurface_priv.h"
 #include "gstmfxsurface_vaapi.h"
+#include "gstmfxsurfacearena.h"
 #include "gstmfxdisplay.h"
 #include "gstmfxutils_vaapi.h"
 
@@ -42,6 +43,11 @@ struct _GstMfxSurfaceVaapi
   GstMfxSurface parent_instance;
 
   VaapiImage *image;
+
+  /* DRM PRIME buffer to import, only valid while allocating */
+  const GstVideoInfo *import_info;
+  gint import_fd;
+  gsize import_size;
 };
 
 struct _GstMfxSurfaceVaapiClass
@@ -63,6 +69,69 @@ gst_mfx_surface_vaapi_from_task(GstMfxSurface * surface,
   return TRUE;
 }
 
+/* Wraps the external DRM PRIME buffer in a VA surface. The driver takes
+ * its own reference on the buffer, so the fd stays owned by the caller */
+static gboolean
+gst_mfx_surface_vaapi_import_dmabuf(GstMfxSurface * surface)
+{
+  GstMfxSurfaceVaapi *vaapi_surface = GST_MFX_SURFACE_VAAPI(surface);
+  const GstVideoInfo *info = vaapi_surface->import_info;
+  mfxFrameInfo *frame_info = &surface->surface.Info;
+  VASurfaceAttrib attribs[2];
+  VASurfaceAttribExternalBuffers external;
+  unsigned long handle = (unsigned long) vaapi_surface->import_fd;
+  VAStatus sts;
+  guint i;
+
+  memset (&external, 0, sizeof(external));
+  external.pixel_format =
+      gst_mfx_video_format_to_va_fourcc(frame_info->FourCC);
+  external.width = GST_VIDEO_INFO_WIDTH(info);
+  external.height = GST_VIDEO_INFO_HEIGHT(info);
+  external.data_size = vaapi_surface->import_size;
+  external.num_planes = GST_VIDEO_INFO_N_PLANES(info);
+  for (i = 0; i < external.num_planes; i++) {
+    external.offsets[i] = GST_VIDEO_INFO_PLANE_OFFSET(info, i);
+    external.pitches[i] = GST_VIDEO_INFO_PLANE_STRIDE(info, i);
+  }
+  /* I420 is imported as VA_FOURCC_YV12, which has its chroma planes in
+   * V, U order */
+  if (GST_VIDEO_INFO_FORMAT(info) == GST_VIDEO_FORMAT_I420) {
+    external.offsets[1] = GST_VIDEO_INFO_PLANE_OFFSET(info, 2);
+    external.pitches[1] = GST_VIDEO_INFO_PLANE_STRIDE(info, 2);
+    external.offsets[2] = GST_VIDEO_INFO_PLANE_OFFSET(info, 1);
+    external.pitches[2] = GST_VIDEO_INFO_PLANE_STRIDE(info, 1);
+  }
+  external.num_buffers = 1;
+  external.buffers = &handle;
+
+  memset (&attribs, 0, sizeof(attribs));
+  attribs[0].flags = VA_SURFACE_ATTRIB_SETTABLE;
+  attribs[0].type = VASurfaceAttribMemoryType;
+  attribs[0].value.type = VAGenericValueTypeInteger;
+  attribs[0].value.value.i = VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME;
+
+  attribs[1].flags = VA_SURFACE_ATTRIB_SETTABLE;
+  attribs[1].type = VASurfaceAttribExternalBufferDescriptor;
+  attribs[1].value.type = VAGenericValueTypePointer;
+  attribs[1].value.value.p = &external;
+
+  GST_MFX_DISPLAY_LOCK(surface->display);
+  sts = vaCreateSurfaces(GST_MFX_DISPLAY_VADISPLAY(surface->display),
+      gst_mfx_video_format_to_va_format(frame_info->FourCC),
+      frame_info->Width, frame_info->Height,
+      (VASurfaceID *) &surface->surface_id, 1, attribs, 2);
+  GST_MFX_DISPLAY_UNLOCK(surface->display);
+  if (!vaapi_check_status(sts, "vaCreateSurfaces ()"))
+    return FALSE;
+
+  surface->mem_id.mid = &surface->surface_id;
+  surface->mem_id.info = frame_info;
+  surface->surface.Data.MemId = &surface->mem_id;
+
+  return TRUE;
+}
+
 static gboolean
 gst_mfx_surface_vaapi_allocate(GstMfxSurface * surface, GstMfxTask * task)
 {
@@ -78,6 +147,15 @@ gst_mfx_surface_vaapi_allocate(GstMfxSurface * surface, GstMfxTask * task)
     VAStatus sts;
     int status_drm = 0;
 
+    /* Imported buffers belong to upstream, don't charge them */
+    if (GST_MFX_SURFACE_VAAPI(surface)->import_info)
+      return gst_mfx_surface_vaapi_import_dmabuf(surface);
+
+    /* Released from the arena when the surface is finalized */
+    if (!gst_mfx_surface_reserve_memory(surface,
+            gst_mfx_surface_arena_get_frame_size(frame_info)))
+      return FALSE;
+
     if (surface->is_gem_linear && fourcc == VA_FOURCC_NV12) {
       VASurfaceAttrib attribs[2];
       VASurfaceAttribExternalBuffers external;
@@ -190,10 +268,30 @@ done:
   }
 }
 
+static void
+gst_mfx_surface_vaapi_invalidate(GstMfxSurface * surface)
+{
+  GstMfxSurfaceVaapi *vaapi_surface = GST_MFX_SURFACE_VAAPI(surface);
+  guint i;
+
+  if (!vaapi_surface->image)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS(surface->planes); i++) {
+    surface->planes[i] = NULL;
+    surface->pitches[i] = 0;
+  }
+  vaapi_image_replace(&vaapi_surface->image, NULL);
+}
+
 static void
 gst_mfx_surface_vaapi_release(GstMfxSurface * surface)
 {
   VAStatus status;
+
+  /* The derived image has to go before the surface it was derived from */
+  gst_mfx_surface_vaapi_invalidate(surface);
+
   /* Don't destroy the underlying VASurface if originally from the task allocator*/
   if (!surface->task) {
     GST_MFX_DISPLAY_LOCK(surface->display);
@@ -213,21 +311,25 @@ gst_mfx_surface_vaapi_release(GstMfxSurface * surface)
   }
 }
 
+/* The derived image stays mapped until the surface is invalidated, which
+ * the pool does before the device writes to the surface again, so that
+ * repeated maps of the same contents don't cost any VA call */
 static gboolean
 gst_mfx_surface_vaapi_map(GstMfxSurface * surface)
 {
   GstMfxSurfaceVaapi *vaapi_surface = GST_MFX_SURFACE_VAAPI(surface);
   guint i, num_planes;
-  gboolean success = TRUE;
 
-  vaapi_surface->image = gst_mfx_surface_vaapi_derive_image(surface);
-  if (!vaapi_surface->image)
-    return FALSE;
+  if (!vaapi_surface->image) {
+    vaapi_surface->image = gst_mfx_surface_vaapi_derive_image(surface);
+    if (!vaapi_surface->image)
+      return FALSE;
+  }
 
   if (!vaapi_image_map(vaapi_surface->image)) {
     GST_ERROR ("Failed to map VA surface.");
-    success = FALSE;
-    goto done;
+    vaapi_image_replace(&vaapi_surface->image, NULL);
+    return FALSE;
   }
 
   num_planes = vaapi_image_get_plane_count(vaapi_surface->image);
@@ -243,23 +345,13 @@ gst_mfx_surface_vaapi_map(GstMfxSurface * surface)
         vaapi_image_get_offset(vaapi_surface->image, 1) / surface->width;
   }
 
-done:
-  vaapi_image_unref (vaapi_surface->image);
-  return success;
+  return TRUE;
 }
 
 static void
 gst_mfx_surface_vaapi_unmap(GstMfxSurface * surface)
 {
-  GstMfxSurfaceVaapi *vaapi_surface = GST_MFX_SURFACE_VAAPI(surface);
-  guint i, num_planes;
-
-  num_planes = vaapi_image_get_plane_count(vaapi_surface->image);
-  for (i = 0; i < num_planes; i++) {
-    surface->planes[i] = NULL;
-    surface->pitches[i] = 0;
-  }
-  vaapi_image_unmap(vaapi_surface->image);
+  /* Keep the cached mapping, see gst_mfx_surface_vaapi_invalidate() */
 }
 
 void
@@ -277,6 +369,7 @@ gst_mfx_surface_vaapi_class_init(GstMfxSurfaceVaapiClass * klass)
   surface_class->release = gst_mfx_surface_vaapi_release;
   surface_class->map = gst_mfx_surface_vaapi_map;
   surface_class->unmap = gst_mfx_surface_vaapi_unmap;
+  surface_class->invalidate = gst_mfx_surface_vaapi_invalidate;
 }
 
 static inline const GstMfxSurfaceClass *
@@ -307,6 +400,53 @@ gst_mfx_surface_vaapi_new(GstMfxDisplay * display, const GstVideoInfo * info,
         display, info, NULL, is_linear);
 }
 
+/**
+ * gst_mfx_surface_vaapi_new_from_dmabuf:
+ * @display: a #GstMfxDisplay
+ * @info: the #GstVideoInfo describing the planes inside the buffer
+ * @fd: the DRM PRIME file descriptor of the buffer
+ * @size: the size of the buffer
+ *
+ * Creates a VA surface backed by the external DRM PRIME buffer @fd,
+ * whose plane offsets and strides are given by @info. The caller keeps
+ * ownership of @fd, which must stay valid while the surface is in use.
+ *
+ * Return value: the newly allocated #GstMfxSurface object, or %NULL
+ *   if the driver could not import the buffer
+ */
+GstMfxSurface *
+gst_mfx_surface_vaapi_new_from_dmabuf(GstMfxDisplay * display,
+    const GstVideoInfo * info, gint fd, gsize size)
+{
+  GstMfxSurfaceVaapi *vaapi_surface;
+  GstMfxSurface *surface;
+
+  g_return_val_if_fail(display != NULL, NULL);
+  g_return_val_if_fail(info != NULL, NULL);
+  g_return_val_if_fail(fd >= 0, NULL);
+
+  surface = (GstMfxSurface *) gst_mfx_mini_object_new0(
+      GST_MFX_MINI_OBJECT_CLASS(gst_mfx_surface_vaapi_class()));
+  if (!surface)
+    return NULL;
+
+  vaapi_surface = GST_MFX_SURFACE_VAAPI(surface);
+  vaapi_surface->import_info = info;
+  vaapi_surface->import_fd = fd;
+  vaapi_surface->import_size = size;
+
+  if (!gst_mfx_surface_init_internal(surface, display, info, NULL, TRUE))
+    goto error;
+
+  vaapi_surface->import_info = NULL;
+  return surface;
+
+error:
+  vaapi_surface->import_info = NULL;
+  gst_mfx_surface_unref_internal(surface);
+  return NULL;
+}
+
 GstMfxSurface *
 gst_mfx_surface_vaapi_new_from_task(GstMfxTask * task)
 {
@@ -0,0 +1,535 @@
+/*
+ *  Copyright (C) 2016 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "sysdeps.h"
+
+#include "gstmfxsurfacearena.h"
+#include "gstmfxsurfacepool.h"
+
+#define DEBUG 1
+#include "gstmfxdebug.h"
+
+/**
+ * GstMfxSurfaceArena:
+ *
+ * Process-wide accounting of the memory backing MFX surfaces, in both
+ * system and video memory. Every surface allocation made by a surface,
+ * a surface pool or the task frame allocator is reserved here first.
+ *
+ * Allocations are charged against a per-process budget and against a
+ * per-pipeline quota. A pipeline is identified by the #GstMfxDisplay
+ * created by its task aggregator, which is shared by all its MFX elements.
+ * A budget or quota of 0 means unlimited, which is the default.
+ *
+ * The arena holds a reference on each owning display for as long as it
+ * has memory charged to it or a quota set on it, so that a display freed
+ * and reallocated at the same address can never inherit a stale entry.
+ *
+ * The initial configuration can be given through the environment:
+ * GST_MFX_MEMORY_BUDGET and GST_MFX_MEMORY_QUOTA take a size in bytes with
+ * an optional K, M or G suffix, and GST_MFX_MEMORY_POLICY is one of "fail",
+ * "block" or "evict".
+ */
+typedef struct _GstMfxSurfaceArena GstMfxSurfaceArena;
+typedef struct _ArenaOwner ArenaOwner;
+typedef struct _ArenaPool ArenaPool;
+
+struct _ArenaOwner
+{
+  GstMfxDisplay *display;
+  guint64 quota;
+  guint64 usage;
+  gboolean pinned;
+};
+
+struct _ArenaPool
+{
+  GstMfxDisplay *owner;
+  GstMfxSurfacePool *pool;
+};
+
+struct _GstMfxSurfaceArena
+{
+  GMutex mutex;
+  GCond cond;
+  guint64 budget;
+  guint64 usage;
+  guint64 default_quota;
+  GstMfxSurfaceArenaPolicy policy;
+  GHashTable *owners;
+
+  /* Surface pools that can give back memory on eviction. Guarded by a
+   * separate lock as trimming a pool releases memory into the arena */
+  GRecMutex pools_lock;
+  GList *pools;
+};
+
+/* Maximum time a BLOCK allocation waits for other pipelines to release
+ * memory before it fails, so that a stalled pipeline can not hang others */
+#define ARENA_BLOCK_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+static guint64
+parse_size (const gchar * str)
+{
+  gchar *end = NULL;
+  guint64 size;
+
+  if (!str)
+    return 0;
+
+  size = g_ascii_strtoull (str, &end, 10);
+  if (end) {
+    switch (g_ascii_toupper (*end)) {
+      case 'G':
+        size <<= 10;
+        /* fall through */
+      case 'M':
+        size <<= 10;
+        /* fall through */
+      case 'K':
+        size <<= 10;
+      default:
+        break;
+    }
+  }
+  return size;
+}
+
+static void
+arena_owner_free (ArenaOwner * entry)
+{
+  gst_mfx_display_unref (entry->display);
+  g_slice_free (ArenaOwner, entry);
+}
+
+static GstMfxSurfaceArenaPolicy
+parse_policy (const gchar * str)
+{
+  if (!g_strcmp0 (str, "block"))
+    return GST_MFX_SURFACE_ARENA_POLICY_BLOCK;
+  else if (!g_strcmp0 (str, "evict"))
+    return GST_MFX_SURFACE_ARENA_POLICY_EVICT;
+  return GST_MFX_SURFACE_ARENA_POLICY_FAIL;
+}
+
+static GstMfxSurfaceArena *
+get_arena (void)
+{
+  static GstMfxSurfaceArena arena;
+  static gsize arena_init = FALSE;
+
+  if (g_once_init_enter (&arena_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_debug_mfx, "mfx", 0, "MFX helper");
+
+    g_mutex_init (&arena.mutex);
+    g_cond_init (&arena.cond);
+    g_rec_mutex_init (&arena.pools_lock);
+    arena.owners = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify) arena_owner_free);
+    arena.budget = parse_size (g_getenv ("GST_MFX_MEMORY_BUDGET"));
+    arena.default_quota = parse_size (g_getenv ("GST_MFX_MEMORY_QUOTA"));
+    arena.policy = parse_policy (g_getenv ("GST_MFX_MEMORY_POLICY"));
+
+    if (arena.budget || arena.default_quota)
+      GST_INFO ("Surface memory budget %" G_GUINT64_FORMAT
+          " bytes, pipeline quota %" G_GUINT64_FORMAT " bytes",
+          arena.budget, arena.default_quota);
+
+    g_once_init_leave (&arena_init, TRUE);
+  }
+  return &arena;
+}
+
+static ArenaOwner *
+lookup_owner_unlocked (GstMfxSurfaceArena * arena, GstMfxDisplay * owner,
+    gboolean create)
+{
+  ArenaOwner *entry;
+
+  if (!owner)
+    return NULL;
+
+  entry = g_hash_table_lookup (arena->owners, owner);
+  if (!entry && create) {
+    entry = g_slice_new0 (ArenaOwner);
+    entry->display = gst_mfx_display_ref (owner);
+    entry->quota = arena->default_quota;
+    g_hash_table_insert (arena->owners, owner, entry);
+  }
+  return entry;
+}
+
+/* Drops the entry of an owner with nothing charged to it, unless a quota
+ * was explicitly set and the owner has not been removed yet */
+static void
+prune_owner_unlocked (GstMfxSurfaceArena * arena, ArenaOwner * entry)
+{
+  if (entry && !entry->usage && !entry->pinned)
+    g_hash_table_remove (arena->owners, entry->display);
+}
+
+static gboolean
+exceeds_quota (ArenaOwner * entry, guint64 size)
+{
+  return entry && entry->quota && entry->usage + size > entry->quota;
+}
+
+static gboolean
+exceeds_budget (GstMfxSurfaceArena * arena, guint64 size)
+{
+  return arena->budget && arena->usage + size > arena->budget;
+}
+
+static void
+evict_idle_pools (GstMfxSurfaceArena * arena, GstMfxDisplay * owner)
+{
+  GList *l;
+
+  g_rec_mutex_lock (&arena->pools_lock);
+  for (l = arena->pools; l; l = l->next) {
+    ArenaPool *p = l->data;
+
+    if (!owner || p->owner == owner)
+      gst_mfx_surface_pool_trim (p->pool);
+  }
+  g_rec_mutex_unlock (&arena->pools_lock);
+}
+
+void
+gst_mfx_surface_arena_set_budget (guint64 budget)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+
+  g_mutex_lock (&arena->mutex);
+  arena->budget = budget;
+  g_cond_broadcast (&arena->cond);
+  g_mutex_unlock (&arena->mutex);
+}
+
+guint64
+gst_mfx_surface_arena_get_budget (void)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  guint64 budget;
+
+  g_mutex_lock (&arena->mutex);
+  budget = arena->budget;
+  g_mutex_unlock (&arena->mutex);
+
+  return budget;
+}
+
+guint64
+gst_mfx_surface_arena_get_usage (void)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  guint64 usage;
+
+  g_mutex_lock (&arena->mutex);
+  usage = arena->usage;
+  g_mutex_unlock (&arena->mutex);
+
+  return usage;
+}
+
+void
+gst_mfx_surface_arena_set_policy (GstMfxSurfaceArenaPolicy policy)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+
+  g_mutex_lock (&arena->mutex);
+  arena->policy = policy;
+  g_cond_broadcast (&arena->cond);
+  g_mutex_unlock (&arena->mutex);
+}
+
+GstMfxSurfaceArenaPolicy
+gst_mfx_surface_arena_get_policy (void)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  GstMfxSurfaceArenaPolicy policy;
+
+  g_mutex_lock (&arena->mutex);
+  policy = arena->policy;
+  g_mutex_unlock (&arena->mutex);
+
+  return policy;
+}
+
+void
+gst_mfx_surface_arena_set_quota (GstMfxDisplay * owner, guint64 quota)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaOwner *entry;
+
+  g_return_if_fail (owner != NULL);
+
+  g_mutex_lock (&arena->mutex);
+  entry = lookup_owner_unlocked (arena, owner, TRUE);
+  entry->quota = quota;
+  entry->pinned = TRUE;
+  g_cond_broadcast (&arena->cond);
+  g_mutex_unlock (&arena->mutex);
+}
+
+/**
+ * gst_mfx_surface_arena_get_available:
+ * @owner: the pipeline key, or %NULL
+ *
+ * Returns the number of bytes that @owner may still allocate without
+ * exceeding either the per-process budget or its own quota. This is meant
+ * to be used for admission control before starting a new pipeline.
+ *
+ * Returns: the available size in bytes, or G_MAXUINT64 if unlimited.
+ */
+guint64
+gst_mfx_surface_arena_get_available (GstMfxDisplay * owner)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaOwner *entry;
+  guint64 available = G_MAXUINT64;
+  guint64 quota;
+
+  g_mutex_lock (&arena->mutex);
+  if (arena->budget)
+    available = arena->budget > arena->usage ?
+        arena->budget - arena->usage : 0;
+
+  entry = lookup_owner_unlocked (arena, owner, FALSE);
+  quota = entry ? entry->quota : (owner ? arena->default_quota : 0);
+  if (quota) {
+    guint64 used = entry ? entry->usage : 0;
+    available = MIN (available, quota > used ? quota - used : 0);
+  }
+  g_mutex_unlock (&arena->mutex);
+
+  return available;
+}
+
+/**
+ * gst_mfx_surface_arena_remove_owner:
+ * @owner: the pipeline key
+ *
+ * Forgets the quota of @owner. Its entry, and the reference held on it,
+ * is only dropped once all the memory charged to it has been released.
+ */
+void
+gst_mfx_surface_arena_remove_owner (GstMfxDisplay * owner)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaOwner *entry;
+
+  if (!owner)
+    return;
+
+  g_mutex_lock (&arena->mutex);
+  entry = lookup_owner_unlocked (arena, owner, FALSE);
+  if (entry) {
+    entry->pinned = FALSE;
+    prune_owner_unlocked (arena, entry);
+  }
+  g_mutex_unlock (&arena->mutex);
+}
+
+/**
+ * gst_mfx_surface_arena_reserve:
+ * @owner: the pipeline key, or %NULL if the allocation is not bound
+ *   to any pipeline
+ * @size: the size in bytes to be allocated
+ *
+ * Charges @size bytes against the per-process budget and the quota of
+ * @owner. If the allocation does not fit, the configured
+ * #GstMfxSurfaceArenaPolicy is applied.
+ *
+ * With %GST_MFX_SURFACE_ARENA_POLICY_BLOCK, only the per-process budget is
+ * waited for, and for at most ARENA_BLOCK_TIMEOUT. Memory over the quota
+ * of @owner can only be released by the pipeline of @owner itself, which
+ * may well be blocked on this very call, so the allocation fails instead.
+ *
+ * Returns: %TRUE if the memory may be allocated, %FALSE otherwise.
+ */
+gboolean
+gst_mfx_surface_arena_reserve (GstMfxDisplay * owner, guint64 size)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaOwner *entry;
+  gboolean evicted = FALSE;
+  gint64 deadline = 0;
+
+  g_mutex_lock (&arena->mutex);
+  entry = lookup_owner_unlocked (arena, owner, TRUE);
+
+  while (exceeds_budget (arena, size) || exceeds_quota (entry, size)) {
+    /* Requests larger than the limit itself can never be satisfied */
+    if ((arena->budget && size > arena->budget)
+        || (entry && entry->quota && size > entry->quota))
+      goto error_over_budget;
+
+    if (arena->policy == GST_MFX_SURFACE_ARENA_POLICY_BLOCK) {
+      if (exceeds_quota (entry, size))
+        goto error_over_budget;
+
+      if (!deadline)
+        deadline = g_get_monotonic_time () + ARENA_BLOCK_TIMEOUT;
+
+      GST_DEBUG ("Waiting for %" G_GUINT64_FORMAT " bytes of surface memory",
+          size);
+      if (!g_cond_wait_until (&arena->cond, &arena->mutex, deadline)
+          && exceeds_budget (arena, size))
+        goto error_timeout;
+
+      /* The owner entry may have been dropped while waiting */
+      entry = lookup_owner_unlocked (arena, owner, TRUE);
+    }
+    else if (arena->policy == GST_MFX_SURFACE_ARENA_POLICY_EVICT && !evicted) {
+      GstMfxDisplay *victim = exceeds_budget (arena, size) ? NULL : owner;
+
+      g_mutex_unlock (&arena->mutex);
+      evict_idle_pools (arena, victim);
+      g_mutex_lock (&arena->mutex);
+
+      /* The owner entry may have been dropped while unlocked */
+      entry = lookup_owner_unlocked (arena, owner, TRUE);
+      evicted = TRUE;
+    }
+    else
+      goto error_over_budget;
+  }
+
+  arena->usage += size;
+  if (entry)
+    entry->usage += size;
+  g_mutex_unlock (&arena->mutex);
+
+  return TRUE;
+
+  /* ERRORS */
+error_over_budget:
+  {
+    GST_ERROR ("Unable to allocate %" G_GUINT64_FORMAT " bytes of surface "
+        "memory: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " bytes in use",
+        size, arena->usage, arena->budget);
+    prune_owner_unlocked (arena, entry);
+    g_mutex_unlock (&arena->mutex);
+    return FALSE;
+  }
+error_timeout:
+  {
+    GST_ERROR ("Timed out waiting for %" G_GUINT64_FORMAT " bytes of surface "
+        "memory: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " bytes in use",
+        size, arena->usage, arena->budget);
+    prune_owner_unlocked (arena, entry);
+    g_mutex_unlock (&arena->mutex);
+    return FALSE;
+  }
+}
+
+void
+gst_mfx_surface_arena_release (GstMfxDisplay * owner, guint64 size)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaOwner *entry;
+
+  if (!size)
+    return;
+
+  g_mutex_lock (&arena->mutex);
+  arena->usage -= MIN (size, arena->usage);
+
+  entry = lookup_owner_unlocked (arena, owner, FALSE);
+  if (entry) {
+    entry->usage -= MIN (size, entry->usage);
+    prune_owner_unlocked (arena, entry);
+  }
+
+  g_cond_broadcast (&arena->cond);
+  g_mutex_unlock (&arena->mutex);
+}
+
+/**
+ * gst_mfx_surface_arena_get_frame_size:
+ * @info: the #mfxFrameInfo of the surface
+ *
+ * Returns the size in bytes of a single surface with the aligned dimensions
+ * of @info, as used for accounting in the arena.
+ */
+guint64
+gst_mfx_surface_arena_get_frame_size (const mfxFrameInfo * info)
+{
+  guint64 frame_size;
+
+  g_return_val_if_fail (info != NULL, 0);
+
+  frame_size = (guint64) info->Width * info->Height;
+
+  switch (info->FourCC) {
+    case MFX_FOURCC_NV12:
+    case MFX_FOURCC_YV12:
+      return frame_size * 3 / 2;
+    case MFX_FOURCC_YUY2:
+    case MFX_FOURCC_UYVY:
+      return frame_size * 2;
+    case MFX_FOURCC_RGB4:
+      return frame_size * 4;
+    case MFX_FOURCC_P010:
+      return frame_size * 3;
+    default:
+      return 0;
+  }
+}
+
+void
+gst_mfx_surface_arena_add_pool (GstMfxDisplay * owner,
+    GstMfxSurfacePool * pool)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  ArenaPool *p;
+
+  g_return_if_fail (pool != NULL);
+
+  p = g_slice_new (ArenaPool);
+  p->owner = owner ? gst_mfx_display_ref (owner) : NULL;
+  p->pool = pool;
+
+  g_rec_mutex_lock (&arena->pools_lock);
+  arena->pools = g_list_prepend (arena->pools, p);
+  g_rec_mutex_unlock (&arena->pools_lock);
+}
+
+void
+gst_mfx_surface_arena_remove_pool (GstMfxSurfacePool * pool)
+{
+  GstMfxSurfaceArena *arena = get_arena ();
+  GList *l;
+
+  g_rec_mutex_lock (&arena->pools_lock);
+  for (l = arena->pools; l; l = l->next) {
+    ArenaPool *p = l->data;
+
+    if (p->pool == pool) {
+      if (p->owner)
+        gst_mfx_display_unref (p->owner);
+      g_slice_free (ArenaPool, p);
+      arena->pools = g_list_delete_link (arena->pools, l);
+      break;
+    }
+  }
+  g_rec_mutex_unlock (&arena->pools_lock);
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2016 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_SURFACE_ARENA_H
+#define GST_MFX_SURFACE_ARENA_H
+
+#include "sysdeps.h"
+#include "gstmfxdisplay.h"
+#include "gstmfxsurfacepool.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GstMfxSurfaceArenaPolicy:
+ * @GST_MFX_SURFACE_ARENA_POLICY_FAIL: fail the allocation, which in turn
+ *   fails the initialization / negotiation of the requesting element.
+ * @GST_MFX_SURFACE_ARENA_POLICY_BLOCK: block the allocating thread until
+ *   enough memory has been released by other pipelines, with a timeout.
+ *   Allocations over the quota of their own pipeline fail right away.
+ * @GST_MFX_SURFACE_ARENA_POLICY_EVICT: drop the cached surfaces of idle
+ *   surface pools, then fail if the request still does not fit.
+ *
+ * Behavior of the surface arena when an allocation would exceed either the
+ * per-process budget or the per-pipeline quota.
+ */
+typedef enum {
+  GST_MFX_SURFACE_ARENA_POLICY_FAIL = 0,
+  GST_MFX_SURFACE_ARENA_POLICY_BLOCK,
+  GST_MFX_SURFACE_ARENA_POLICY_EVICT,
+} GstMfxSurfaceArenaPolicy;
+
+void
+gst_mfx_surface_arena_set_budget (guint64 budget);
+
+guint64
+gst_mfx_surface_arena_get_budget (void);
+
+guint64
+gst_mfx_surface_arena_get_usage (void);
+
+void
+gst_mfx_surface_arena_set_policy (GstMfxSurfaceArenaPolicy policy);
+
+GstMfxSurfaceArenaPolicy
+gst_mfx_surface_arena_get_policy (void);
+
+void
+gst_mfx_surface_arena_set_quota (GstMfxDisplay * owner, guint64 quota);
+
+guint64
+gst_mfx_surface_arena_get_available (GstMfxDisplay * owner);
+
+void
+gst_mfx_surface_arena_remove_owner (GstMfxDisplay * owner);
+
+gboolean
+gst_mfx_surface_arena_reserve (GstMfxDisplay * owner, guint64 size);
+
+void
+gst_mfx_surface_arena_release (GstMfxDisplay * owner, guint64 size);
+
+guint64
+gst_mfx_surface_arena_get_frame_size (const mfxFrameInfo * info);
+
+void
+gst_mfx_surface_arena_add_pool (GstMfxDisplay * owner,
+    GstMfxSurfacePool * pool);
+
+void
+gst_mfx_surface_arena_remove_pool (GstMfxSurfacePool * pool);
+
+G_END_DECLS
+
+#endif /* GST_MFX_SURFACE_ARENA_H */
@@ -45,18 +45,68 @@ destroy_subpicture (GstMfxSubpicture * subpicture)
   g_slice_free(GstMfxSubpicture, subpicture);
 }
 
+/* Looks up the subpicture uploaded from the same rectangle pixels for the
+ * previous frame, so that static overlays are not uploaded again */
+static GstMfxSubpicture *
+find_cached_subpicture (GstMfxSurfaceComposition * composition,
+  GstMfxSurfaceComposition * previous, guint seqnum,
+  const GstMfxRectangle * sub_rect)
+{
+  GstMfxSubpicture *subpicture;
+  gboolean has_video_memory;
+  guint i;
+
+  if (!previous)
+    return NULL;
+
+  /* Overlays are uploaded to the memory type of the base surface */
+  has_video_memory =
+      gst_mfx_surface_has_video_memory (composition->base_surface);
+
+  for (i = 0; i < previous->subpictures->len; i++) {
+    subpicture = g_ptr_array_index(previous->subpictures, i);
+    if (subpicture->pixel_alpha && subpicture->seqnum == seqnum
+        && subpicture->sub_rect.width == sub_rect->width
+        && subpicture->sub_rect.height == sub_rect->height
+        && gst_mfx_surface_has_video_memory (subpicture->surface) ==
+            has_video_memory)
+      return subpicture;
+  }
+  return NULL;
+}
+
 static gboolean
 create_subpicture (GstMfxSurfaceComposition * composition,
-  GstVideoOverlayRectangle * rect)
+  GstVideoOverlayRectangle * rect, GstMfxSurfaceComposition * previous)
 {
-  GstMfxSubpicture *subpicture;
+  GstMfxSubpicture *subpicture, *cached;
+  GstMfxRectangle sub_rect;
   GstBuffer *buffer;
   GstVideoMeta *vmeta;
   guint8 *data;
-  guint stride;
+  guint stride, seqnum;
   GstMapInfo map_info;
   GstVideoInfo info;
 
+  gst_video_overlay_rectangle_get_render_rectangle(rect,
+    (gint *)& sub_rect.x, (gint *)& sub_rect.y,
+    &sub_rect.width, &sub_rect.height);
+  seqnum = gst_video_overlay_rectangle_get_seqnum(rect);
+
+  cached = find_cached_subpicture (composition, previous, seqnum, &sub_rect);
+  if (cached) {
+    subpicture = g_slice_new0(GstMfxSubpicture);
+    subpicture->surface = gst_mfx_surface_ref (cached->surface);
+    subpicture->sub_rect = sub_rect;
+    subpicture->global_alpha =
+        gst_video_overlay_rectangle_get_global_alpha(rect);
+    subpicture->pixel_alpha = TRUE;
+    subpicture->seqnum = seqnum;
+
+    g_ptr_array_add(composition->subpictures, subpicture);
+    return TRUE;
+  }
+
   gst_video_info_init(&info);
 
   buffer = gst_video_overlay_rectangle_get_pixels_unscaled_argb (rect,
@@ -89,9 +139,8 @@ create_subpicture (GstMfxSurfaceComposition * composition,
   if (!subpicture->surface)
     return FALSE;
 
-  gst_video_overlay_rectangle_get_render_rectangle(rect,
-    (gint *)& subpicture->sub_rect.x, (gint *)& subpicture->sub_rect.y,
-    &subpicture->sub_rect.width, &subpicture->sub_rect.height);
+  subpicture->sub_rect = sub_rect;
+  subpicture->seqnum = seqnum;
 
   if (!gst_mfx_surface_map(subpicture->surface))
     goto error;
@@ -113,6 +162,7 @@ create_subpicture (GstMfxSurfaceComposition * composition,
   gst_video_meta_unmap(vmeta, 0, &map_info);
 
   subpicture->global_alpha = gst_video_overlay_rectangle_get_global_alpha(rect);
+  subpicture->pixel_alpha = TRUE;
 
   g_ptr_array_add(composition->subpictures, subpicture);
 
@@ -125,7 +175,7 @@ error:
 static gboolean
 gst_mfx_create_surfaces_from_composition(
   GstMfxSurfaceComposition * composition,
-  GstVideoOverlayComposition * overlay)
+  GstVideoOverlayComposition * overlay, GstMfxSurfaceComposition * previous)
 {
   guint n, nb_rectangles;
 
@@ -142,7 +192,7 @@ gst_mfx_create_surfaces_from_composition(
     if (!GST_IS_VIDEO_OVERLAY_RECTANGLE(rect))
       continue;
 
-    if (!create_subpicture(composition, rect)) {
+    if (!create_subpicture(composition, rect, previous)) {
       GST_WARNING("could not create subpicture %p", rect);
       return FALSE;
     }
@@ -153,7 +203,7 @@ gst_mfx_create_surfaces_from_composition(
 void
 gst_mfx_surface_composition_finalize(GstMfxSurfaceComposition * composition)
 {
-  gst_mfx_surface_unref (composition->base_surface);
+  gst_mfx_surface_replace (&composition->base_surface, NULL);
   g_ptr_array_free (composition->subpictures, TRUE);
 }
 
@@ -167,9 +217,21 @@ gst_mfx_surface_composition_class(void)
   return &GstMfxSubpictureCompositionClass;
 }
 
+/**
+ * gst_mfx_surface_composition_new:
+ * @base_surface: the #GstMfxSurface to blend the overlay onto
+ * @overlay: the #GstVideoOverlayComposition to blend
+ * @previous: (allow-none): the composition created for the previous frame
+ *
+ * Creates a composition of the rectangles of @overlay above @base_surface.
+ * The rectangles whose pixels and render size are unchanged since
+ * @previous reuse its uploaded surfaces instead of being copied again.
+ *
+ * Return value: the newly allocated #GstMfxSurfaceComposition object
+ */
 GstMfxSurfaceComposition *
 gst_mfx_surface_composition_new (GstMfxSurface * base_surface,
-  GstVideoOverlayComposition * overlay)
+  GstVideoOverlayComposition * overlay, GstMfxSurfaceComposition * previous)
 {
   GstMfxSurfaceComposition *composition;
 
@@ -184,7 +246,8 @@ gst_mfx_surface_composition_new (GstMfxSurface * base_surface,
   composition->base_surface = gst_mfx_surface_ref (base_surface);
   composition->subpictures =
       g_ptr_array_new_with_free_func((GDestroyNotify)destroy_subpicture);
-  if (!gst_mfx_create_surfaces_from_composition(composition, overlay))
+  if (!gst_mfx_create_surfaces_from_composition(composition, overlay,
+          previous))
     goto error;
 
   return composition;
@@ -193,6 +256,62 @@ error:
   return NULL;
 }
 
+/**
+ * gst_mfx_surface_composition_new_empty:
+ *
+ * Creates a composition without base surface, to which the surfaces to
+ * blend are added with gst_mfx_surface_composition_add_surface(). The
+ * output of the composition is then a background of the size set on the
+ * composite filter.
+ *
+ * Return value: the newly allocated #GstMfxSurfaceComposition object
+ */
+GstMfxSurfaceComposition *
+gst_mfx_surface_composition_new_empty (void)
+{
+  GstMfxSurfaceComposition *composition;
+
+  composition = (GstMfxSurfaceComposition *)
+                  gst_mfx_mini_object_new0(gst_mfx_surface_composition_class());
+  if (!composition)
+    return NULL;
+
+  composition->subpictures =
+      g_ptr_array_new_with_free_func((GDestroyNotify)destroy_subpicture);
+  return composition;
+}
+
+/**
+ * gst_mfx_surface_composition_add_surface:
+ * @composition: a #GstMfxSurfaceComposition
+ * @surface: the #GstMfxSurface to blend
+ * @rect: the destination rectangle of @surface in the output
+ * @global_alpha: the opacity of @surface, between 0 and 1
+ *
+ * Appends @surface above the surfaces already in @composition. The
+ * cropped region of @surface is scaled to @rect.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+gst_mfx_surface_composition_add_surface (GstMfxSurfaceComposition * composition,
+  GstMfxSurface * surface, const GstMfxRectangle * rect, gfloat global_alpha)
+{
+  GstMfxSubpicture *subpicture;
+
+  g_return_val_if_fail(composition != NULL, FALSE);
+  g_return_val_if_fail(surface != NULL, FALSE);
+  g_return_val_if_fail(rect != NULL, FALSE);
+
+  subpicture = g_slice_new0(GstMfxSubpicture);
+  subpicture->surface = gst_mfx_surface_ref (surface);
+  subpicture->sub_rect = *rect;
+  subpicture->global_alpha = CLAMP (global_alpha, 0.0, 1.0);
+
+  g_ptr_array_add(composition->subpictures, subpicture);
+  return TRUE;
+}
+
 GstMfxSurfaceComposition *
 gst_mfx_surface_composition_ref (GstMfxSurfaceComposition * composition)
 {
@@ -40,11 +40,20 @@ struct _GstMfxSubpicture
   GstMfxSurface *surface;
   gfloat global_alpha;
   GstMfxRectangle sub_rect;
+  gboolean pixel_alpha;
+  guint seqnum;
 };
 
 GstMfxSurfaceComposition *
 gst_mfx_surface_composition_new (GstMfxSurface * base_surface,
-  GstVideoOverlayComposition * overlay);
+  GstVideoOverlayComposition * overlay, GstMfxSurfaceComposition * previous);
+
+GstMfxSurfaceComposition *
+gst_mfx_surface_composition_new_empty (void);
+
+gboolean
+gst_mfx_surface_composition_add_surface (GstMfxSurfaceComposition * composition,
+  GstMfxSurface * surface, const GstMfxRectangle * rect, gfloat global_alpha);
 
 GstMfxSurfaceComposition *
 gst_mfx_surface_composition_ref (GstMfxSurfaceComposition * composition);
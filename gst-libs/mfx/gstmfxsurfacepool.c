@@ -22,7 +22,9 @@
 
 #include "gstmfxsurfacepool.h"
 #include "gstmfxsurface.h"
+#include "gstmfxsurface_priv.h"
 #include "gstmfxsurface_vaapi.h"
+#include "gstmfxsurfacearena.h"
 #include "gstmfxminiobject.h"
 
 #define DEBUG 1
@@ -99,6 +101,19 @@ gst_mfx_surface_pool_init (GstMfxSurfacePool * pool)
 
   if (pool->task)
     gst_mfx_surface_pool_add_surfaces(pool);
+
+  /* Video memory surfaces from a task allocator are owned by the task
+   * and cannot be recreated on demand, hence they are never evicted */
+  if (!pool->task || pool->memtype_is_system) {
+    GstMfxDisplay *owner = pool->display;
+
+    if (!owner) {
+      GstMfxDisplay *display = gst_mfx_task_get_display (pool->task);
+      owner = display;
+      gst_mfx_display_unref (display);
+    }
+    gst_mfx_surface_arena_add_pool (owner, pool);
+  }
 }
 
 void
@@ -106,6 +121,8 @@ gst_mfx_surface_pool_finalize (GstMfxSurfacePool * pool)
 {
   GstMfxSurface *surface;
 
+  gst_mfx_surface_arena_remove_pool (pool);
+
   while (g_list_length(pool->used_surfaces)) {
     surface = g_list_nth_data (pool->used_surfaces, 0);
     gst_mfx_surface_pool_put_surface(pool, surface);
@@ -231,7 +248,14 @@ gst_mfx_surface_pool_get_surface_unlocked (GstMfxSurfacePool * pool)
   GstMfxSurface *surface;
 
   surface = g_queue_pop_head (&pool->free_surfaces);
-  if (!surface) {
+  if (surface) {
+    /* The surface is handed out for the device to write to, which may go
+     * to storage that the cached mapping does not reflect, e.g. with tiled
+     * or compressed layouts, so map it again afterwards */
+    gst_mfx_surface_set_syncpoint (surface, NULL, NULL);
+    gst_mfx_surface_invalidate_mapping (surface);
+  }
+  else {
     g_mutex_unlock (&pool->mutex);
     if (pool->task) {
       surface = gst_mfx_surface_new_from_task (pool->task);
@@ -281,3 +305,68 @@ gst_mfx_surface_pool_find_surface (GstMfxSurfacePool * pool,
 
   return GST_MFX_SURFACE (l->data);
 }
+
+/**
+ * gst_mfx_surface_pool_detach_surface:
+ * @pool: a #GstMfxSurfacePool
+ * @surface: a #GstMfxSurface obtained from @pool
+ *
+ * Hands the ownership of @surface over to the caller. @pool stops tracking
+ * it, so that it is no longer recycled once the SDK unlocks it, and it is
+ * destroyed with its last reference instead of being returned to @pool.
+ */
+void
+gst_mfx_surface_pool_detach_surface (GstMfxSurfacePool * pool,
+    GstMfxSurface * surface)
+{
+  GList *elem;
+
+  g_return_if_fail (pool != NULL);
+  g_return_if_fail (surface != NULL);
+
+  g_mutex_lock (&pool->mutex);
+  elem = g_list_find (pool->used_surfaces, surface);
+  if (elem) {
+    --pool->used_count;
+    pool->used_surfaces = g_list_delete_link (pool->used_surfaces, elem);
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  if (elem)
+    gst_mfx_surface_unref (surface);
+}
+
+/**
+ * gst_mfx_surface_pool_trim:
+ * @pool: a #GstMfxSurfacePool
+ *
+ * Releases the cached surfaces of @pool if none of its surfaces is
+ * currently in use. Surfaces are allocated again on demand.
+ *
+ * Returns: the number of surfaces released.
+ */
+guint
+gst_mfx_surface_pool_trim (GstMfxSurfacePool * pool)
+{
+  GQueue surfaces = G_QUEUE_INIT;
+  GstMfxSurface *surface;
+  guint num_surfaces;
+
+  g_return_val_if_fail (pool != NULL, 0);
+
+  g_mutex_lock (&pool->mutex);
+  if (!pool->used_count) {
+    surfaces = pool->free_surfaces;
+    g_queue_init (&pool->free_surfaces);
+  }
+  g_mutex_unlock (&pool->mutex);
+
+  num_surfaces = g_queue_get_length (&surfaces);
+  while ((surface = g_queue_pop_head (&surfaces)))
+    gst_mfx_surface_unref (surface);
+
+  if (num_surfaces)
+    GST_DEBUG ("Evicted %u idle surfaces from pool %p", num_surfaces, pool);
+
+  return num_surfaces;
+}
@@ -50,6 +50,13 @@ gst_mfx_surface_pool_replace (GstMfxSurfacePool ** old_pool_ptr,
 GstMfxSurface *
 gst_mfx_surface_pool_get_surface (GstMfxSurfacePool * pool);
 
+void
+gst_mfx_surface_pool_detach_surface (GstMfxSurfacePool * pool,
+    GstMfxSurface * surface);
+
+guint
+gst_mfx_surface_pool_trim (GstMfxSurfacePool * pool);
+
 GstMfxSurface *
 gst_mfx_surface_pool_find_surface (GstMfxSurfacePool * pool,
     mfxFrameSurface1 * surface);
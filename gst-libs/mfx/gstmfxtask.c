@@ -20,6 +20,7 @@
 
 #include "gstmfxtask.h"
 #include "gstmfxtaskaggregator.h"
+#include "gstmfxsurfacearena.h"
 #include "gstmfxutils_vaapi.h"
 #include "video-format.h"
 #include "gstmfxtypes.h"
@@ -38,6 +39,7 @@ struct _ResponseData
   mfxFrameAllocResponse *response;
   mfxFrameInfo frame_info;
   guint num_used;
+  guint64 arena_size;
 };
 
 struct _GstMfxTask
@@ -58,9 +60,11 @@ struct _GstMfxTask
   gboolean soft_reinit;
   mfxU16 backup_num_surfaces;
   VASurfaceID *backup_surfaces;
+  guint64 backup_arena_size;
 
   /* using for system memory */
   mfxU16 num_surfaces;
+  GstMfxSystemMemoryParams sysmem_params;
 };
 
 static gint
@@ -140,10 +144,18 @@ gst_mfx_task_frame_alloc (mfxHDL pthis, mfxFrameAllocRequest * req,
 	goto error_allocate_memory;
       }
       response_data->surfaces = task->backup_surfaces;
+      response_data->arena_size = task->backup_arena_size;
       task->soft_reinit = FALSE;
       task->backup_num_surfaces = 0;
       task->backup_surfaces = NULL;
+      task->backup_arena_size = 0;
     } else {
+      guint64 size = num_surfaces * gst_mfx_surface_arena_get_frame_size (info);
+
+      if (!gst_mfx_surface_arena_reserve (task->display, size))
+        goto error_allocate_memory;
+      response_data->arena_size = size;
+
       response_data->surfaces =
           g_slice_alloc0 (num_surfaces * sizeof (VASurfaceID));
 
@@ -179,6 +191,11 @@ gst_mfx_task_frame_alloc (mfxHDL pthis, mfxFrameAllocRequest * req,
     int width32 =  32 * ((req->Info.Width + 31) >> 5);
     int height32 = 32 * ((req->Info.Height + 31) >> 5);
     int codedbuf_size = (width32 * height32) * 400LL / (16 * 16);
+    guint64 size = (guint64) num_surfaces * codedbuf_size;
+
+    if (!gst_mfx_surface_arena_reserve (task->display, size))
+      goto error_allocate_memory;
+    response_data->arena_size = size;
 
     response_data->coded_buf =
         g_slice_alloc (num_surfaces * sizeof (VABufferID));
@@ -209,6 +226,8 @@ gst_mfx_task_frame_alloc (mfxHDL pthis, mfxFrameAllocRequest * req,
 
 error_allocate_memory:
   {
+    gst_mfx_surface_arena_release (task->display, response_data->arena_size);
+
     if (response_data->coded_buf)
       g_slice_free1 (num_surfaces * sizeof (VABufferID),
           response_data->coded_buf);
@@ -250,6 +269,7 @@ gst_mfx_task_frame_free (mfxHDL pthis, mfxFrameAllocResponse * resp)
     if (task->soft_reinit) {
       task->backup_num_surfaces = num_surfaces;
       task->backup_surfaces = response_data->surfaces;
+      task->backup_arena_size = response_data->arena_size;
     } else {
       GST_MFX_DISPLAY_LOCK (task->display);
       vaDestroySurfaces (GST_MFX_DISPLAY_VADISPLAY (task->display),
@@ -274,6 +294,9 @@ gst_mfx_task_frame_free (mfxHDL pthis, mfxFrameAllocResponse * resp)
       response_data->mem_ids);
   g_slice_free1 (num_surfaces * sizeof (mfxMemId), response_data->mids);
 
+  if (!task->soft_reinit || info->FourCC == MFX_FOURCC_P8)
+    gst_mfx_surface_arena_release (task->display, response_data->arena_size);
+
   task->saved_responses = g_list_delete_link (task->saved_responses, l);
   g_free (response_data);
 
@@ -391,6 +414,24 @@ gst_mfx_task_set_num_surfaces(GstMfxTask *task, mfxU16 num_surf)
     task->num_surfaces = num_surf;
 }
 
+void
+gst_mfx_task_set_system_memory_params (GstMfxTask * task,
+    const GstMfxSystemMemoryParams * params)
+{
+  g_return_if_fail (task != NULL);
+  g_return_if_fail (params != NULL);
+
+  task->sysmem_params = *params;
+}
+
+const GstMfxSystemMemoryParams *
+gst_mfx_task_get_system_memory_params (GstMfxTask * task)
+{
+  g_return_val_if_fail (task != NULL, NULL);
+
+  return &task->sysmem_params;
+}
+
 mfxFrameAllocRequest *
 gst_mfx_task_get_request (GstMfxTask * task)
 {
@@ -529,7 +570,9 @@ gst_mfx_task_init (GstMfxTask * task, GstMfxTaskAggregator * aggregator,
   task->soft_reinit = FALSE;
   task->backup_num_surfaces = 0;
   task->backup_surfaces = NULL;
+  task->backup_arena_size = 0;
   task->num_surfaces = 0;
+  task->sysmem_params.numa_node = -1;
 }
 
 GstMfxTask *
@@ -24,6 +24,7 @@
 #include "sysdeps.h"
 #include "gstmfxminiobject.h"
 #include "gstmfxdisplay.h"
+#include "gstmfxtypes.h"
 
 #include <mfxvideo.h>
 #include <va/va.h>
@@ -115,6 +116,13 @@ gst_mfx_task_get_num_surfaces (GstMfxTask * task);
 void
 gst_mfx_task_set_num_surfaces (GstMfxTask *task, mfxU16 num_surf);
 
+void
+gst_mfx_task_set_system_memory_params (GstMfxTask * task,
+    const GstMfxSystemMemoryParams * params);
+
+const GstMfxSystemMemoryParams *
+gst_mfx_task_get_system_memory_params (GstMfxTask * task);
+
 mfxSession
 gst_mfx_task_get_session (GstMfxTask * task);
 
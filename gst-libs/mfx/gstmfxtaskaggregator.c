@@ -19,6 +19,7 @@
  */
 
 #include "gstmfxtaskaggregator.h"
+#include "gstmfxsurfacearena.h"
 
 #define DEBUG 1
 #include "gstmfxdebug.h"
@@ -44,6 +45,7 @@ gst_mfx_task_aggregator_finalize (GstMfxTaskAggregator * aggregator)
 {
   MFXClose (aggregator->parent_session);
   g_list_free(aggregator->cache);
+  gst_mfx_surface_arena_remove_owner (aggregator->display);
   gst_mfx_display_unref (aggregator->display);
 }
 
@@ -187,6 +189,36 @@ gst_mfx_task_aggregator_create_session (GstMfxTaskAggregator * aggregator,
   return session;
 }
 
+/**
+ * gst_mfx_task_aggregator_has_session:
+ * @aggregator: a #GstMfxTaskAggregator
+ * @session: an MFX session
+ *
+ * Checks whether @session was created through @aggregator, in which case
+ * it is joined to the sessions of the other tasks of @aggregator and the
+ * SDK orders the operations they run on shared surfaces.
+ *
+ * Return value: %TRUE if @session belongs to @aggregator
+ */
+gboolean
+gst_mfx_task_aggregator_has_session (GstMfxTaskAggregator * aggregator,
+    mfxSession session)
+{
+  GList *l;
+
+  g_return_val_if_fail (aggregator != NULL, FALSE);
+
+  if (!session)
+    return FALSE;
+  if (session == aggregator->parent_session)
+    return TRUE;
+
+  for (l = aggregator->cache; l; l = l->next)
+    if (gst_mfx_task_get_session (l->data) == session)
+      return TRUE;
+  return FALSE;
+}
+
 GstMfxTask *
 gst_mfx_task_aggregator_get_current_task (GstMfxTaskAggregator * aggregator)
 {
@@ -280,3 +312,20 @@ gst_mfx_task_aggregator_update_peer_memtypes (GstMfxTaskAggregator * aggregator,
     memtype_is_system = !!(params->IOPattern & MFX_IOPATTERN_IN_SYSTEM_MEMORY);
   } while (memtype_is_system);
 }
+
+/**
+ * gst_mfx_task_aggregator_set_memory_quota:
+ * @aggregator: a #GstMfxTaskAggregator
+ * @quota: the maximum size in bytes, or 0 for unlimited
+ *
+ * Limits the amount of surface memory that can be allocated by all the
+ * tasks and surface pools of the pipeline sharing @aggregator.
+ */
+void
+gst_mfx_task_aggregator_set_memory_quota (GstMfxTaskAggregator * aggregator,
+    guint64 quota)
+{
+  g_return_if_fail (aggregator != NULL);
+
+  gst_mfx_surface_arena_set_quota (aggregator->display, quota);
+}
@@ -74,10 +74,18 @@ void
 gst_mfx_task_aggregator_remove_task (GstMfxTaskAggregator * aggregator,
     GstMfxTask * task);
 
+gboolean
+gst_mfx_task_aggregator_has_session (GstMfxTaskAggregator * aggregator,
+    mfxSession session);
+
 void
 gst_mfx_task_aggregator_update_peer_memtypes (GstMfxTaskAggregator * aggregator,
     gboolean memtype_is_system);
 
+void
+gst_mfx_task_aggregator_set_memory_quota (GstMfxTaskAggregator * aggregator,
+    guint64 quota);
+
 
 G_END_DECLS
 
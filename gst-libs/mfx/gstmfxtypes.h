@@ -98,6 +98,23 @@ struct _GstMfxMemoryId {
     mfxFrameInfo           *info;
 };
 
+/**
+ * GstMfxSystemMemoryParams:
+ * @alignment: alignment in bytes of the surface data, from 16 up to 4096.
+ *   0 selects the default alignment of 64 bytes.
+ * @use_hugepages: back the surfaces with huge pages, using MAP_HUGETLB if
+ *   huge pages are reserved or transparent huge pages otherwise.
+ * @numa_node: the NUMA node to bind the surfaces to, or -1 for none.
+ *
+ * Allocation parameters of MFX surfaces in system memory.
+ */
+typedef struct _GstMfxSystemMemoryParams GstMfxSystemMemoryParams;
+struct _GstMfxSystemMemoryParams {
+  guint alignment;
+  gboolean use_hugepages;
+  gint numa_node;
+};
+
 typedef enum {
   GST_MFX_OPTION_AUTO = -1,
   GST_MFX_OPTION_OFF,
@@ -47,6 +47,26 @@ G_BEGIN_DECLS
 #define GST_MFX_TYPE_FRC_ALGORITHM \
     gst_mfx_frc_algorithm_get_type ()
 
+/**
+ * GST_MFX_TYPE_SCALING_MODE:
+ *
+ * A type that represents the MFX VPP scaling mode.
+ *
+ * Return value: the #GType of GstMfxScalingMode
+ */
+#define GST_MFX_TYPE_SCALING_MODE \
+    gst_mfx_scaling_mode_get_type ()
+
+/**
+ * GST_MFX_TYPE_INTERPOLATION_METHOD:
+ *
+ * A type that represents the MFX VPP scaling interpolation method.
+ *
+ * Return value: the #GType of GstMfxInterpolationMethod
+ */
+#define GST_MFX_TYPE_INTERPOLATION_METHOD \
+    gst_mfx_interpolation_method_get_type ()
+
 GType
 gst_mfx_option_get_type (void);
 
@@ -61,6 +81,12 @@ gst_mfx_deinterlace_mode_get_type (void);
 
 GType
 gst_mfx_frc_algorithm_get_type (void);
+
+GType
+gst_mfx_scaling_mode_get_type (void);
+
+GType
+gst_mfx_interpolation_method_get_type (void);
 /**
  * GST_MFX_POPCOUNT32:
  * @x: the value from which to compute population count
@@ -25,6 +25,8 @@
 #endif
 #ifdef MFX_VPP
 # include "gstmfxpostproc.h"
+# include "gstmfxvppmulti.h"
+# include "gstmfxcompositor.h"
 #endif
 #ifdef MFX_SINK
 # include "gstmfxsink.h"
@@ -61,6 +63,10 @@ plugin_init (GstPlugin * plugin)
 #ifdef MFX_VPP
   ret |= gst_element_register (plugin, "mfxvpp",
       GST_RANK_NONE, GST_TYPE_MFXPOSTPROC);
+  ret |= gst_element_register (plugin, "mfxvppmulti",
+      GST_RANK_NONE, GST_TYPE_MFXVPPMULTI);
+  ret |= gst_element_register (plugin, "mfxcompositor",
+      GST_RANK_NONE, GST_TYPE_MFXCOMPOSITOR);
 #endif
 
 #ifdef MFX_SINK
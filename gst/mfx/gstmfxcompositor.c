@@ -0,0 +1,1213 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:element-mfxcompositor
+ *
+ * mfxcompositor blends any number of MFX surface streams into one output
+ * in a single VPP composition pass, e.g. for a multi-camera video wall.
+ * Each request sink pad has xpos, ypos, width, height, alpha and zorder
+ * properties, which can be changed while playing without resetting the
+ * VPP where the runtime allows it.
+ *
+ * |[
+ * gst-launch-1.0 mfxcompositor name=comp width=1920 height=1080
+ *     sink_0::xpos=0 sink_0::width=960 sink_0::height=540
+ *     sink_1::xpos=960 sink_1::width=960 sink_1::height=540 ! mfxsink
+ *     filesrc location=cam0.mp4 ! qtdemux ! h264parse ! mfxdecode ! comp.
+ *     filesrc location=cam1.mp4 ! qtdemux ! h264parse ! mfxdecode ! comp.
+ * ]|
+ */
+
+#include "gst-libs/mfx/sysdeps.h"
+#include <gst/video/video.h>
+
+#include "gstmfxcompositor.h"
+#include "gstmfxpluginutil.h"
+#include "gstmfxvideobufferpool.h"
+#include "gstmfxvideomemory.h"
+
+#define GST_PLUGIN_NAME "mfxcompositor"
+#define GST_PLUGIN_DESC "A video compositor based on VPP composition"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_mfxcompositor);
+#define GST_CAT_DEFAULT gst_debug_mfxcompositor
+
+/* Default templates */
+static const char gst_mfxcompositor_sink_caps_str[] =
+    GST_MFX_MAKE_SURFACE_CAPS;
+
+static const char gst_mfxcompositor_src_caps_str[] =
+    GST_MFX_MAKE_SURFACE_CAPS "; "
+    GST_VIDEO_CAPS_MAKE ("{ NV12, BGRA }");
+
+static GstStaticPadTemplate gst_mfxcompositor_sink_factory =
+GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (gst_mfxcompositor_sink_caps_str));
+
+static GstStaticPadTemplate gst_mfxcompositor_src_factory =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (gst_mfxcompositor_src_caps_str));
+
+G_DEFINE_TYPE (GstMfxCompositorPad, gst_mfxcompositor_pad, GST_TYPE_PAD);
+
+G_DEFINE_TYPE_WITH_CODE (GstMfxCompositor,
+    gst_mfxcompositor,
+    GST_TYPE_ELEMENT,
+    GST_MFX_PLUGIN_BASE_INIT_INTERFACES);
+
+enum
+{
+  PROP_PAD_0,
+
+  PROP_PAD_XPOS,
+  PROP_PAD_YPOS,
+  PROP_PAD_WIDTH,
+  PROP_PAD_HEIGHT,
+  PROP_PAD_ALPHA,
+  PROP_PAD_ZORDER,
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_FORMAT,
+};
+
+#define DEFAULT_PAD_XPOS                0
+#define DEFAULT_PAD_YPOS                0
+#define DEFAULT_PAD_ALPHA               1.0
+#define DEFAULT_FORMAT                  GST_VIDEO_FORMAT_UNKNOWN
+#define DEFAULT_FRAME_DURATION          (GST_SECOND / 30)
+
+typedef struct
+{
+  GstMfxCompositorPad *pad;
+  GstBuffer *buffer;
+  GstMfxSurface *surface;
+  guint zorder;
+} GstMfxCompositorInput;
+
+/* ------------------------------------------------------------------------ */
+/* --- Input pads                                                       --- */
+/* ------------------------------------------------------------------------ */
+
+/* Lets an output sized after the inputs follow their placement */
+static void
+gst_mfxcompositor_pad_layout_changed (GstMfxCompositorPad * pad)
+{
+  GstObject *const parent = gst_object_get_parent (GST_OBJECT (pad));
+
+  if (!parent)
+    return;
+
+  GST_OBJECT_LOCK (parent);
+  GST_MFXCOMPOSITOR (parent)->layout_changed = TRUE;
+  GST_OBJECT_UNLOCK (parent);
+  gst_object_unref (parent);
+}
+
+static void
+gst_mfxcompositor_pad_clear_buffer (GstMfxCompositorPad * pad)
+{
+  GstMfxVideoMeta *meta;
+
+  if (pad->buffer) {
+    meta = gst_buffer_get_mfx_video_meta (pad->buffer);
+    if (meta)
+      gst_mfx_surface_dequeue (gst_mfx_video_meta_get_surface (meta));
+    gst_buffer_replace (&pad->buffer, NULL);
+  }
+  pad->start_time = GST_CLOCK_TIME_NONE;
+  pad->end_time = GST_CLOCK_TIME_NONE;
+}
+
+static void
+gst_mfxcompositor_pad_finalize (GObject * object)
+{
+  gst_mfxcompositor_pad_clear_buffer (GST_MFXCOMPOSITOR_PAD (object));
+  G_OBJECT_CLASS (gst_mfxcompositor_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_mfxcompositor_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMfxCompositorPad *const pad = GST_MFXCOMPOSITOR_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      pad->xpos = g_value_get_int (value);
+      break;
+    case PROP_PAD_YPOS:
+      pad->ypos = g_value_get_int (value);
+      break;
+    case PROP_PAD_WIDTH:
+      pad->width = g_value_get_uint (value);
+      break;
+    case PROP_PAD_HEIGHT:
+      pad->height = g_value_get_uint (value);
+      break;
+    case PROP_PAD_ALPHA:
+      pad->alpha = g_value_get_double (value);
+      break;
+    case PROP_PAD_ZORDER:
+      pad->zorder = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+    case PROP_PAD_YPOS:
+    case PROP_PAD_WIDTH:
+    case PROP_PAD_HEIGHT:
+      gst_mfxcompositor_pad_layout_changed (pad);
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+gst_mfxcompositor_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstMfxCompositorPad *const pad = GST_MFXCOMPOSITOR_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      g_value_set_int (value, pad->xpos);
+      break;
+    case PROP_PAD_YPOS:
+      g_value_set_int (value, pad->ypos);
+      break;
+    case PROP_PAD_WIDTH:
+      g_value_set_uint (value, pad->width);
+      break;
+    case PROP_PAD_HEIGHT:
+      g_value_set_uint (value, pad->height);
+      break;
+    case PROP_PAD_ALPHA:
+      g_value_set_double (value, pad->alpha);
+      break;
+    case PROP_PAD_ZORDER:
+      g_value_set_uint (value, pad->zorder);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_mfxcompositor_pad_class_init (GstMfxCompositorPadClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gst_mfxcompositor_pad_finalize;
+  object_class->set_property = gst_mfxcompositor_pad_set_property;
+  object_class->get_property = gst_mfxcompositor_pad_get_property;
+
+  g_object_class_install_property (object_class,
+      PROP_PAD_XPOS,
+      g_param_spec_int ("xpos",
+          "X Position",
+          "X position of the picture in the output",
+          G_MININT, G_MAXINT, DEFAULT_PAD_XPOS, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_PAD_YPOS,
+      g_param_spec_int ("ypos",
+          "Y Position",
+          "Y position of the picture in the output",
+          G_MININT, G_MAXINT, DEFAULT_PAD_YPOS, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxCompositorPad:width
+   *
+   * The width of the picture in the output, or the input width if zero.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_WIDTH,
+      g_param_spec_uint ("width",
+          "Width",
+          "Width of the picture in the output",
+          0, 8192, 0, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxCompositorPad:height
+   *
+   * The height of the picture in the output, or the input height if zero.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_HEIGHT,
+      g_param_spec_uint ("height",
+          "Height",
+          "Height of the picture in the output",
+          0, 8192, 0, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_PAD_ALPHA,
+      g_param_spec_double ("alpha",
+          "Alpha",
+          "Opacity of the picture",
+          0.0, 1.0, DEFAULT_PAD_ALPHA, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxCompositorPad:zorder
+   *
+   * The stacking order of the picture, higher values being drawn above
+   * lower ones. Defaults to the order in which the pads were requested.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_ZORDER,
+      g_param_spec_uint ("zorder",
+          "Z-Order",
+          "Stacking order of the picture",
+          0, G_MAXUINT, 0, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_mfxcompositor_pad_init (GstMfxCompositorPad * pad)
+{
+  pad->xpos = DEFAULT_PAD_XPOS;
+  pad->ypos = DEFAULT_PAD_YPOS;
+  pad->alpha = DEFAULT_PAD_ALPHA;
+  pad->start_time = GST_CLOCK_TIME_NONE;
+  pad->end_time = GST_CLOCK_TIME_NONE;
+  gst_video_info_init (&pad->info);
+}
+
+/* Returns the destination rectangle of @pad, unclipped */
+static void
+get_pad_rect (GstMfxCompositorPad * pad, gint * x, gint * y,
+    guint * width, guint * height, gdouble * alpha)
+{
+  GST_OBJECT_LOCK (pad);
+  *x = pad->xpos;
+  *y = pad->ypos;
+  *width = pad->width ? pad->width : GST_VIDEO_INFO_WIDTH (&pad->info);
+  *height = pad->height ? pad->height : GST_VIDEO_INFO_HEIGHT (&pad->info);
+  if (alpha)
+    *alpha = pad->alpha;
+  GST_OBJECT_UNLOCK (pad);
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Negotiation                                                      --- */
+/* ------------------------------------------------------------------------ */
+
+static void
+find_output_size (GstMfxCompositor * vpp, GList * inputs,
+    guint * width_ptr, guint * height_ptr)
+{
+  GstMfxCompositorInput *input;
+  guint width, height, w, h;
+  gint x, y;
+  GList *l;
+
+  GST_OBJECT_LOCK (vpp);
+  width = vpp->width;
+  height = vpp->height;
+  GST_OBJECT_UNLOCK (vpp);
+
+  /* Bounding box of the inputs */
+  if (!width || !height) {
+    guint box_width = 0, box_height = 0;
+
+    for (l = inputs; l; l = l->next) {
+      input = l->data;
+      get_pad_rect (input->pad, &x, &y, &w, &h, NULL);
+      box_width = MAX (box_width, MAX (x, 0) + w);
+      box_height = MAX (box_height, MAX (y, 0) + h);
+    }
+    if (!width)
+      width = box_width;
+    if (!height)
+      height = box_height;
+  }
+
+  *width_ptr = GST_ROUND_UP_2 (width);
+  *height_ptr = GST_ROUND_UP_2 (height);
+}
+
+static gboolean
+gst_mfxcompositor_decide_allocation (GstMfxCompositor * vpp, GstCaps * caps,
+    gboolean memtype_is_system)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstQuery *query;
+  guint min = 0, max = 0;
+  gboolean has_video_meta;
+
+  query = gst_query_new_allocation (caps, TRUE);
+  if (!gst_pad_peer_query (plugin->srcpad, query))
+    GST_DEBUG_OBJECT (vpp, "peer ALLOCATION query failed");
+
+  has_video_meta = gst_query_find_allocation_meta (query,
+      GST_VIDEO_META_API_TYPE, NULL);
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, NULL, &min, &max);
+  gst_query_unref (query);
+
+  pool = gst_mfx_video_buffer_pool_new (plugin->aggregator,
+      memtype_is_system);
+  if (!pool)
+    goto error_create_pool;
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      GST_VIDEO_INFO_SIZE (&vpp->srcpad_info), min, max);
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_MFX_VIDEO_META);
+  if (has_video_meta)
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (!gst_buffer_pool_set_config (pool, config))
+    goto error_pool_config;
+
+  if (!gst_buffer_pool_set_active (pool, TRUE))
+    goto error_pool_config;
+
+  vpp->pool = pool;
+  return TRUE;
+  /* ERRORS */
+error_create_pool:
+  {
+    GST_ERROR_OBJECT (vpp, "failed to create buffer pool");
+    return FALSE;
+  }
+error_pool_config:
+  {
+    GST_ERROR_OBJECT (vpp, "failed to configure buffer pool");
+    gst_object_unref (pool);
+    return FALSE;
+  }
+}
+
+static void
+gst_mfxcompositor_reset (GstMfxCompositor * vpp)
+{
+  gst_mfx_composite_filter_replace (&vpp->filter, NULL);
+  if (vpp->pool) {
+    gst_buffer_pool_set_active (vpp->pool, FALSE);
+    g_clear_object (&vpp->pool);
+  }
+  gst_video_info_init (&vpp->srcpad_info);
+  vpp->num_streams = 0;
+}
+
+static void
+gst_mfxcompositor_clear_inputs (GstMfxCompositor * vpp)
+{
+  GList *l;
+
+  GST_OBJECT_LOCK (vpp);
+  for (l = GST_ELEMENT (vpp)->sinkpads; l; l = l->next)
+    gst_mfxcompositor_pad_clear_buffer (GST_MFXCOMPOSITOR_PAD (l->data));
+  vpp->next_ts = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static gboolean
+gst_mfxcompositor_negotiate (GstMfxCompositor * vpp, GList * inputs)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstMfxCompositorInput *const first = inputs->data;
+  GstVideoFormat out_format = GST_VIDEO_FORMAT_NV12;
+  GstMfxCapsFeature feature;
+  const gchar *feature_str;
+  GstVideoInfo in_info;
+  GstCaps *caps;
+  gboolean memtype_is_system;
+  guint width, height;
+  GList *l;
+
+  gst_mfxcompositor_reset (vpp);
+
+  feature = gst_mfx_find_preferred_caps_feature (plugin->srcpad,
+      &out_format, TRUE);
+  if (GST_MFX_CAPS_FEATURE_NOT_NEGOTIATED == feature)
+    return FALSE;
+
+  GST_OBJECT_LOCK (vpp);
+  if (vpp->format != GST_VIDEO_FORMAT_UNKNOWN)
+    out_format = vpp->format;
+  GST_OBJECT_UNLOCK (vpp);
+
+  if (out_format != GST_VIDEO_FORMAT_NV12
+      && out_format != GST_VIDEO_FORMAT_BGRA)
+    out_format = GST_VIDEO_FORMAT_NV12;
+
+  /* The VPP input is described by the largest input */
+  in_info = first->pad->info;
+  for (l = inputs->next; l; l = l->next) {
+    GstMfxCompositorInput *const input = l->data;
+
+    if (GST_VIDEO_INFO_WIDTH (&input->pad->info) *
+        GST_VIDEO_INFO_HEIGHT (&input->pad->info) >
+        GST_VIDEO_INFO_WIDTH (&in_info) * GST_VIDEO_INFO_HEIGHT (&in_info))
+      in_info = input->pad->info;
+  }
+
+  find_output_size (vpp, inputs, &width, &height);
+  if (!width || !height)
+    return FALSE;
+
+  vpp->srcpad_info = first->pad->info;
+  gst_video_info_change_format (&vpp->srcpad_info, out_format, width, height);
+
+  caps = gst_video_info_to_caps (&vpp->srcpad_info);
+  if (!caps)
+    return FALSE;
+  feature_str = gst_mfx_caps_feature_to_string (feature);
+  if (feature_str)
+    gst_caps_set_features (caps, 0, gst_caps_features_new (feature_str, NULL));
+
+  GST_INFO_OBJECT (vpp, "new src caps = %" GST_PTR_FORMAT, caps);
+
+  /* Composition runs within a single memory type, so the output follows
+   * the memory of the inputs */
+  memtype_is_system = !gst_mfx_surface_has_video_memory (first->surface);
+
+  vpp->filter = gst_mfx_composite_filter_new (plugin->aggregator,
+      memtype_is_system);
+  if (!vpp->filter)
+    goto error_create_filter;
+
+  vpp->num_streams = g_list_length (inputs);
+  gst_mfx_composite_filter_set_output_info (vpp->filter, &vpp->srcpad_info);
+  if (!gst_mfx_composite_filter_prepare (vpp->filter, &in_info,
+          vpp->num_streams))
+    goto error_create_filter;
+
+  if (vpp->send_stream_start) {
+    gchar s_id[32];
+
+    g_snprintf (s_id, sizeof (s_id), "mfxcompositor-%08x",
+        g_random_int ());
+    gst_pad_push_event (plugin->srcpad, gst_event_new_stream_start (s_id));
+    vpp->send_stream_start = FALSE;
+  }
+
+  if (!gst_pad_push_event (plugin->srcpad, gst_event_new_caps (caps)))
+    goto error_push_caps;
+
+  if (vpp->send_segment) {
+    GstSegment segment;
+
+    gst_segment_init (&segment, GST_FORMAT_TIME);
+    gst_pad_push_event (plugin->srcpad, gst_event_new_segment (&segment));
+    vpp->send_segment = FALSE;
+  }
+
+  if (!gst_mfxcompositor_decide_allocation (vpp, caps, memtype_is_system))
+    goto error_allocation;
+
+  gst_caps_unref (caps);
+  return TRUE;
+  /* ERRORS */
+error_create_filter:
+  {
+    GST_ERROR_OBJECT (vpp, "failed to create composite filter");
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+error_push_caps:
+  {
+    GST_WARNING_OBJECT (vpp, "failed to push caps %" GST_PTR_FORMAT, caps);
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+error_allocation:
+  {
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Data flow                                                        --- */
+/* ------------------------------------------------------------------------ */
+
+static gint
+compare_zorder (gconstpointer a, gconstpointer b)
+{
+  const GstMfxCompositorInput *const input_a = a;
+  const GstMfxCompositorInput *const input_b = b;
+
+  return input_a->zorder < input_b->zorder ? -1 :
+      (input_a->zorder > input_b->zorder ? 1 : 0);
+}
+
+static void
+free_input (GstMfxCompositorInput * input)
+{
+  gst_buffer_unref (input->buffer);
+  g_slice_free (GstMfxCompositorInput, input);
+}
+
+/* Adds the visible part of @input to @composition. An input placed out of
+ * the output stays in the layout, clamped within it and fully transparent,
+ * so that hiding or showing it does not change the number of streams */
+static void
+add_input (GstMfxCompositor * vpp, GstMfxSurfaceComposition * composition,
+    GstMfxCompositorInput * input)
+{
+  const gint out_width = GST_VIDEO_INFO_WIDTH (&vpp->srcpad_info);
+  const gint out_height = GST_VIDEO_INFO_HEIGHT (&vpp->srcpad_info);
+  GstMfxRectangle rect;
+  guint width, height;
+  gdouble alpha;
+  gint x, y, x2, y2;
+
+  get_pad_rect (input->pad, &x, &y, &width, &height, &alpha);
+
+  x2 = MIN (x + (gint) width, out_width);
+  y2 = MIN (y + (gint) height, out_height);
+  if (x2 <= MAX (x, 0) || y2 <= MAX (y, 0)) {
+    width = MIN ((gint) width, out_width);
+    height = MIN ((gint) height, out_height);
+    x = CLAMP (x, 0, out_width - (gint) width);
+    y = CLAMP (y, 0, out_height - (gint) height);
+    x2 = x + (gint) width;
+    y2 = y + (gint) height;
+    alpha = 0.0;
+  }
+  x = MAX (x, 0);
+  y = MAX (y, 0);
+
+  rect.x = x;
+  rect.y = y;
+  rect.width = x2 - x;
+  rect.height = y2 - y;
+  gst_mfx_surface_composition_add_surface (composition, input->surface,
+      &rect, alpha);
+}
+
+/* Returns the running time of @buf in the segment of @data */
+static GstClockTime
+get_running_time (GstCollectData * data, GstBuffer * buf)
+{
+  if (!GST_BUFFER_PTS_IS_VALID (buf))
+    return GST_CLOCK_TIME_NONE;
+  return gst_segment_to_running_time (&data->segment, GST_FORMAT_TIME,
+      GST_BUFFER_PTS (buf));
+}
+
+/* Returns the earliest running time of the buffers queued on the inputs */
+static GstClockTime
+get_earliest_time (GstCollectPads * pads)
+{
+  GstClockTime earliest = GST_CLOCK_TIME_NONE, running_time;
+  GstBuffer *buf;
+  GSList *l;
+
+  for (l = pads->data; l; l = l->next) {
+    GstCollectData *const data = l->data;
+
+    buf = gst_collect_pads_peek (pads, data);
+    if (!buf)
+      continue;
+    running_time = get_running_time (data, buf);
+    gst_buffer_unref (buf);
+
+    if (GST_CLOCK_TIME_IS_VALID (running_time)
+        && (!GST_CLOCK_TIME_IS_VALID (earliest) || running_time < earliest))
+      earliest = running_time;
+  }
+  return earliest;
+}
+
+/* The output runs at the frame rate of the first input that has one */
+static GstClockTime
+get_output_duration (GstMfxCompositor * vpp, GstCollectPads * pads)
+{
+  const GstVideoInfo *info = &vpp->srcpad_info;
+  GSList *l;
+
+  for (l = pads->data; l && GST_VIDEO_INFO_FPS_N (info) <= 0; l = l->next)
+    info = &GST_MFXCOMPOSITOR_PAD (((GstCollectData *) l->data)->pad)->info;
+
+  if (GST_VIDEO_INFO_FPS_N (info) <= 0 || GST_VIDEO_INFO_FPS_D (info) <= 0)
+    return DEFAULT_FRAME_DURATION;
+  return gst_util_uint64_scale_int (GST_SECOND, GST_VIDEO_INFO_FPS_D (info),
+      GST_VIDEO_INFO_FPS_N (info));
+}
+
+/* Picks the buffer each input shows in the output frame starting at
+ * @out_start, in running time. A buffer is taken once it starts before the
+ * end of the frame, and an input keeps showing its previous buffer until
+ * then. Returns FALSE when an input took a buffer that ended before the
+ * frame, so that its next buffer is waited for instead */
+static gboolean
+select_buffers (GstCollectPads * pads, GstClockTime out_start,
+    GstClockTime out_end, gboolean * eos)
+{
+  gboolean ready = TRUE;
+  GSList *l;
+
+  *eos = TRUE;
+  for (l = pads->data; l; l = l->next) {
+    GstCollectData *const data = l->data;
+    GstMfxCompositorPad *const pad = GST_MFXCOMPOSITOR_PAD (data->pad);
+    GstMfxVideoMeta *meta;
+    GstClockTime start;
+    GstBuffer *buf;
+
+    buf = gst_collect_pads_peek (pads, data);
+    if (!buf) {
+      /* At end of stream, the last buffer is shown for its duration */
+      if (!GST_CLOCK_TIME_IS_VALID (out_start)
+          || !GST_CLOCK_TIME_IS_VALID (pad->end_time)
+          || pad->end_time <= out_start)
+        gst_mfxcompositor_pad_clear_buffer (pad);
+      continue;
+    }
+    *eos = FALSE;
+
+    start = get_running_time (data, buf);
+    gst_buffer_unref (buf);
+    if (GST_CLOCK_TIME_IS_VALID (start) && GST_CLOCK_TIME_IS_VALID (out_end)
+        && start >= out_end)
+      continue;
+
+    buf = gst_collect_pads_pop (pads, data);
+    meta = gst_buffer_get_mfx_video_meta (buf);
+    if (!meta || !gst_mfx_video_meta_get_surface (meta)) {
+      GST_WARNING_OBJECT (pad, "dropping buffer without surface");
+      gst_buffer_unref (buf);
+      ready = FALSE;
+      continue;
+    }
+
+    gst_mfxcompositor_pad_clear_buffer (pad);
+    pad->buffer = buf;
+    pad->start_time = start;
+    if (GST_CLOCK_TIME_IS_VALID (start) && GST_BUFFER_DURATION_IS_VALID (buf))
+      pad->end_time = start + GST_BUFFER_DURATION (buf);
+
+    if (GST_CLOCK_TIME_IS_VALID (out_start)
+        && GST_CLOCK_TIME_IS_VALID (pad->end_time)
+        && pad->end_time <= out_start)
+      ready = FALSE;
+  }
+  return ready;
+}
+
+static GstFlowReturn
+gst_mfxcompositor_collected (GstCollectPads * pads, gpointer user_data)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (user_data);
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstMfxCompositorInput *input;
+  GstMfxSurfaceComposition *composition = NULL;
+  GstMfxSurface *out_surface = NULL;
+  GstMfxVideoMeta *meta;
+  GstClockTime out_start, out_end = GST_CLOCK_TIME_NONE, duration;
+  GstBuffer *outbuf = NULL;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean need_configure, layout_changed, eos;
+  guint width, height;
+  GList *inputs = NULL, *l;
+  GSList *sl;
+
+  /* Output frames are timestamped in running time, starting from the
+   * earliest input */
+  if (!GST_CLOCK_TIME_IS_VALID (vpp->next_ts))
+    vpp->next_ts = get_earliest_time (pads);
+  out_start = vpp->next_ts;
+  duration = get_output_duration (vpp, pads);
+  if (GST_CLOCK_TIME_IS_VALID (out_start))
+    out_end = out_start + duration;
+
+  if (!select_buffers (pads, out_start, out_end, &eos))
+    return GST_FLOW_OK;
+
+  for (sl = pads->data; sl; sl = sl->next) {
+    GstMfxCompositorPad *const pad =
+        GST_MFXCOMPOSITOR_PAD (((GstCollectData *) sl->data)->pad);
+
+    if (!pad->buffer)
+      continue;
+
+    input = g_slice_new0 (GstMfxCompositorInput);
+    input->pad = pad;
+    input->buffer = gst_buffer_ref (pad->buffer);
+    input->surface = gst_mfx_video_meta_get_surface (
+        gst_buffer_get_mfx_video_meta (pad->buffer));
+    GST_OBJECT_LOCK (pad);
+    input->zorder = pad->zorder;
+    GST_OBJECT_UNLOCK (pad);
+    inputs = g_list_insert_sorted (inputs, input, compare_zorder);
+  }
+
+  if (!inputs) {
+    if (eos) {
+      gst_pad_push_event (plugin->srcpad, gst_event_new_eos ());
+      return GST_FLOW_EOS;
+    }
+    /* Nothing to show until the next queued buffer */
+    vpp->next_ts = get_earliest_time (pads);
+    return GST_FLOW_OK;
+  }
+
+  GST_OBJECT_LOCK (vpp);
+  need_configure = vpp->need_configure || !vpp->filter;
+  layout_changed = vpp->layout_changed;
+  vpp->need_configure = FALSE;
+  vpp->layout_changed = FALSE;
+  GST_OBJECT_UNLOCK (vpp);
+
+  /* An output sized after the inputs follows their placement */
+  if (!need_configure && layout_changed) {
+    find_output_size (vpp, inputs, &width, &height);
+    need_configure = width != GST_VIDEO_INFO_WIDTH (&vpp->srcpad_info)
+        || height != GST_VIDEO_INFO_HEIGHT (&vpp->srcpad_info);
+  }
+
+  if (need_configure && !gst_mfxcompositor_negotiate (vpp, inputs)) {
+    ret = GST_FLOW_NOT_NEGOTIATED;
+    goto done;
+  }
+
+  composition = gst_mfx_surface_composition_new_empty ();
+  if (!composition) {
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+  for (l = inputs; l; l = l->next)
+    add_input (vpp, composition, l->data);
+
+  if (!gst_mfx_composite_filter_apply_composition (vpp->filter, composition,
+          &out_surface))
+    goto error_composite;
+
+  ret = gst_buffer_pool_acquire_buffer (vpp->pool, &outbuf, NULL);
+  if (GST_FLOW_OK != ret)
+    goto done;
+
+  meta = gst_buffer_get_mfx_video_meta (outbuf);
+  if (!meta)
+    goto error_create_meta;
+  gst_mfx_video_meta_set_surface (meta, out_surface);
+
+  GST_BUFFER_PTS (outbuf) = out_start;
+  if (GST_CLOCK_TIME_IS_VALID (out_start)) {
+    GST_BUFFER_DURATION (outbuf) = duration;
+    vpp->next_ts = out_end;
+  }
+
+  ret = gst_pad_push (plugin->srcpad, outbuf);
+
+done:
+  gst_mfx_surface_replace (&out_surface, NULL);
+  gst_mfx_surface_composition_replace (&composition, NULL);
+  g_list_free_full (inputs, (GDestroyNotify) free_input);
+  return ret;
+  /* ERRORS */
+error_composite:
+  {
+    GST_ELEMENT_ERROR (vpp, STREAM, FAILED,
+        ("Failed to compose the inputs."), (NULL));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+error_create_meta:
+  {
+    GST_ERROR_OBJECT (vpp, "failed to create new output buffer meta");
+    gst_buffer_unref (outbuf);
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+}
+
+static gboolean
+gst_mfxcompositor_sink_event (GstCollectPads * pads, GstCollectData * data,
+    GstEvent * event, gpointer user_data)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (user_data);
+  GstMfxCompositorPad *const pad = GST_MFXCOMPOSITOR_PAD (data->pad);
+  gboolean discard = FALSE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      GST_INFO_OBJECT (pad, "new sink caps = %" GST_PTR_FORMAT, caps);
+      if (!gst_video_info_from_caps (&pad->info, caps)
+          || !gst_mfx_plugin_base_ensure_aggregator (GST_MFX_PLUGIN_BASE (vpp))) {
+        gst_event_unref (event);
+        return FALSE;
+      }
+
+      GST_OBJECT_LOCK (vpp);
+      vpp->need_configure = TRUE;
+      GST_OBJECT_UNLOCK (vpp);
+      discard = TRUE;
+      break;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      GST_COLLECT_PADS_STREAM_LOCK (pads);
+      gst_mfxcompositor_pad_clear_buffer (pad);
+      vpp->next_ts = GST_CLOCK_TIME_NONE;
+      GST_COLLECT_PADS_STREAM_UNLOCK (pads);
+      break;
+    /* The output is a single stream of its own */
+    case GST_EVENT_STREAM_START:
+    case GST_EVENT_SEGMENT:
+      discard = TRUE;
+      break;
+    default:
+      break;
+  }
+  return gst_collect_pads_event_default (pads, data, event, discard);
+}
+
+static gboolean
+gst_mfxcompositor_sink_query (GstCollectPads * pads, GstCollectData * data,
+    GstQuery * query, gpointer user_data)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (user_data);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_mfx_handle_context_query (query, plugin->aggregator))
+        return TRUE;
+      break;
+    case GST_QUERY_ALLOCATION:
+      /* Inputs are MFX surfaces allocated upstream */
+      gst_query_add_allocation_meta (query, GST_MFX_VIDEO_META_API_TYPE,
+          NULL);
+      gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+      return TRUE;
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_pad_template_caps (data->pad);
+      if (filter) {
+        GstCaps *const out_caps =
+            gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = out_caps;
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    default:
+      break;
+  }
+  return gst_collect_pads_query_default (pads, data, query, FALSE);
+}
+
+static gboolean
+gst_mfxcompositor_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_mfx_handle_context_query (query, plugin->aggregator))
+        return TRUE;
+      break;
+    default:
+      break;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Element                                                          --- */
+/* ------------------------------------------------------------------------ */
+
+static GstPad *
+gst_mfxcompositor_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (element);
+  GstMfxCompositorPad *pad;
+  gchar *pad_name;
+  guint id;
+
+  GST_OBJECT_LOCK (vpp);
+  if (name && sscanf (name, "sink_%u", &id) == 1) {
+    vpp->next_pad_id = MAX (vpp->next_pad_id, id + 1);
+    pad_name = g_strdup (name);
+  } else {
+    id = vpp->next_pad_id++;
+    pad_name = g_strdup_printf ("sink_%u", id);
+  }
+  GST_OBJECT_UNLOCK (vpp);
+
+  pad = g_object_new (GST_TYPE_MFXCOMPOSITOR_PAD, "name", pad_name,
+      "direction", templ->direction, "template", templ, NULL);
+  g_free (pad_name);
+  pad->zorder = id;
+
+  gst_collect_pads_add_pad (vpp->collect, GST_PAD (pad),
+      sizeof (GstCollectData), NULL, TRUE);
+
+  if (!gst_element_add_pad (element, GST_PAD (pad))) {
+    gst_collect_pads_remove_pad (vpp->collect, GST_PAD (pad));
+    return NULL;
+  }
+
+  GST_OBJECT_LOCK (vpp);
+  vpp->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (vpp);
+
+  return GST_PAD (pad);
+}
+
+static void
+gst_mfxcompositor_release_pad (GstElement * element, GstPad * pad)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (element);
+
+  gst_collect_pads_remove_pad (vpp->collect, pad);
+  gst_mfxcompositor_pad_clear_buffer (GST_MFXCOMPOSITOR_PAD (pad));
+  gst_element_remove_pad (element, pad);
+
+  GST_OBJECT_LOCK (vpp);
+  vpp->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static GstStateChangeReturn
+gst_mfxcompositor_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      vpp->need_configure = TRUE;
+      vpp->send_stream_start = TRUE;
+      vpp->send_segment = TRUE;
+      vpp->next_ts = GST_CLOCK_TIME_NONE;
+      gst_collect_pads_start (vpp->collect);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_collect_pads_stop (vpp->collect);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_mfxcompositor_parent_class)->change_state
+      (element, transition);
+  if (GST_STATE_CHANGE_FAILURE == ret)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_mfxcompositor_clear_inputs (vpp);
+      gst_mfxcompositor_reset (vpp);
+      gst_mfx_plugin_base_close (GST_MFX_PLUGIN_BASE (vpp));
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+static void
+gst_mfxcompositor_finalize (GObject * object)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (object);
+
+  gst_mfxcompositor_reset (vpp);
+  gst_object_unref (vpp->collect);
+  gst_mfx_plugin_base_finalize (GST_MFX_PLUGIN_BASE (vpp));
+  G_OBJECT_CLASS (gst_mfxcompositor_parent_class)->finalize (object);
+}
+
+static void
+gst_mfxcompositor_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (object);
+
+  GST_OBJECT_LOCK (vpp);
+  switch (prop_id) {
+    case PROP_WIDTH:
+      vpp->width = g_value_get_uint (value);
+      break;
+    case PROP_HEIGHT:
+      vpp->height = g_value_get_uint (value);
+      break;
+    case PROP_FORMAT:
+      vpp->format = g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  vpp->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static void
+gst_mfxcompositor_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec)
+{
+  GstMfxCompositor *const vpp = GST_MFXCOMPOSITOR (object);
+
+  GST_OBJECT_LOCK (vpp);
+  switch (prop_id) {
+    case PROP_WIDTH:
+      g_value_set_uint (value, vpp->width);
+      break;
+    case PROP_HEIGHT:
+      g_value_set_uint (value, vpp->height);
+      break;
+    case PROP_FORMAT:
+      g_value_set_enum (value, vpp->format);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static void
+gst_mfxcompositor_class_init (GstMfxCompositorClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *const element_class = GST_ELEMENT_CLASS (klass);
+  GstPadTemplate *pad_template;
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_mfxcompositor,
+      GST_PLUGIN_NAME, 0, GST_PLUGIN_DESC);
+
+  gst_mfx_plugin_base_class_init (GST_MFX_PLUGIN_BASE_CLASS (klass));
+
+  object_class->finalize = gst_mfxcompositor_finalize;
+  object_class->set_property = gst_mfxcompositor_set_property;
+  object_class->get_property = gst_mfxcompositor_get_property;
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_change_state);
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_request_new_pad);
+  element_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_release_pad);
+
+  gst_element_class_set_static_metadata (element_class,
+      "MFX video compositor",
+      "Filter/Editor/Video/Compositor",
+      GST_PLUGIN_DESC, "Ishmael Sameen <ishmael.visayana.sameen@intel.com>");
+
+  /* sink pads */
+  pad_template = gst_static_pad_template_get (&gst_mfxcompositor_sink_factory);
+  gst_element_class_add_pad_template (element_class, pad_template);
+
+  /* src pad */
+  pad_template = gst_static_pad_template_get (&gst_mfxcompositor_src_factory);
+  gst_element_class_add_pad_template (element_class, pad_template);
+
+  /**
+   * GstMfxCompositor:width
+   *
+   * The output width. If set to zero, the output is as wide as the
+   * placed inputs, and is renegotiated when they are moved or resized.
+   */
+  g_object_class_install_property (object_class,
+      PROP_WIDTH,
+      g_param_spec_uint ("width",
+          "Width",
+          "Output width",
+          0, 8192, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxCompositor:height
+   *
+   * The output height. If set to zero, the output is as high as the
+   * placed inputs, and is renegotiated when they are moved or resized.
+   */
+  g_object_class_install_property (object_class,
+      PROP_HEIGHT,
+      g_param_spec_uint ("height",
+          "Height",
+          "Output height",
+          0, 8192, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_FORMAT,
+      g_param_spec_enum ("format",
+          "Format",
+          "The forced output pixel format",
+          GST_TYPE_VIDEO_FORMAT,
+          DEFAULT_FORMAT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_mfxcompositor_init (GstMfxCompositor * vpp)
+{
+  GstPad *srcpad;
+
+  srcpad = gst_pad_new_from_static_template (&gst_mfxcompositor_src_factory,
+      "src");
+  gst_pad_set_query_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_src_query));
+  gst_pad_use_fixed_caps (srcpad);
+  gst_element_add_pad (GST_ELEMENT (vpp), srcpad);
+
+  gst_mfx_plugin_base_init (GST_MFX_PLUGIN_BASE (vpp), GST_CAT_DEFAULT);
+
+  vpp->collect = gst_collect_pads_new ();
+  gst_collect_pads_set_function (vpp->collect,
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_collected), vpp);
+  gst_collect_pads_set_event_function (vpp->collect,
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_sink_event), vpp);
+  gst_collect_pads_set_query_function (vpp->collect,
+      GST_DEBUG_FUNCPTR (gst_mfxcompositor_sink_query), vpp);
+
+  vpp->format = DEFAULT_FORMAT;
+  vpp->next_ts = GST_CLOCK_TIME_NONE;
+  gst_video_info_init (&vpp->srcpad_info);
+}
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFXCOMPOSITOR_H
+#define GST_MFXCOMPOSITOR_H
+
+#include "gstmfxpluginbase.h"
+
+#include <gst/base/gstcollectpads.h>
+#include <gst-libs/mfx/gstmfxcompositefilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MFXCOMPOSITOR \
+  (gst_mfxcompositor_get_type ())
+#define GST_MFXCOMPOSITOR(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_MFXCOMPOSITOR, \
+  GstMfxCompositor))
+#define GST_MFXCOMPOSITOR_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_TYPE_MFXCOMPOSITOR, \
+  GstMfxCompositorClass))
+#define GST_IS_MFXCOMPOSITOR(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_MFXCOMPOSITOR))
+#define GST_IS_MFXCOMPOSITOR_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_MFXCOMPOSITOR))
+
+#define GST_TYPE_MFXCOMPOSITOR_PAD \
+  (gst_mfxcompositor_pad_get_type ())
+#define GST_MFXCOMPOSITOR_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_MFXCOMPOSITOR_PAD, \
+  GstMfxCompositorPad))
+#define GST_IS_MFXCOMPOSITOR_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_MFXCOMPOSITOR_PAD))
+
+typedef struct _GstMfxCompositor GstMfxCompositor;
+typedef struct _GstMfxCompositorClass GstMfxCompositorClass;
+typedef struct _GstMfxCompositorPad GstMfxCompositorPad;
+typedef struct _GstMfxCompositorPadClass GstMfxCompositorPadClass;
+
+/**
+ * GstMfxCompositorPad:
+ *
+ * An input of #GstMfxCompositor, placed in the output by its xpos, ypos,
+ * width and height properties and stacked by its zorder property. The
+ * input keeps showing its last buffer until a newer one is due.
+ */
+struct _GstMfxCompositorPad
+{
+  /*< private >*/
+  GstPad                  parent_instance;
+
+  /* Properties, protected by the object lock */
+  gint                    xpos;
+  gint                    ypos;
+  guint                   width;
+  guint                   height;
+  gdouble                 alpha;
+  guint                   zorder;
+
+  /* Streaming thread state */
+  GstVideoInfo            info;
+  GstBuffer              *buffer;
+  GstClockTime            start_time;
+  GstClockTime            end_time;
+};
+
+struct _GstMfxCompositorPadClass
+{
+  /*< private >*/
+  GstPadClass parent_class;
+};
+
+struct _GstMfxCompositor
+{
+  /*< private >*/
+  GstMfxPluginBase        parent_instance;
+
+  GstCollectPads         *collect;
+  GstMfxCompositeFilter  *filter;
+  GstBufferPool          *pool;
+  GstVideoInfo            srcpad_info;
+  guint                   num_streams;
+  guint                   next_pad_id;
+  GstClockTime            next_ts;
+  gboolean                need_configure;
+  gboolean                layout_changed;
+  gboolean                send_stream_start;
+  gboolean                send_segment;
+
+  /* Properties */
+  guint                   width;
+  guint                   height;
+  GstVideoFormat          format;
+};
+
+struct _GstMfxCompositorClass
+{
+  /*< private >*/
+  GstMfxPluginBaseClass parent_class;
+};
+
+GType
+gst_mfxcompositor_get_type (void);
+
+GType
+gst_mfxcompositor_pad_get_type (void);
+
+G_END_DECLS
+
+#endif /* GST_MFXCOMPOSITOR_H */
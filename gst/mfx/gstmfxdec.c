@@ -85,7 +85,10 @@ enum
   PROP_0,
   PROP_ASYNC_DEPTH,
   PROP_LIVE_MODE,
-  PROP_SKIP_CORRUPTED_FRAMES
+  PROP_SKIP_CORRUPTED_FRAMES,
+  PROP_MEMORY_ALIGNMENT,
+  PROP_MEMORY_HUGEPAGES,
+  PROP_MEMORY_NUMA_NODE
 };
 
 static GstStaticPadTemplate src_template_factory =
@@ -318,6 +321,15 @@ gst_mfxdec_set_property (GObject * object, guint prop_id,
   case PROP_SKIP_CORRUPTED_FRAMES:
     dec->skip_corrupted_frames = g_value_get_boolean (value);
     break;
+  case PROP_MEMORY_ALIGNMENT:
+    dec->sysmem_params.alignment = g_value_get_uint (value);
+    break;
+  case PROP_MEMORY_HUGEPAGES:
+    dec->sysmem_params.use_hugepages = g_value_get_boolean (value);
+    break;
+  case PROP_MEMORY_NUMA_NODE:
+    dec->sysmem_params.numa_node = g_value_get_int (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -340,6 +352,15 @@ gst_mfxdec_get_property (GObject * object, guint prop_id, GValue * value,
   case PROP_SKIP_CORRUPTED_FRAMES:
     g_value_set_boolean (value, dec->skip_corrupted_frames);
     break;
+  case PROP_MEMORY_ALIGNMENT:
+    g_value_set_uint (value, dec->sysmem_params.alignment);
+    break;
+  case PROP_MEMORY_HUGEPAGES:
+    g_value_set_boolean (value, dec->sysmem_params.use_hugepages);
+    break;
+  case PROP_MEMORY_NUMA_NODE:
+    g_value_set_int (value, dec->sysmem_params.numa_node);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     break;
@@ -394,6 +415,9 @@ gst_mfxdec_create (GstMfxDec * mfxdec, GstCaps * caps)
   if (mfxdec->skip_corrupted_frames)
     gst_mfx_decoder_skip_corrupted_frames (mfxdec->decoder);
 
+  gst_mfx_decoder_set_system_memory_params (mfxdec->decoder,
+      &mfxdec->sysmem_params);
+
   mfxdec->do_renego = TRUE;
   mfxdec->do_reconfigure = FALSE;
   mfxdec->mfxsurface_incompatibility = FALSE;
@@ -796,6 +820,24 @@ gst_mfxdec_class_init (GstMfxDecClass *klass)
       "Skip decoded frames that have major corruption",
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_MEMORY_ALIGNMENT,
+  g_param_spec_uint ("memory-alignment", "Memory alignment",
+      "Alignment in bytes of system memory surfaces (0 = default)",
+      0, 4096, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MEMORY_HUGEPAGES,
+  g_param_spec_boolean ("memory-hugepages",
+      "Huge pages",
+      "Back system memory surfaces with huge pages",
+      FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MEMORY_NUMA_NODE,
+  g_param_spec_int ("memory-numa-node", "NUMA node",
+      "NUMA node to bind system memory surfaces to (-1 = none)",
+      -1, 63, -1,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   vdec_class->open = GST_DEBUG_FUNCPTR (gst_mfxdec_open);
   vdec_class->close = GST_DEBUG_FUNCPTR (gst_mfxdec_close);
   vdec_class->flush = GST_DEBUG_FUNCPTR (gst_mfxdec_flush);
@@ -848,6 +890,7 @@ gst_mfxdec_init (GstMfxDec *mfxdec)
   mfxdec->async_depth = DEFAULT_ASYNC_DEPTH;
   mfxdec->live_mode = FALSE;
   mfxdec->skip_corrupted_frames = FALSE;
+  mfxdec->sysmem_params.numa_node = -1;
   mfxdec->prev_surf = NULL;
   mfxdec->dequeuing = FALSE;
   mfxdec->flushing = 0;
@@ -41,6 +41,7 @@ struct _GstMfxDec {
   guint                async_depth;
   gboolean             live_mode;
   gboolean             skip_corrupted_frames;
+  GstMfxSystemMemoryParams sysmem_params;
   GstMfxSurface*       prev_surf;
   gboolean             dequeuing;
   gint                 flushing;
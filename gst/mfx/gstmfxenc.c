@@ -28,6 +28,7 @@
 #include "gstmfxvideobufferpool.h"
 
 #include <gst-libs/mfx/gstmfxdisplay.h>
+#include <gst-libs/mfx/gstmfxencodermeta.h>
 
 #define GST_PLUGIN_NAME "mfxencode"
 #define GST_PLUGIN_DESC "A MFX-based video encoder"
@@ -139,6 +140,36 @@ prop_value_lookup (GstMfxEnc * encode, guint prop_id)
   return NULL;
 }
 
+/* Checks whether the property can be changed while encoding */
+static inline gboolean
+prop_value_is_dynamic (PropValue * prop_value)
+{
+  return prop_value->id == GST_MFX_ENCODER_PROP_BITRATE
+      || prop_value->id == GST_MFX_ENCODER_PROP_VBV_MAX_BITRATE;
+}
+
+static guint
+prop_value_get_uint (GstMfxEnc * encode, GstMfxEncoderProp id)
+{
+  GPtrArray *const prop_values = encode->prop_values;
+  guint i, value = 0;
+
+  if (!prop_values)
+    return 0;
+
+  GST_OBJECT_LOCK (encode);
+  for (i = 0; i < prop_values->len; i++) {
+    PropValue *const prop_value = g_ptr_array_index (prop_values, i);
+
+    if (prop_value->id == id) {
+      value = g_value_get_uint (&prop_value->value);
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (encode);
+  return value;
+}
+
 static gboolean
 gst_mfxenc_default_get_property (GstMfxEnc * encode, guint prop_id,
     GValue * value)
@@ -146,7 +177,9 @@ gst_mfxenc_default_get_property (GstMfxEnc * encode, guint prop_id,
   PropValue *const prop_value = prop_value_lookup (encode, prop_id);
 
   if (prop_value) {
+    GST_OBJECT_LOCK (encode);
     g_value_copy (&prop_value->value, value);
+    GST_OBJECT_UNLOCK (encode);
     return TRUE;
   }
   return FALSE;
@@ -159,7 +192,13 @@ gst_mfxenc_default_set_property (GstMfxEnc * encode, guint prop_id,
   PropValue *const prop_value = prop_value_lookup (encode, prop_id);
 
   if (prop_value) {
+    GST_OBJECT_LOCK (encode);
     g_value_copy (value, &prop_value->value);
+    GST_OBJECT_UNLOCK (encode);
+
+    /* Picked up by the streaming thread at the next frame */
+    if (prop_value_is_dynamic (prop_value))
+      g_atomic_int_set (&encode->props_changed, TRUE);
     return TRUE;
   }
   return FALSE;
@@ -199,6 +238,82 @@ ensure_output_state (GstMfxEnc * encode)
   return TRUE;
 }
 
+/* Posts a summary of the encoding results accumulated so far on the bus */
+static void
+post_stats (GstMfxEnc * encode)
+{
+  GstMfxEncStats *const stats = &encode->stats;
+  gint fps_n = 30, fps_d = 1;
+  GstStructure *structure;
+
+  if (!stats->num_frames)
+    return;
+
+  if (encode->input_state
+      && GST_VIDEO_INFO_FPS_N (&encode->input_state->info)) {
+    fps_n = GST_VIDEO_INFO_FPS_N (&encode->input_state->info);
+    fps_d = GST_VIDEO_INFO_FPS_D (&encode->input_state->info);
+  }
+
+  structure = gst_structure_new ("mfx-encoder-stats",
+      "frames", G_TYPE_UINT, stats->num_frames,
+      "i-frames", G_TYPE_UINT, stats->num_i_frames,
+      "p-frames", G_TYPE_UINT, stats->num_p_frames,
+      "b-frames", G_TYPE_UINT, stats->num_b_frames,
+      "bytes", G_TYPE_UINT64, stats->total_size,
+      "bitrate", G_TYPE_UINT64, gst_util_uint64_scale (stats->total_size * 8,
+          fps_n, (guint64) fps_d * stats->num_frames),
+      "average-qp", G_TYPE_DOUBLE, stats->num_qp_frames ?
+          (gdouble) stats->qp_sum / stats->num_qp_frames : -1.0,
+      "average-encode-time", G_TYPE_UINT64,
+          stats->total_encode_time / stats->num_frames,
+      "max-encode-time", G_TYPE_UINT64, stats->max_encode_time, NULL);
+
+  gst_element_post_message (GST_ELEMENT_CAST (encode),
+      gst_message_new_element (GST_OBJECT_CAST (encode), structure));
+
+  memset (stats, 0, sizeof (*stats));
+}
+
+/* Accounts for the coded picture of @buffer, and sums the results up
+ * about every second of video */
+static void
+update_stats (GstMfxEnc * encode, GstBuffer * buffer)
+{
+  GstMfxEncoderStatsMeta *const meta =
+      gst_buffer_get_mfx_encoder_stats_meta (buffer);
+  GstMfxEncStats *const stats = &encode->stats;
+  guint interval = 30;
+
+  if (!meta)
+    return;
+
+  stats->num_frames++;
+  if (meta->frame_type & MFX_FRAMETYPE_I)
+    stats->num_i_frames++;
+  else if (meta->frame_type & MFX_FRAMETYPE_P)
+    stats->num_p_frames++;
+  else if (meta->frame_type & MFX_FRAMETYPE_B)
+    stats->num_b_frames++;
+  stats->total_size += meta->size;
+  if (meta->qp >= 0) {
+    stats->qp_sum += meta->qp;
+    stats->num_qp_frames++;
+  }
+  if (GST_CLOCK_TIME_IS_VALID (meta->encode_time)) {
+    stats->total_encode_time += meta->encode_time;
+    stats->max_encode_time = MAX (stats->max_encode_time, meta->encode_time);
+  }
+
+  if (encode->input_state
+      && GST_VIDEO_INFO_FPS_N (&encode->input_state->info))
+    interval = MAX (gst_util_uint64_scale_int_ceil (1,
+            GST_VIDEO_INFO_FPS_N (&encode->input_state->info),
+            GST_VIDEO_INFO_FPS_D (&encode->input_state->info)), 1);
+  if (stats->num_frames >= interval)
+    post_stats (encode);
+}
+
 static GstFlowReturn
 gst_mfxenc_push_frame (GstMfxEnc * encode, GstVideoCodecFrame * out_frame)
 {
@@ -216,6 +331,9 @@ gst_mfxenc_push_frame (GstMfxEnc * encode, GstVideoCodecFrame * out_frame)
     if (GST_FLOW_OK != ret)
       goto error_format_buffer;
     if (outbuf) {
+      /* Keep the encoding results on the repackaged data */
+      gst_buffer_copy_into (outbuf, out_frame->output_buffer,
+          GST_BUFFER_COPY_META, 0, -1);
       gst_buffer_replace (&out_frame->output_buffer, outbuf);
       gst_buffer_unref (outbuf);
     }
@@ -225,6 +343,8 @@ gst_mfxenc_push_frame (GstMfxEnc * encode, GstVideoCodecFrame * out_frame)
       GST_TIME_ARGS (out_frame->pts),
       gst_buffer_get_size (out_frame->output_buffer));
 
+  update_stats (encode, out_frame->output_buffer);
+
   return gst_video_encoder_finish_frame (venc, out_frame);
   /* ERRORS */
 error_format_buffer:
@@ -273,6 +393,11 @@ gst_mfxenc_get_caps (GstVideoEncoder * venc, GstCaps * filter)
 static gboolean
 gst_mfxenc_destroy (GstMfxEnc * encode)
 {
+  if (encode->chunker) {
+    gst_mfx_enc_chunker_free (encode->chunker);
+    encode->chunker = NULL;
+  }
+
   if (encode->input_state) {
     gst_video_codec_state_unref (encode->input_state);
     encode->input_state = NULL;
@@ -282,12 +407,13 @@ gst_mfxenc_destroy (GstMfxEnc * encode)
     gst_video_codec_state_unref (encode->output_state);
     encode->output_state = NULL;
   }
+  memset (&encode->stats, 0, sizeof (encode->stats));
   gst_mfx_encoder_replace (&encode->encoder, NULL);
   return TRUE;
 }
 
 static gboolean
-ensure_encoder (GstMfxEnc * encode)
+ensure_encoder (GstMfxEnc * encode, GstMfxTaskAggregator * aggregator)
 {
   GstMfxEncClass *klass = GST_MFXENC_GET_CLASS (encode);
   GstMfxEncoderStatus status;
@@ -299,7 +425,7 @@ ensure_encoder (GstMfxEnc * encode)
   if (encode->encoder)
     return TRUE;
 
-  encode->encoder = klass->alloc_encoder (encode);
+  encode->encoder = klass->alloc_encoder (encode, aggregator);
   if (!encode->encoder)
     return FALSE;
 
@@ -352,11 +478,235 @@ set_codec_state (GstMfxEnc * encode, GstVideoCodecState * state)
   return TRUE;
 }
 
+/* Starts encode->encoder, creating it with @aggregator if needed */
+static gboolean
+start_encoder (GstMfxEnc * encode, GstVideoCodecState * state,
+    GstMfxTaskAggregator * aggregator)
+{
+  GstMfxEncoderStatus status;
+
+  if (!ensure_encoder (encode, aggregator))
+    return FALSE;
+  if (!set_codec_state (encode, state))
+    return FALSE;
+
+  status = gst_mfx_encoder_start (encode->encoder);
+  if (GST_MFX_ENCODER_STATUS_SUCCESS != status)
+    return FALSE;
+  return TRUE;
+}
+
+/* Coded pictures come out in the order their frames went in, so the one
+ * the encoder lent to @frame belongs to the oldest frame still waiting for
+ * its coded data */
+static GstVideoCodecFrame *
+get_output_frame (GstMfxEnc * encode, GstVideoCodecFrame * frame)
+{
+  GstVideoCodecFrame *const oldest =
+      gst_video_encoder_get_oldest_frame (GST_VIDEO_ENCODER_CAST (encode));
+
+  if (!oldest || oldest == frame) {
+    if (oldest)
+      gst_video_codec_frame_unref (oldest);
+    return frame;
+  }
+
+  oldest->output_buffer = frame->output_buffer;
+  frame->output_buffer = NULL;
+  oldest->pts = frame->pts;
+  oldest->dts = frame->dts;
+  oldest->duration = frame->duration;
+  if (GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame))
+    GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (oldest);
+  else
+    GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (oldest);
+  gst_video_codec_frame_unref (frame);
+  return oldest;
+}
+
+/* Pushes the frames the encoder still holds, each one on the oldest frame
+ * waiting for its coded data, up to @current, the frame being handled if
+ * any. The frames older than @current that the encoder no longer holds get
+ * no coded data, since the encoder drops what it holds when reset */
+static GstFlowReturn
+drain_encoder (GstMfxEnc * encode, GstVideoCodecFrame * current)
+{
+  GstVideoEncoder *const venc = GST_VIDEO_ENCODER_CAST (encode);
+  GstVideoCodecFrame *frame;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (GST_FLOW_OK == ret
+      && (frame = gst_video_encoder_get_oldest_frame (venc))) {
+    if (frame == current) {
+      gst_video_codec_frame_unref (frame);
+      break;
+    }
+    if (GST_MFX_ENCODER_STATUS_SUCCESS ==
+        gst_mfx_encoder_flush (encode->encoder, frame))
+      ret = gst_mfxenc_push_frame (encode, frame);
+    else
+      ret = gst_video_encoder_finish_frame (venc, frame);
+  }
+  return ret;
+}
+
+/* Starts one more encoder configured like encode->encoder, which the
+ * codec hooks operate on. The encoder gets an aggregator of its own, so
+ * that its session is not joined to the others and has a scheduler of its
+ * own, and the element aggregator is left alone */
+static GstMfxEncoder *
+start_session_encoder (GstMfxEnc * encode, GstVideoCodecState * state)
+{
+  GstMfxEncoder *const encoder = encode->encoder;
+  GstMfxEncoder *session_encoder = NULL;
+  GstMfxTaskAggregator *aggregator;
+
+  aggregator = gst_mfx_task_aggregator_new ();
+  if (!aggregator)
+    return NULL;
+
+  encode->encoder = NULL;
+  if (start_encoder (encode, state, aggregator))
+    session_encoder = encode->encoder;
+  else
+    gst_mfx_encoder_replace (&encode->encoder, NULL);
+  encode->encoder = encoder;
+
+  /* The encoder holds a reference to its aggregator */
+  gst_mfx_task_aggregator_unref (aggregator);
+  return session_encoder;
+}
+
+/* Spreads the encoding over several sessions when asked to, provided the
+ * frames come in NV12 system memory that any session can read */
+static gboolean
+start_chunker (GstMfxEnc * encode, GstVideoCodecState * state)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (encode);
+  GstMfxEncoder **encoders;
+  guint num_sessions, chunk_size, i;
+  gboolean success = FALSE;
+
+  num_sessions = prop_value_get_uint (encode, GST_MFX_ENCODER_PROP_SESSIONS);
+  chunk_size = prop_value_get_uint (encode, GST_MFX_ENCODER_PROP_CHUNK_SIZE);
+  if (num_sessions < 2 || !chunk_size)
+    return TRUE;
+
+  if (!plugin->sinkpad_caps_is_raw
+      || GST_VIDEO_INFO_FORMAT (&plugin->sinkpad_upload_info) !=
+      GST_VIDEO_FORMAT_NV12) {
+    GST_WARNING_OBJECT (encode, "input is not NV12 in system memory, "
+        "encoding with a single session");
+    return TRUE;
+  }
+
+  /* The codec data comes from the first session, which is busy encoding
+   * once the sessions run */
+  if (!ensure_output_state (encode))
+    return FALSE;
+
+  encoders = g_new0 (GstMfxEncoder *, num_sessions);
+  encoders[0] = gst_mfx_encoder_ref (encode->encoder);
+  for (i = 1; i < num_sessions; i++) {
+    encoders[i] = start_session_encoder (encode, state);
+    if (!encoders[i])
+      goto done;
+  }
+
+  encode->chunker =
+      gst_mfx_enc_chunker_new (encoders, num_sessions, chunk_size);
+  success = encode->chunker != NULL;
+
+done:
+  for (i = 0; i < num_sessions; i++)
+    if (encoders[i])
+      gst_mfx_encoder_unref (encoders[i]);
+  g_free (encoders);
+  return success;
+}
+
+/* Pushes the frames the sessions are done with, in order. Waits for them
+ * when draining, or when the sessions hold as many frames as they take */
+static GstFlowReturn
+push_chunked_frames (GstMfxEnc * encode, gboolean drain)
+{
+  GstVideoEncoder *const venc = GST_VIDEO_ENCODER_CAST (encode);
+  GstVideoCodecFrame *frame;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (drain)
+    gst_mfx_enc_chunker_drain (encode->chunker);
+
+  while (GST_FLOW_OK == ret
+      && (frame = gst_mfx_enc_chunker_pop (encode->chunker,
+              drain || gst_mfx_enc_chunker_is_full (encode->chunker)))) {
+    if (frame->output_buffer)
+      ret = gst_mfxenc_push_frame (encode, frame);
+    else
+      ret = gst_video_encoder_finish_frame (venc, frame);
+  }
+
+  if (gst_mfx_enc_chunker_has_failed (encode->chunker)) {
+    GST_ERROR ("failed to encode chunk");
+    return GST_FLOW_ERROR;
+  }
+  return ret;
+}
+
+/* Applies the pending parameters to the drained encoder, in place when the
+ * running session takes them, otherwise by starting it over */
+static gboolean
+reset_encoder (GstMfxEnc * encode, GstVideoCodecState * state)
+{
+  if (GST_MFX_ENCODER_STATUS_SUCCESS == gst_mfx_encoder_reset (encode->encoder))
+    return TRUE;
+
+  GST_WARNING_OBJECT (encode, "unable to reset encoder, restarting it");
+  gst_mfx_encoder_replace (&encode->encoder, NULL);
+  return start_encoder (encode, state,
+      GST_MFX_PLUGIN_BASE_AGGREGATOR (encode));
+}
+
+/* Applies the bitrate changes made while encoding, before @frame */
+static GstFlowReturn
+reconfigure_encoder (GstMfxEnc * encode, GstVideoCodecFrame * frame)
+{
+  GPtrArray *const prop_values = encode->prop_values;
+  GstFlowReturn ret;
+  guint i;
+
+  if (g_atomic_int_compare_and_exchange (&encode->props_changed, TRUE, FALSE)
+      && prop_values) {
+    GST_OBJECT_LOCK (encode);
+    for (i = 0; i < prop_values->len; i++) {
+      PropValue *const prop_value = g_ptr_array_index (prop_values, i);
+
+      if (prop_value_is_dynamic (prop_value))
+        gst_mfx_encoder_set_property (encode->encoder, prop_value->id,
+            &prop_value->value);
+    }
+    GST_OBJECT_UNLOCK (encode);
+  }
+
+  if (!gst_mfx_encoder_needs_reset (encode->encoder))
+    return GST_FLOW_OK;
+
+  /* The encoder drops the frames it holds when reset */
+  ret = drain_encoder (encode, frame);
+  if (GST_FLOW_OK != ret)
+    return ret;
+  if (!reset_encoder (encode, encode->input_state))
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  /* Parameter sets carry the new bitrate */
+  encode->input_state_changed = TRUE;
+  return GST_FLOW_OK;
+}
+
 static gboolean
 gst_mfxenc_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
 {
   GstMfxEnc *const encode = GST_MFXENC_CAST (venc);
-  GstMfxEncoderStatus status;
 
   g_return_val_if_fail (state->caps != NULL, FALSE);
 
@@ -364,13 +714,37 @@ gst_mfxenc_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
           state->caps, NULL))
     return FALSE;
 
-  if (!ensure_encoder (encode))
-    return FALSE;
-  if (!set_codec_state (encode, state))
-    return FALSE;
-
-  status = gst_mfx_encoder_start (encode->encoder);
-  if (GST_MFX_ENCODER_STATUS_SUCCESS != status)
+  /* A running encoder is drained, then reset to the new format when it
+   * can keep its session, or started over */
+  if (encode->encoder && encode->input_state) {
+    if (!gst_video_info_is_equal (&state->info, &encode->input_state->info)) {
+      if (encode->chunker) {
+        /* All sessions start over for the new format */
+        if (GST_FLOW_OK != push_chunked_frames (encode, TRUE))
+          return FALSE;
+        gst_mfx_enc_chunker_free (encode->chunker);
+        encode->chunker = NULL;
+        gst_mfx_encoder_replace (&encode->encoder, NULL);
+        if (!start_encoder (encode, state,
+                GST_MFX_PLUGIN_BASE_AGGREGATOR (encode)))
+          return FALSE;
+      }
+      else if (GST_FLOW_OK != drain_encoder (encode, NULL))
+        return FALSE;
+      else if (set_codec_state (encode, state)) {
+        if (!reset_encoder (encode, state))
+          return FALSE;
+      }
+      else {
+        gst_mfx_encoder_replace (&encode->encoder, NULL);
+        if (!start_encoder (encode, state,
+                GST_MFX_PLUGIN_BASE_AGGREGATOR (encode)))
+          return FALSE;
+      }
+    }
+  }
+  else if (!start_encoder (encode, state,
+          GST_MFX_PLUGIN_BASE_AGGREGATOR (encode)))
     return FALSE;
 
   if (encode->input_state)
@@ -378,9 +752,34 @@ gst_mfxenc_set_format (GstVideoEncoder * venc, GstVideoCodecState * state)
   encode->input_state = gst_video_codec_state_ref (state);
   encode->input_state_changed = TRUE;
 
+  if (!encode->chunker && !start_chunker (encode, state))
+    return FALSE;
+
   return TRUE;
 }
 
+/* Keeps the regions of interest of the frame when its contents were copied
+ * to an encoder surface */
+static void
+copy_roi_metas (GstBuffer * dest, GstBuffer * src)
+{
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  if (dest == src)
+    return;
+
+  while ((meta = gst_buffer_iterate_meta (src, &state))) {
+    GstVideoRegionOfInterestMeta *roi;
+
+    if (meta->info->api != GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE)
+      continue;
+    roi = (GstVideoRegionOfInterestMeta *) meta;
+    gst_buffer_add_video_region_of_interest_meta_id (dest, roi->roi_type,
+        roi->x, roi->y, roi->w, roi->h);
+  }
+}
+
 static GstFlowReturn
 gst_mfxenc_handle_frame (GstVideoEncoder * venc, GstVideoCodecFrame * frame)
 {
@@ -389,13 +788,19 @@ gst_mfxenc_handle_frame (GstVideoEncoder * venc, GstVideoCodecFrame * frame)
   GstMfxVideoMeta *meta;
   GstMfxSurface *surface;
   GstFlowReturn ret;
-  GstBuffer *buf;
+  GstBuffer *buf = NULL;
+
+  /* The sessions keep the bitrate they started with */
+  ret = encode->chunker ? GST_FLOW_OK : reconfigure_encoder (encode, frame);
+  if (ret != GST_FLOW_OK)
+    goto error_buffer_invalid;
 
   ret = gst_mfx_plugin_base_get_input_buffer (GST_MFX_PLUGIN_BASE (encode),
       frame->input_buffer, &buf);
   if (ret != GST_FLOW_OK)
     goto error_buffer_invalid;
 
+  copy_roi_metas (buf, frame->input_buffer);
   gst_buffer_replace (&frame->input_buffer, buf);
   gst_buffer_unref (buf);
 
@@ -410,14 +815,22 @@ gst_mfxenc_handle_frame (GstVideoEncoder * venc, GstVideoCodecFrame * frame)
   gst_video_codec_frame_set_user_data (frame,
       gst_mfx_surface_ref (surface), (GDestroyNotify) gst_mfx_surface_unref);
 
+  if (encode->chunker) {
+    gst_mfx_enc_chunker_push (encode->chunker, frame);
+    return push_chunked_frames (encode, FALSE);
+  }
+
   status = gst_mfx_encoder_encode (encode->encoder, frame);
   if (status < GST_MFX_ENCODER_STATUS_SUCCESS)
     goto error_encode_frame;
   else if (status > 0) {
+    /* The frame stays pending in the base class until its coded data
+     * comes out */
+    gst_video_codec_frame_unref (frame);
     ret = GST_FLOW_OK;
     goto done;
   }
-  ret = gst_mfxenc_push_frame (encode, frame);
+  ret = gst_mfxenc_push_frame (encode, get_output_frame (encode, frame));
   gst_mfx_surface_dequeue(surface);
 
 done:
@@ -455,9 +868,7 @@ static GstFlowReturn
 gst_mfxenc_finish (GstVideoEncoder * venc)
 {
   GstMfxEnc *const encode = GST_MFXENC_CAST (venc);
-  GstMfxEncoderStatus status;
-  GstVideoCodecFrame *frame;
-  GstFlowReturn ret = GST_FLOW_ERROR;
+  GstFlowReturn ret;
 
   /* Return "not-negotiated" error since this means we did not even reach
    * GstVideoEncoder::set_format () state, where the encoder could have
@@ -465,13 +876,13 @@ gst_mfxenc_finish (GstVideoEncoder * venc)
   if (!encode->encoder)
     return GST_FLOW_NOT_NEGOTIATED;
 
-  do {
-    status = gst_mfx_encoder_flush (encode->encoder, &frame);
-    if (GST_MFX_ENCODER_STATUS_SUCCESS != status)
-      break;
-    ret = gst_mfxenc_push_frame (encode, gst_video_codec_frame_ref (frame));
-  } while (GST_FLOW_OK == ret);
+  if (encode->chunker)
+    ret = push_chunked_frames (encode, TRUE);
+  else
+    ret = drain_encoder (encode, NULL);
 
+  /* Sum up the end of the stream */
+  post_stats (encode);
   return ret;
 }
 
@@ -508,6 +919,9 @@ gst_mfxenc_init (GstMfxEnc * encode)
 
   gst_mfx_plugin_base_init (GST_MFX_PLUGIN_BASE (encode), GST_CAT_DEFAULT);
 
+  /* The encoders take NV12, which spares them a conversion VPP */
+  plugin->sinkpad_upload_nv12 = TRUE;
+
   gst_pad_use_fixed_caps (plugin->srcpad);
 }
 
@@ -24,6 +24,7 @@
 #define GST_MFXENCODE_H
 
 #include "gstmfxpluginbase.h"
+#include "gstmfxencchunker.h"
 #include <gst-libs/mfx/gstmfxencoder.h>
 
 G_BEGIN_DECLS
@@ -46,6 +47,20 @@ G_BEGIN_DECLS
 typedef struct _GstMfxEnc GstMfxEnc;
 typedef struct _GstMfxEncClass GstMfxEncClass;
 
+/* Encoding results accumulated for the next summary message */
+typedef struct
+{
+  guint 							 num_frames;
+  guint 							 num_i_frames;
+  guint 							 num_p_frames;
+  guint 							 num_b_frames;
+  guint64 						 total_size;
+  guint64 						 qp_sum;
+  guint 							 num_qp_frames;
+  GstClockTime 				 total_encode_time;
+  GstClockTime 				 max_encode_time;
+} GstMfxEncStats;
+
 struct _GstMfxEnc
 {
   /*< private >*/
@@ -59,6 +74,14 @@ struct _GstMfxEnc
   gboolean 						 need_codec_data;
   GstVideoCodecState	*output_state;
   GPtrArray 					*prop_values;
+
+  /* set when a property the encoder applies while running changed */
+  gint 								 props_changed;
+
+  /* set when encoding with several sessions */
+  GstMfxEncChunker		*chunker;
+
+  GstMfxEncStats 			 stats;
 };
 
 struct _GstMfxEncClass
@@ -72,7 +95,7 @@ struct _GstMfxEncClass
 
   gboolean      		(*set_config)     (GstMfxEnc * encode);
   GstCaps *      		(*get_caps)       (GstMfxEnc * encode);
-  GstMfxEncoder *		(*alloc_encoder)  (GstMfxEnc * encode);
+  GstMfxEncoder *		(*alloc_encoder)  (GstMfxEnc * encode, GstMfxTaskAggregator * aggregator);
   GstFlowReturn      		(*format_buffer)  (GstMfxEnc * encode, GstBuffer * in_buffer, GstBuffer ** out_buffer_ptr);
 };
 
@@ -218,14 +218,16 @@ gst_mfxenc_h264_get_caps (GstMfxEnc * base_encode)
 }
 
 static GstMfxEncoder *
-gst_mfxenc_h264_alloc_encoder (GstMfxEnc * base)
+gst_mfxenc_h264_alloc_encoder (GstMfxEnc * base,
+    GstMfxTaskAggregator * aggregator)
 {
   GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (base);
 
   if (base->encoder)
     return base->encoder;
 
-  return gst_mfx_encoder_h264_new (plugin->aggregator, &plugin->sinkpad_info,
+  return gst_mfx_encoder_h264_new (aggregator,
+      &plugin->sinkpad_upload_info,
       plugin->sinkpad_caps_is_raw);
 }
 
@@ -285,8 +287,13 @@ _h264_convert_byte_stream_to_avc (GstBuffer * inbuf, GstBuffer ** outbuf_ptr)
   guint8 *nal_start_code, *nal_body;
   guint8 *avc_data = NULL;
   guint8 *frame_end;
-  GByteArray *avc_bytes = g_byte_array_new();
+  GByteArray *avc_bytes;
 
+  if (gst_mfx_byte_stream_to_length_prefixed_in_place (inbuf,
+          _h264_byte_stream_next_nal))
+    return TRUE;
+
+  avc_bytes = g_byte_array_new();
   if (!avc_bytes)
     return FALSE;
 
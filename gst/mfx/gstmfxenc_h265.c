@@ -135,14 +135,16 @@ gst_mfxenc_h265_get_caps (GstMfxEnc * base_encode)
 }
 
 static GstMfxEncoder *
-gst_mfxenc_h265_alloc_encoder (GstMfxEnc * base)
+gst_mfxenc_h265_alloc_encoder (GstMfxEnc * base,
+    GstMfxTaskAggregator * aggregator)
 {
   GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (base);
 
   if (base->encoder)
     return base->encoder;
 
-  return gst_mfx_encoder_h265_new (plugin->aggregator, &plugin->sinkpad_info,
+  return gst_mfx_encoder_h265_new (aggregator,
+      &plugin->sinkpad_upload_info,
       plugin->sinkpad_caps_is_raw);
 }
 
@@ -202,8 +204,13 @@ _h265_convert_byte_stream_to_hvc (GstBuffer * inbuf, GstBuffer ** outbuf_ptr)
   guint8 *nal_start_code, *nal_body;
   guint8 *hvc1_data = NULL;
   guint8 *frame_end;
-  GByteArray *hvc1_bytes = g_byte_array_new();
+  GByteArray *hvc1_bytes;
 
+  if (gst_mfx_byte_stream_to_length_prefixed_in_place (inbuf,
+          _h265_byte_stream_next_nal))
+    return TRUE;
+
+  hvc1_bytes = g_byte_array_new();
   if (!hvc1_bytes)
     return FALSE;
 
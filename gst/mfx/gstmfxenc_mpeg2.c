@@ -109,14 +109,16 @@ gst_mfxenc_mpeg2_get_caps (GstMfxEnc * base_encode)
 }
 
 static GstMfxEncoder *
-gst_mfxenc_mpeg2_alloc_encoder (GstMfxEnc * base)
+gst_mfxenc_mpeg2_alloc_encoder (GstMfxEnc * base,
+    GstMfxTaskAggregator * aggregator)
 {
   GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (base);
 
   if (base->encoder)
     return base->encoder;
 
-  return gst_mfx_encoder_mpeg2_new (plugin->aggregator, &plugin->sinkpad_info,
+  return gst_mfx_encoder_mpeg2_new (aggregator,
+      &plugin->sinkpad_upload_info,
       plugin->sinkpad_caps_is_raw);
 }
 
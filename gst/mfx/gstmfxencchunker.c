@@ -0,0 +1,501 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#include "gst-libs/mfx/sysdeps.h"
+#include "gstmfxencchunker.h"
+
+#include <gst-libs/mfx/gstmfxsurface.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_mfxencchunker);
+#define GST_CAT_DEFAULT gst_debug_mfxencchunker
+
+/* A coded picture of a chunk, in the order the session returned it */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstClockTime pts;
+  GstClockTime dts;
+  GstClockTime duration;
+  gboolean sync_point;
+} ChunkOutput;
+
+/* A run of consecutive frames, encoded by a single session as a closed
+ * sequence that starts with an IDR picture */
+typedef struct
+{
+  guint session;
+  GPtrArray *frames;
+  GArray *outputs;
+  guint num_submitted;
+  guint num_popped;
+  gboolean closed;
+  gboolean done;
+} Chunk;
+
+typedef struct
+{
+  GstMfxEncChunker *chunker;
+  GstMfxEncoder *encoder;
+  guint index;
+  GThread *thread;
+} ChunkSession;
+
+struct _GstMfxEncChunker
+{
+  ChunkSession *sessions;
+  guint num_sessions;
+  guint chunk_size;
+
+  /* Chunks in stream order, the last one being filled. The fields below
+   * are protected by the lock */
+  GMutex lock;
+  GCond cond;
+  GQueue chunks;
+  guint num_chunks;
+  guint num_pending;
+  gboolean failed;
+  gboolean stopping;
+};
+
+static void
+chunk_output_clear (ChunkOutput * output)
+{
+  gst_buffer_replace (&output->buffer, NULL);
+}
+
+static Chunk *
+chunk_new (guint session, guint chunk_size)
+{
+  Chunk *const chunk = g_slice_new0 (Chunk);
+
+  chunk->session = session;
+  chunk->frames = g_ptr_array_sized_new (chunk_size);
+  chunk->outputs =
+      g_array_sized_new (FALSE, TRUE, sizeof (ChunkOutput), chunk_size);
+  g_array_set_clear_func (chunk->outputs,
+      (GDestroyNotify) chunk_output_clear);
+  return chunk;
+}
+
+static void
+chunk_free (Chunk * chunk)
+{
+  guint i;
+
+  for (i = chunk->num_popped; i < chunk->frames->len; i++)
+    gst_video_codec_frame_unref (g_ptr_array_index (chunk->frames, i));
+  g_ptr_array_unref (chunk->frames);
+  g_array_unref (chunk->outputs);
+  g_slice_free (Chunk, chunk);
+}
+
+/* Moves the coded picture the encoder left on @frame to @chunk */
+static void
+chunk_add_output (Chunk * chunk, GstVideoCodecFrame * frame)
+{
+  ChunkOutput output;
+
+  output.buffer = frame->output_buffer;
+  output.pts = frame->pts;
+  output.dts = frame->dts;
+  output.duration = frame->duration;
+  output.sync_point = GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame);
+  frame->output_buffer = NULL;
+
+  g_array_append_val (chunk->outputs, output);
+}
+
+/* The oldest chunk of @session that still has work left */
+static Chunk *
+next_chunk (GstMfxEncChunker * chunker, guint session)
+{
+  GList *l;
+
+  for (l = chunker->chunks.head; l; l = l->next) {
+    Chunk *const chunk = l->data;
+
+    if (chunk->session == session && !chunk->done)
+      return chunk;
+  }
+  return NULL;
+}
+
+static GstMfxEncoderStatus
+encode_frame (ChunkSession * session, GstVideoCodecFrame * frame)
+{
+  GstMfxSurface *const surface = gst_video_codec_frame_get_user_data (frame);
+  GstMfxEncoderStatus status;
+
+  status = gst_mfx_encoder_encode (session->encoder, frame);
+  gst_mfx_surface_dequeue (surface);
+
+  /* The encoder holds on to the surface while it reads it, so hand the
+   * upload buffer back to its pool instead of keeping it until the frame
+   * is pushed */
+  gst_video_codec_frame_set_user_data (frame, NULL, NULL);
+  gst_buffer_replace (&frame->input_buffer, NULL);
+
+  if (status < GST_MFX_ENCODER_STATUS_SUCCESS)
+    GST_ERROR ("session %u failed to encode frame %d (status %d)",
+        session->index, frame->system_frame_number, status);
+  return status;
+}
+
+/* Makes the next chunk of @session an independent sequence */
+static gboolean
+start_new_sequence (ChunkSession * session)
+{
+  GstMfxEncoderStatus status;
+
+  gst_mfx_encoder_request_new_sequence (session->encoder);
+  status = gst_mfx_encoder_reset (session->encoder);
+  if (GST_MFX_ENCODER_STATUS_SUCCESS != status) {
+    GST_ERROR ("session %u failed to start a new sequence", session->index);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static gpointer
+chunk_session_run (ChunkSession * session)
+{
+  GstMfxEncChunker *const chunker = session->chunker;
+  GstMfxEncoderStatus status;
+  GstVideoCodecFrame *frame;
+  gboolean success;
+  Chunk *chunk;
+
+  g_mutex_lock (&chunker->lock);
+  while (!chunker->stopping && !chunker->failed) {
+    chunk = next_chunk (chunker, session->index);
+
+    if (chunk && chunk->num_submitted < chunk->frames->len) {
+      frame = g_ptr_array_index (chunk->frames, chunk->num_submitted++);
+
+      g_mutex_unlock (&chunker->lock);
+      status = encode_frame (session, frame);
+      g_mutex_lock (&chunker->lock);
+
+      if (GST_MFX_ENCODER_STATUS_SUCCESS == status)
+        chunk_add_output (chunk, frame);
+      else if (status < GST_MFX_ENCODER_STATUS_SUCCESS)
+        chunker->failed = TRUE;
+    }
+    else if (chunk && chunk->closed) {
+      /* All frames are in, drain the session into the chunk. The coded
+       * picture goes through the first frame without one, which is not
+       * returned by gst_mfx_enc_chunker_pop() until it has one */
+      frame = chunk->outputs->len < chunk->frames->len ?
+          g_ptr_array_index (chunk->frames, chunk->outputs->len) : NULL;
+
+      g_mutex_unlock (&chunker->lock);
+      status = frame ? gst_mfx_encoder_flush (session->encoder, frame) :
+          GST_MFX_ENCODER_STATUS_MORE_DATA;
+      success = GST_MFX_ENCODER_STATUS_SUCCESS == status
+          || start_new_sequence (session);
+      g_mutex_lock (&chunker->lock);
+
+      if (GST_MFX_ENCODER_STATUS_SUCCESS == status)
+        chunk_add_output (chunk, frame);
+      else
+        chunk->done = TRUE;
+      if (!success)
+        chunker->failed = TRUE;
+    }
+    else {
+      g_cond_wait (&chunker->cond, &chunker->lock);
+      continue;
+    }
+    g_cond_broadcast (&chunker->cond);
+  }
+  g_mutex_unlock (&chunker->lock);
+
+  return NULL;
+}
+
+/**
+ * gst_mfx_enc_chunker_new:
+ * @encoders: the started encoders, one per session
+ * @num_sessions: the number of @encoders
+ * @chunk_size: the number of frames of a chunk
+ *
+ * Splits the stream into chunks of @chunk_size frames, which are encoded
+ * in parallel by @encoders in turn, each on a thread of its own. Every
+ * chunk is a closed sequence starting with an IDR picture, so that the
+ * coded chunks concatenate into a single stream as long as @encoders were
+ * configured alike.
+ *
+ * Return value: the newly allocated #GstMfxEncChunker, or %NULL on error
+ */
+GstMfxEncChunker *
+gst_mfx_enc_chunker_new (GstMfxEncoder ** encoders, guint num_sessions,
+    guint chunk_size)
+{
+  static gsize g_debug_init = 0;
+  GstMfxEncChunker *chunker;
+  guint i;
+
+  g_return_val_if_fail (encoders != NULL, NULL);
+  g_return_val_if_fail (num_sessions > 0 && chunk_size > 0, NULL);
+
+  if (g_once_init_enter (&g_debug_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_debug_mfxencchunker,
+        "mfxencchunker", 0, "MFX chunked parallel encoding");
+    g_once_init_leave (&g_debug_init, 1);
+  }
+
+  chunker = g_slice_new0 (GstMfxEncChunker);
+  chunker->sessions = g_new0 (ChunkSession, num_sessions);
+  chunker->num_sessions = num_sessions;
+  chunker->chunk_size = chunk_size;
+  g_mutex_init (&chunker->lock);
+  g_cond_init (&chunker->cond);
+  g_queue_init (&chunker->chunks);
+
+  for (i = 0; i < num_sessions; i++) {
+    ChunkSession *const session = &chunker->sessions[i];
+
+    session->chunker = chunker;
+    session->encoder = gst_mfx_encoder_ref (encoders[i]);
+    session->index = i;
+    session->thread = g_thread_try_new ("mfxenc-chunk",
+        (GThreadFunc) chunk_session_run, session, NULL);
+    if (!session->thread)
+      goto error_thread;
+  }
+
+  GST_INFO ("encoding chunks of %u frames with %u sessions", chunk_size,
+      num_sessions);
+  return chunker;
+  /* ERRORS */
+error_thread:
+  {
+    GST_ERROR ("failed to start the thread of session %u", i);
+    gst_mfx_enc_chunker_free (chunker);
+    return NULL;
+  }
+}
+
+/**
+ * gst_mfx_enc_chunker_free:
+ * @chunker: a #GstMfxEncChunker
+ *
+ * Stops the sessions of @chunker and releases the frames it still holds.
+ */
+void
+gst_mfx_enc_chunker_free (GstMfxEncChunker * chunker)
+{
+  Chunk *chunk;
+  guint i;
+
+  g_return_if_fail (chunker != NULL);
+
+  g_mutex_lock (&chunker->lock);
+  chunker->stopping = TRUE;
+  g_cond_broadcast (&chunker->cond);
+  g_mutex_unlock (&chunker->lock);
+
+  for (i = 0; i < chunker->num_sessions; i++) {
+    ChunkSession *const session = &chunker->sessions[i];
+
+    if (session->thread)
+      g_thread_join (session->thread);
+    if (session->encoder)
+      gst_mfx_encoder_unref (session->encoder);
+  }
+  g_free (chunker->sessions);
+
+  while ((chunk = g_queue_pop_head (&chunker->chunks)))
+    chunk_free (chunk);
+
+  g_cond_clear (&chunker->cond);
+  g_mutex_clear (&chunker->lock);
+  g_slice_free (GstMfxEncChunker, chunker);
+}
+
+/**
+ * gst_mfx_enc_chunker_push:
+ * @chunker: a #GstMfxEncChunker
+ * @frame: (transfer full): the #GstVideoCodecFrame to encode, with its
+ *   #GstMfxSurface as user data
+ *
+ * Queues @frame for encoding in the current chunk, which is handed to its
+ * session once full. @frame is returned by gst_mfx_enc_chunker_pop()
+ * when coded.
+ */
+void
+gst_mfx_enc_chunker_push (GstMfxEncChunker * chunker,
+    GstVideoCodecFrame * frame)
+{
+  Chunk *chunk;
+
+  g_return_if_fail (chunker != NULL);
+  g_return_if_fail (frame != NULL);
+
+  g_mutex_lock (&chunker->lock);
+  chunk = g_queue_peek_tail (&chunker->chunks);
+  if (!chunk || chunk->closed) {
+    chunk = chunk_new (chunker->num_chunks++ % chunker->num_sessions,
+        chunker->chunk_size);
+    g_queue_push_tail (&chunker->chunks, chunk);
+  }
+
+  g_ptr_array_add (chunk->frames, frame);
+  if (chunk->frames->len == chunker->chunk_size)
+    chunk->closed = TRUE;
+  chunker->num_pending++;
+
+  g_cond_broadcast (&chunker->cond);
+  g_mutex_unlock (&chunker->lock);
+}
+
+/**
+ * gst_mfx_enc_chunker_pop:
+ * @chunker: a #GstMfxEncChunker
+ * @wait: whether to wait for the oldest frame to be coded
+ *
+ * Returns the oldest frame pushed to @chunker, in presentation order,
+ * once its chunk has been coded that far. The frame carries the coded
+ * picture of the same rank in the chunk, in decode order, with its
+ * timestamps and sync point flag. Frames a session did not return any
+ * coded data for are returned without an output buffer.
+ *
+ * With @wait, waits for the frame unless it belongs to the chunk still
+ * being filled, which may not be coded before more frames come in.
+ *
+ * Return value: (transfer full): the oldest coded #GstVideoCodecFrame, or
+ *   %NULL if there is none or a session failed
+ */
+GstVideoCodecFrame *
+gst_mfx_enc_chunker_pop (GstMfxEncChunker * chunker, gboolean wait)
+{
+  GstVideoCodecFrame *frame = NULL;
+  Chunk *chunk;
+
+  g_return_val_if_fail (chunker != NULL, NULL);
+
+  g_mutex_lock (&chunker->lock);
+  while ((chunk = g_queue_peek_head (&chunker->chunks)) && !chunker->failed) {
+    if (chunk->done && chunk->num_popped == chunk->frames->len) {
+      chunk_free (g_queue_pop_head (&chunker->chunks));
+      continue;
+    }
+
+    if (chunk->num_popped < chunk->frames->len
+        && (chunk->num_popped < chunk->outputs->len || chunk->done)) {
+      frame = g_ptr_array_index (chunk->frames, chunk->num_popped);
+
+      if (chunk->num_popped < chunk->outputs->len) {
+        ChunkOutput *const output = &g_array_index (chunk->outputs,
+            ChunkOutput, chunk->num_popped);
+
+        gst_buffer_replace (&frame->output_buffer, output->buffer);
+        frame->pts = output->pts;
+        frame->dts = output->dts;
+        frame->duration = output->duration;
+        if (output->sync_point)
+          GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
+        else
+          GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
+        chunk_output_clear (output);
+      }
+      chunk->num_popped++;
+      chunker->num_pending--;
+      break;
+    }
+
+    if (!wait || !chunk->closed)
+      break;
+    g_cond_wait (&chunker->cond, &chunker->lock);
+  }
+  g_mutex_unlock (&chunker->lock);
+
+  return frame;
+}
+
+/**
+ * gst_mfx_enc_chunker_drain:
+ * @chunker: a #GstMfxEncChunker
+ *
+ * Ends the chunk being filled, so that all the frames pushed so far can
+ * be returned by gst_mfx_enc_chunker_pop().
+ */
+void
+gst_mfx_enc_chunker_drain (GstMfxEncChunker * chunker)
+{
+  Chunk *chunk;
+
+  g_return_if_fail (chunker != NULL);
+
+  g_mutex_lock (&chunker->lock);
+  chunk = g_queue_peek_tail (&chunker->chunks);
+  if (chunk && !chunk->closed) {
+    chunk->closed = TRUE;
+    g_cond_broadcast (&chunker->cond);
+  }
+  g_mutex_unlock (&chunker->lock);
+}
+
+/**
+ * gst_mfx_enc_chunker_is_full:
+ * @chunker: a #GstMfxEncChunker
+ *
+ * Checks whether every session has a whole chunk of frames queued, past
+ * which frames should be popped before more are pushed, to bound the
+ * number of raw frames held.
+ *
+ * Return value: %TRUE if @chunker is full
+ */
+gboolean
+gst_mfx_enc_chunker_is_full (GstMfxEncChunker * chunker)
+{
+  gboolean is_full;
+
+  g_return_val_if_fail (chunker != NULL, FALSE);
+
+  g_mutex_lock (&chunker->lock);
+  is_full = chunker->num_pending >= chunker->num_sessions * chunker->chunk_size;
+  g_mutex_unlock (&chunker->lock);
+
+  return is_full;
+}
+
+/**
+ * gst_mfx_enc_chunker_has_failed:
+ * @chunker: a #GstMfxEncChunker
+ *
+ * Checks whether a session of @chunker failed to encode, after which no
+ * more frames are returned.
+ *
+ * Return value: %TRUE if encoding failed
+ */
+gboolean
+gst_mfx_enc_chunker_has_failed (GstMfxEncChunker * chunker)
+{
+  gboolean failed;
+
+  g_return_val_if_fail (chunker != NULL, FALSE);
+
+  g_mutex_lock (&chunker->lock);
+  failed = chunker->failed;
+  g_mutex_unlock (&chunker->lock);
+
+  return failed;
+}
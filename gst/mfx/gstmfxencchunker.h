@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_ENC_CHUNKER_H
+#define GST_MFX_ENC_CHUNKER_H
+
+#include <gst-libs/mfx/gstmfxencoder.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstMfxEncChunker GstMfxEncChunker;
+
+GstMfxEncChunker *
+gst_mfx_enc_chunker_new (GstMfxEncoder ** encoders, guint num_sessions,
+    guint chunk_size);
+
+void
+gst_mfx_enc_chunker_free (GstMfxEncChunker * chunker);
+
+void
+gst_mfx_enc_chunker_push (GstMfxEncChunker * chunker,
+    GstVideoCodecFrame * frame);
+
+GstVideoCodecFrame *
+gst_mfx_enc_chunker_pop (GstMfxEncChunker * chunker, gboolean wait);
+
+void
+gst_mfx_enc_chunker_drain (GstMfxEncChunker * chunker);
+
+gboolean
+gst_mfx_enc_chunker_is_full (GstMfxEncChunker * chunker);
+
+gboolean
+gst_mfx_enc_chunker_has_failed (GstMfxEncChunker * chunker);
+
+G_END_DECLS
+
+#endif /* GST_MFX_ENC_CHUNKER_H */
@@ -29,6 +29,9 @@
 #include "gstmfxvideometa.h"
 #include "gstmfxvideobufferpool.h"
 
+#include <gst-libs/mfx/gstmfxsurface_vaapi.h>
+#include <gst-libs/mfx/gstmfxconvert.h>
+
 #ifdef HAVE_GST_GL_LIBS
 # if GST_CHECK_VERSION(1,11,1)
 # include <gst/gl/gstglcontext.h>
@@ -89,12 +92,16 @@ gst_mfx_plugin_base_init (GstMfxPluginBase * plugin,
   /* sink pad */
   plugin->sinkpad = gst_element_get_static_pad (GST_ELEMENT (plugin), "sink");
   gst_video_info_init (&plugin->sinkpad_info);
-  plugin->sinkpad_query = GST_PAD_QUERYFUNC (plugin->sinkpad);
+  gst_video_info_init (&plugin->sinkpad_upload_info);
+  /* Elements with request pads have no static one */
+  if (plugin->sinkpad)
+    plugin->sinkpad_query = GST_PAD_QUERYFUNC (plugin->sinkpad);
 
   /* src pad */
   if (!(GST_OBJECT_FLAGS (plugin) & GST_ELEMENT_FLAG_SINK)) {
     plugin->srcpad = gst_element_get_static_pad (GST_ELEMENT (plugin), "src");
-    plugin->srcpad_query = GST_PAD_QUERYFUNC (plugin->srcpad);
+    if (plugin->srcpad)
+      plugin->srcpad_query = GST_PAD_QUERYFUNC (plugin->srcpad);
   }
   gst_video_info_init (&plugin->srcpad_info);
 
@@ -105,6 +112,8 @@ void
 gst_mfx_plugin_base_finalize (GstMfxPluginBase * plugin)
 {
   gst_mfx_plugin_base_close (plugin);
+  if (plugin->dmabuf_exports)
+    g_hash_table_unref (plugin->dmabuf_exports);
   if (plugin->sinkpad)
     gst_object_unref (plugin->sinkpad);
   if (plugin->srcpad)
@@ -126,11 +135,14 @@ gst_mfx_plugin_base_close (GstMfxPluginBase * plugin)
   gst_caps_replace (&plugin->sinkpad_caps, NULL);
   plugin->sinkpad_caps_changed = FALSE;
   gst_video_info_init (&plugin->sinkpad_info);
+  gst_video_info_init (&plugin->sinkpad_upload_info);
   if (plugin->sinkpad_buffer_pool) {
     gst_object_unref (plugin->sinkpad_buffer_pool);
     plugin->sinkpad_buffer_pool = NULL;
   }
   g_clear_object (&plugin->srcpad_buffer_pool);
+  if (plugin->dmabuf_exports)
+    g_hash_table_remove_all (plugin->dmabuf_exports);
 
   gst_caps_replace (&plugin->srcpad_caps, NULL);
   plugin->srcpad_caps_changed = FALSE;
@@ -180,8 +192,8 @@ has_dmabuf_capable_peer (GstMfxPluginBase * plugin, GstPad * pad)
       g_object_get (element, "io-mode", &v, NULL);
       if (strncmp (element_name, "camerasrc", 9) == 0)
         is_dmabuf_capable = v == 3;
-      else
-        is_dmabuf_capable = v == 5;     /* "dmabuf-import" enum value */
+      else                      /* "dmabuf" or "dmabuf-import" enum value */
+        is_dmabuf_capable = v == 4 || v == 5;
       break;
     } else if (GST_IS_BASE_TRANSFORM (element)) {
       if (sscanf (element_name, "capsfilter%d", &v) != 1)
@@ -203,6 +215,15 @@ has_dmabuf_capable_peer (GstMfxPluginBase * plugin, GstPad * pad)
   return is_dmabuf_capable;
 }
 
+/* Whether raw input of @format is converted to NV12 while being copied
+ * into the sink pad pool, sparing a colorspace conversion VPP */
+static gboolean
+upload_needs_conversion (GstMfxPluginBase * plugin, GstVideoFormat format)
+{
+  return plugin->sinkpad_upload_nv12 && plugin->sinkpad_caps_is_raw
+      && gst_mfx_convert_to_nv12_is_supported (format);
+}
+
 /**
  * ensure_sinkpad_buffer_pool:
  * @plugin: a #GstMfxPluginBase
@@ -232,13 +253,26 @@ ensure_sinkpad_buffer_pool (GstMfxPluginBase * plugin, GstCaps * caps)
   if (!gst_mfx_plugin_base_ensure_aggregator (plugin))
     return FALSE;
 
+  gst_video_info_init (&vi);
+  gst_video_info_from_caps (&vi, caps);
+  if (upload_needs_conversion (plugin, GST_VIDEO_INFO_FORMAT (&vi))) {
+    gst_video_info_change_format (&vi, GST_VIDEO_FORMAT_NV12,
+        GST_VIDEO_INFO_WIDTH (&vi), GST_VIDEO_INFO_HEIGHT (&vi));
+    caps = gst_video_info_to_caps (&vi);
+  }
+  else {
+    gst_caps_ref (caps);
+  }
+
   if (plugin->sinkpad_buffer_pool) {
     config = gst_buffer_pool_get_config (plugin->sinkpad_buffer_pool);
     gst_buffer_pool_config_get_params (config, &pool_caps, NULL, NULL, NULL);
     need_pool = !gst_caps_is_equal (caps, pool_caps);
     gst_structure_free (config);
-    if (!need_pool)
+    if (!need_pool) {
+      gst_caps_unref (caps);
       return TRUE;
+    }
     g_clear_object (&plugin->sinkpad_buffer_pool);
     plugin->sinkpad_buffer_size = 0;
   }
@@ -249,8 +283,6 @@ ensure_sinkpad_buffer_pool (GstMfxPluginBase * plugin, GstCaps * caps)
   if (!pool)
     goto error_create_pool;
 
-  gst_video_info_init (&vi);
-  gst_video_info_from_caps (&vi, caps);
   plugin->sinkpad_buffer_size = vi.size;
 
   config = gst_buffer_pool_get_config (pool);
@@ -259,22 +291,29 @@ ensure_sinkpad_buffer_pool (GstMfxPluginBase * plugin, GstCaps * caps)
   gst_buffer_pool_config_add_option (config,
       GST_BUFFER_POOL_OPTION_MFX_VIDEO_META);
   gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  /* Uploaded frames are only read by the SDK, so each buffer can keep its
+   * surface, and the cached mapping of it, across acquisitions */
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_MFX_BOUND_SURFACE);
   if (!gst_buffer_pool_set_config (pool, config))
     goto error_pool_config;
   plugin->sinkpad_buffer_pool = pool;
 
+  gst_caps_unref (caps);
   return TRUE;
 
   /* ERRORS */
 error_create_pool:
   {
     GST_ERROR ("failed to create buffer pool");
+    gst_caps_unref (caps);
     return FALSE;
   }
 error_pool_config:
   {
     GST_ERROR ("failed to reset buffer pool config");
     gst_object_unref (pool);
+    gst_caps_unref (caps);
     return FALSE;
   }
 }
@@ -313,6 +352,14 @@ gst_mfx_plugin_base_set_caps (GstMfxPluginBase * plugin, GstCaps * incaps,
     if (!ensure_sinkpad_buffer_pool (plugin, plugin->sinkpad_caps))
       return FALSE;
 
+  /* What the subclass is handed by gst_mfx_plugin_base_get_input_buffer() */
+  plugin->sinkpad_upload_info = plugin->sinkpad_info;
+  if (upload_needs_conversion (plugin,
+          GST_VIDEO_INFO_FORMAT (&plugin->sinkpad_info)))
+    gst_video_info_change_format (&plugin->sinkpad_upload_info,
+        GST_VIDEO_FORMAT_NV12, GST_VIDEO_INFO_WIDTH (&plugin->sinkpad_info),
+        GST_VIDEO_INFO_HEIGHT (&plugin->sinkpad_info));
+
   return TRUE;
 }
 
@@ -357,8 +404,11 @@ gst_mfx_plugin_base_propose_allocation (GstMfxPluginBase * plugin,
 
     if (!ensure_sinkpad_buffer_pool (plugin, caps))
       return FALSE;
-    gst_query_add_allocation_pool (query, plugin->sinkpad_buffer_pool,
-        plugin->sinkpad_buffer_size, 0, 0);
+    /* The pool holds converted frames that upstream cannot write */
+    if (!upload_needs_conversion (plugin,
+            GST_VIDEO_INFO_FORMAT (&plugin->sinkpad_info)))
+      gst_query_add_allocation_pool (query, plugin->sinkpad_buffer_pool,
+          plugin->sinkpad_buffer_size, 0, 0);
 
     if (plugin->sinkpad_has_dmabuf) {
       GstStructure *const config =
@@ -522,6 +572,9 @@ gst_mfx_plugin_base_decide_allocation (GstMfxPluginBase * plugin,
 
   g_clear_object (&plugin->srcpad_buffer_pool);
   plugin->srcpad_buffer_pool = pool;
+  /* Surfaces of the previous pool are not going to be pushed anymore */
+  if (plugin->dmabuf_exports)
+    g_hash_table_remove_all (plugin->dmabuf_exports);
   return TRUE;
 
   /* ERRORS */
@@ -551,6 +604,199 @@ config_failed:
   }
 }
 
+static void
+input_frame_free (GstVideoFrame * frame)
+{
+  gst_video_frame_unmap (frame);
+  g_slice_free (GstVideoFrame, frame);
+}
+
+/* Wraps the planes of a raw upstream buffer in a system memory surface,
+ * avoiding the upload copy. The mapped frame, and thus a reference to
+ * @inbuf, is kept alive until the surface is destroyed */
+static GstBuffer *
+import_input_buffer (GstMfxPluginBase * plugin, GstBuffer * inbuf)
+{
+  GstMfxVideoMeta *meta;
+  GstMfxSurface *surface;
+  GstVideoFrame *frame;
+  GstBuffer *outbuf;
+
+  if (gst_buffer_n_memory (inbuf) != 1)
+    return NULL;
+
+  frame = g_slice_new (GstVideoFrame);
+  if (!gst_video_frame_map (frame, &plugin->sinkpad_info, inbuf,
+          GST_MAP_READ))
+    goto error_map_buffer;
+
+  if (GST_VIDEO_FRAME_WIDTH (frame) !=
+      GST_VIDEO_INFO_WIDTH (&plugin->sinkpad_info)
+      || GST_VIDEO_FRAME_HEIGHT (frame) !=
+      GST_VIDEO_INFO_HEIGHT (&plugin->sinkpad_info))
+    goto error_unmap_frame;
+
+  surface = gst_mfx_surface_new_from_data (&frame->info, frame->map[0].data,
+      frame->map[0].size, (guint8 **) frame->data, frame->info.stride, frame,
+      (GDestroyNotify) input_frame_free);
+  if (!surface)
+    goto error_unmap_frame;
+
+  meta = gst_mfx_video_meta_new ();
+  if (!meta)
+    goto error_create_meta;
+  gst_mfx_video_meta_set_surface (meta, surface);
+  gst_mfx_surface_unref (surface);
+
+  outbuf = gst_buffer_new ();
+  gst_buffer_set_mfx_video_meta (outbuf, meta);
+  gst_mfx_video_meta_unref (meta);
+
+  gst_buffer_copy_into (outbuf, inbuf,
+    GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+  return outbuf;
+
+error_create_meta:
+  {
+    gst_mfx_surface_unref (surface);
+    return NULL;
+  }
+error_unmap_frame:
+  {
+    gst_video_frame_unmap (frame);
+    // fall-through
+  }
+error_map_buffer:
+  {
+    GST_LOG ("input buffer layout not suitable for zero-copy import");
+    g_slice_free (GstVideoFrame, frame);
+    return NULL;
+  }
+}
+
+#define GST_MFX_DMABUF_SURFACE_QUARK gst_mfx_dmabuf_surface_quark_get ()
+static GQuark
+gst_mfx_dmabuf_surface_quark_get (void)
+{
+  static gsize g_quark;
+
+  if (g_once_init_enter (&g_quark)) {
+    gsize quark = (gsize) g_quark_from_static_string ("GstMfxDmabufSurface");
+    g_once_init_leave (&g_quark, quark);
+  }
+  return g_quark;
+}
+
+/* Imports an upstream dmabuf as a VA surface. The surface is cached on the
+ * dmabuf memory, i.e. per fd, so that the recycled buffers of a producer
+ * pool are only imported once */
+static GstMfxSurface *
+ensure_dmabuf_surface (GstMfxPluginBase * plugin, GstBuffer * inbuf)
+{
+  GstMfxDisplay *display;
+  GstMfxSurface *surface;
+  GstVideoMeta *vmeta;
+  GstVideoInfo vi;
+  GstMemory *mem;
+  guint i;
+
+  if (gst_buffer_n_memory (inbuf) != 1)
+    return NULL;
+
+  mem = gst_buffer_peek_memory (inbuf, 0);
+  if (!gst_is_dmabuf_memory (mem))
+    return NULL;
+
+  display = gst_mfx_task_aggregator_get_display (plugin->aggregator);
+
+  /* The memory may have been imported by an element of another pipeline */
+  surface = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+      GST_MFX_DMABUF_SURFACE_QUARK);
+  if (surface) {
+    GstMfxDisplay *const surface_display =
+        gst_mfx_surface_vaapi_get_display (surface);
+    gboolean is_cached = surface_display == display;
+
+    gst_mfx_display_unref (surface_display);
+    if (is_cached)
+      goto done;
+  }
+
+  vi = plugin->sinkpad_info;
+  vmeta = gst_buffer_get_video_meta (inbuf);
+  if (vmeta) {
+    if (vmeta->width != GST_VIDEO_INFO_WIDTH (&vi)
+        || vmeta->height != GST_VIDEO_INFO_HEIGHT (&vi)
+        || vmeta->n_planes != GST_VIDEO_INFO_N_PLANES (&vi))
+      goto error_invalid_layout;
+    for (i = 0; i < vmeta->n_planes; i++) {
+      GST_VIDEO_INFO_PLANE_OFFSET (&vi, i) = vmeta->offset[i];
+      GST_VIDEO_INFO_PLANE_STRIDE (&vi, i) = vmeta->stride[i];
+    }
+  }
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&vi); i++)
+    GST_VIDEO_INFO_PLANE_OFFSET (&vi, i) += mem->offset;
+
+  surface = gst_mfx_surface_vaapi_new_from_dmabuf (display, &vi,
+      gst_dmabuf_memory_get_fd (mem), mem->offset + mem->size);
+  if (!surface)
+    goto error_import;
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+      GST_MFX_DMABUF_SURFACE_QUARK, surface,
+      (GDestroyNotify) gst_mfx_surface_unref);
+
+  GST_DEBUG_OBJECT (plugin, "imported dmabuf fd %d as VA surface %"
+      GST_MFX_ID_FORMAT, gst_dmabuf_memory_get_fd (mem),
+      GST_MFX_ID_ARGS (GST_MFX_SURFACE_ID (surface)));
+
+done:
+  gst_mfx_display_unref (display);
+  return surface;
+
+  /* ERRORS */
+error_invalid_layout:
+  {
+    GST_WARNING_OBJECT (plugin, "dmabuf video meta does not match caps");
+    gst_mfx_display_unref (display);
+    return NULL;
+  }
+error_import:
+  {
+    GST_WARNING_OBJECT (plugin, "failed to import dmabuf fd %d",
+        gst_dmabuf_memory_get_fd (mem));
+    gst_mfx_display_unref (display);
+    return NULL;
+  }
+}
+
+static GstBuffer *
+import_dmabuf_buffer (GstMfxPluginBase * plugin, GstBuffer * inbuf)
+{
+  GstMfxVideoMeta *meta;
+  GstMfxSurface *surface;
+  GstBuffer *outbuf;
+
+  surface = ensure_dmabuf_surface (plugin, inbuf);
+  if (!surface)
+    return NULL;
+
+  meta = gst_mfx_video_meta_new ();
+  if (!meta)
+    return NULL;
+  gst_mfx_video_meta_set_surface (meta, surface);
+
+  /* Keep the producer from recycling the buffer while it is in use */
+  outbuf = gst_buffer_new ();
+  gst_buffer_set_mfx_video_meta (outbuf, meta);
+  gst_mfx_video_meta_unref (meta);
+  gst_buffer_add_parent_buffer_meta (outbuf, inbuf);
+
+  gst_buffer_copy_into (outbuf, inbuf,
+    GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+  return outbuf;
+}
+
 /**
  * gst_mfx_plugin_base_get_input_buffer:
  * @plugin: a #GstMfxPluginBase
@@ -560,7 +806,12 @@ config_failed:
  * Acquires the sink pad (input) buffer as a VA surface backed
  * buffer. This is mostly useful for raw YUV buffers, as source
  * buffers that are already backed as a VA surface are passed
- * verbatim.
+ * verbatim, and dmabuf backed buffers are imported as VA surfaces
+ * when the sink pad operates in video memory. Raw buffers whose planes meet the SDK alignment and
+ * pitch constraints are wrapped in place, other raw buffers are
+ * copied into a surface from the sink pad buffer pool. If the subclass
+ * set sinkpad_upload_nv12, raw 4:2:0 and packed 4:2:2 input is converted
+ * to NV12 during that copy, as described by sinkpad_upload_info.
  *
  * Returns: #GST_FLOW_OK if the buffer could be acquired
  */
@@ -571,7 +822,7 @@ gst_mfx_plugin_base_get_input_buffer (GstMfxPluginBase * plugin,
   GstMfxVideoMeta *meta;
   GstBuffer *outbuf;
   GstVideoFrame src_frame, out_frame;
-  gboolean success;
+  gboolean convert, success;
 
   g_return_val_if_fail (inbuf != NULL, GST_FLOW_ERROR);
   g_return_val_if_fail (outbuf_ptr != NULL, GST_FLOW_ERROR);
@@ -582,8 +833,33 @@ gst_mfx_plugin_base_get_input_buffer (GstMfxPluginBase * plugin,
     return GST_FLOW_OK;
   }
 
-  if (!plugin->sinkpad_caps_is_raw)
-    goto error_invalid_buffer;
+  if (!plugin->sinkpad_caps_is_raw) {
+    outbuf = import_dmabuf_buffer (plugin, inbuf);
+    if (outbuf) {
+      *outbuf_ptr = outbuf;
+      return GST_FLOW_OK;
+    }
+    if (!plugin->sinkpad_has_dmabuf)
+      goto error_invalid_buffer;
+
+    /* Buffers that can not be imported, e.g. with an unsupported layout,
+     * are mapped and copied into a surface from the pool instead */
+    GST_DEBUG_OBJECT (plugin, "dmabuf import failed, copying input buffer");
+    convert = FALSE;
+  }
+  else {
+    convert = upload_needs_conversion (plugin,
+        GST_VIDEO_INFO_FORMAT (&plugin->sinkpad_info));
+
+    /* Suitably laid out system memory is handed over without a copy */
+    if (!convert) {
+      outbuf = import_input_buffer (plugin, inbuf);
+      if (outbuf) {
+        *outbuf_ptr = outbuf;
+        return GST_FLOW_OK;
+      }
+    }
+  }
 
   if (!plugin->sinkpad_buffer_pool)
     goto error_no_pool;
@@ -600,15 +876,19 @@ gst_mfx_plugin_base_get_input_buffer (GstMfxPluginBase * plugin,
         GST_MAP_READ))
     goto error_map_src_buffer;
 
-  if (!gst_video_frame_map (&out_frame, &plugin->sinkpad_info, outbuf,
-        GST_MAP_WRITE))
+  if (!gst_video_frame_map (&out_frame, convert ?
+          &plugin->sinkpad_upload_info : &plugin->sinkpad_info, outbuf,
+          GST_MAP_WRITE))
     goto error_map_dst_buffer;
 
   /* Hack for incoming video frames with changed GstVideoInfo dimensions */
   GST_VIDEO_FRAME_WIDTH (&src_frame) = GST_VIDEO_FRAME_WIDTH (&out_frame);
   GST_VIDEO_FRAME_HEIGHT (&src_frame) = GST_VIDEO_FRAME_HEIGHT (&out_frame);
 
-  success = gst_video_frame_copy (&out_frame, &src_frame);
+  if (convert)
+    success = gst_mfx_convert_frame_to_nv12 (&out_frame, &src_frame);
+  else
+    success = gst_video_frame_copy (&out_frame, &src_frame);
   gst_video_frame_unmap (&out_frame);
   gst_video_frame_unmap (&src_frame);
   if (!success)
@@ -667,6 +947,87 @@ error_copy_buffer:
 }
 
 #if GST_CHECK_VERSION(1,8,0)
+/* DMABuf export of a surface, kept for as long as the surface is pushed
+ * downstream so that the PRIME handle is only acquired once */
+typedef struct
+{
+  GstMfxSurface *surface;
+  GstMemory *mem;
+  guint n_planes;
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+} DmabufExport;
+
+static void
+dmabuf_export_free (DmabufExport * export)
+{
+  gst_memory_unref (export->mem);
+  gst_mfx_surface_unref (export->surface);
+  g_slice_free (DmabufExport, export);
+}
+
+static DmabufExport *
+dmabuf_export_new (GstMfxPluginBase * plugin, GstMfxSurface * surface)
+{
+  GstMfxPrimeBufferProxy *dmabuf_proxy;
+  DmabufExport *export;
+  GstMemory *mem;
+  gint dmabuf_fd;
+  guint i;
+
+  /* Dmabuf peers are found through the GL texture upload meta or their
+   * io-mode, neither of which carries a DRM format modifier, so they
+   * assume the implicit tiling of the buffer */
+  dmabuf_proxy = gst_mfx_prime_buffer_proxy_export_surface (surface);
+  if (!dmabuf_proxy)
+    return NULL;
+
+  if (!plugin->dmabuf_allocator)
+    plugin->dmabuf_allocator = gst_dmabuf_allocator_new ();
+
+  /* The proxy keeps ownership of its handle, the memory gets its own */
+  dmabuf_fd = gst_mfx_prime_buffer_proxy_get_handle (dmabuf_proxy);
+  if (dmabuf_fd < 0 || (dmabuf_fd = dup (dmabuf_fd)) < 0)
+    goto error_dmabuf_handle;
+
+  mem = gst_dmabuf_allocator_alloc (plugin->dmabuf_allocator, dmabuf_fd,
+      gst_mfx_prime_buffer_proxy_get_size (dmabuf_proxy));
+  if (!mem)
+    goto error_dmabuf_memory;
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+      g_quark_from_static_string ("GstMfxPrimeBufferProxy"), dmabuf_proxy,
+      (GDestroyNotify) gst_mfx_prime_buffer_proxy_unref);
+
+  export = g_slice_new (DmabufExport);
+  export->surface = gst_mfx_surface_ref (surface);
+  export->mem = mem;
+
+  export->n_planes = gst_mfx_prime_buffer_proxy_get_plane_count (dmabuf_proxy);
+  for (i = 0; i < export->n_planes; i++) {
+    export->offset[i] = gst_mfx_prime_buffer_proxy_get_offset (dmabuf_proxy, i);
+    export->stride[i] = gst_mfx_prime_buffer_proxy_get_pitch (dmabuf_proxy, i);
+  }
+
+  GST_DEBUG_OBJECT (plugin, "exported surface %" GST_MFX_ID_FORMAT
+      " as dmabuf with modifier 0x%016" G_GINT64_MODIFIER "x",
+      GST_MFX_ID_ARGS (GST_MFX_SURFACE_ID (surface)),
+      gst_mfx_prime_buffer_proxy_get_modifier (dmabuf_proxy));
+
+  return export;
+  /* ERRORS */
+error_dmabuf_memory:
+  {
+    close (dmabuf_fd);
+    // fall-through
+  }
+error_dmabuf_handle:
+  {
+    gst_mfx_prime_buffer_proxy_unref (dmabuf_proxy);
+    return NULL;
+  }
+}
+
 gboolean
 gst_mfx_plugin_base_export_dma_buffer (GstMfxPluginBase * plugin,
     GstBuffer * outbuf)
@@ -674,9 +1035,7 @@ gst_mfx_plugin_base_export_dma_buffer (GstMfxPluginBase * plugin,
   GstMfxVideoMeta *vmeta;
   GstVideoMeta *meta = gst_buffer_get_video_meta (outbuf);
   GstMfxSurface *surface;
-  GstMfxPrimeBufferProxy *dmabuf_proxy;
-  GstMemory *mem;
-  VaapiImage *image;
+  DmabufExport *export;
   GstBuffer *buf;
   guint i;
 
@@ -692,43 +1051,36 @@ gst_mfx_plugin_base_export_dma_buffer (GstMfxPluginBase * plugin,
   if (!surface || !gst_mfx_surface_has_video_memory(surface))
     return FALSE;
 
-  dmabuf_proxy = gst_mfx_prime_buffer_proxy_new_from_surface (surface);
-  if (!dmabuf_proxy)
+  /* Downstream reads the dmabuf without knowledge of the sync point */
+  if (!gst_mfx_surface_sync (surface))
     return FALSE;
 
-  if (!plugin->dmabuf_allocator)
-    plugin->dmabuf_allocator = gst_dmabuf_allocator_new ();
-
-  mem = gst_dmabuf_allocator_alloc (plugin->dmabuf_allocator,
-      gst_mfx_prime_buffer_proxy_get_handle (dmabuf_proxy),
-      gst_mfx_prime_buffer_proxy_get_size (dmabuf_proxy));
-  if (!mem)
-    goto error_dmabuf_handle;
+  if (!plugin->dmabuf_exports)
+    plugin->dmabuf_exports = g_hash_table_new_full (NULL, NULL, NULL,
+        (GDestroyNotify) dmabuf_export_free);
 
-  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
-      g_quark_from_static_string ("GstMfxPrimeBufferProxy"), dmabuf_proxy,
-      (GDestroyNotify) gst_mfx_prime_buffer_proxy_unref);
+  export = g_hash_table_lookup (plugin->dmabuf_exports, surface);
+  if (!export) {
+    export = dmabuf_export_new (plugin, surface);
+    if (!export)
+      return FALSE;
+    g_hash_table_insert (plugin->dmabuf_exports, surface, export);
+  }
 
-  buf = gst_buffer_copy(outbuf);
-  gst_buffer_prepend_memory (buf, gst_buffer_get_memory (outbuf, 0));
+  /* Keep the surface backed memory reachable from the parent buffer */
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, gst_buffer_get_memory (outbuf, 0));
   gst_buffer_add_parent_buffer_meta (outbuf, buf);
-  gst_buffer_replace_memory (outbuf, 0, mem);
+  gst_buffer_replace_memory (outbuf, 0, gst_memory_ref (export->mem));
 
   gst_buffer_unref (buf);
 
-  image = gst_mfx_prime_buffer_proxy_get_vaapi_image (dmabuf_proxy);
-  for (i = 0; i < vaapi_image_get_plane_count (image); i++) {
-    meta->offset[i] = vaapi_image_get_offset (image, i);
-    meta->stride[i] = vaapi_image_get_pitch (image, i);
+  if (meta) {
+    for (i = 0; i < export->n_planes; i++) {
+      meta->offset[i] = export->offset[i];
+      meta->stride[i] = export->stride[i];
+    }
   }
-
-  vaapi_image_unref(image);
   return TRUE;
-  /* ERRORS */
-error_dmabuf_handle:
-  {
-    gst_mfx_prime_buffer_proxy_unref (dmabuf_proxy);
-    return FALSE;
-  }
 }
 #endif
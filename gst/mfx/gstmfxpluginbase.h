@@ -111,6 +111,9 @@ struct _GstMfxPluginBase
   GstVideoInfo          sinkpad_info;
   GstBufferPool        *sinkpad_buffer_pool;
   guint                 sinkpad_buffer_size;
+  /* Set by subclasses to convert raw input to NV12 while uploading it */
+  gboolean              sinkpad_upload_nv12;
+  GstVideoInfo          sinkpad_upload_info;
 
   GstPad               *srcpad;
   GstCaps              *srcpad_caps;
@@ -125,6 +128,7 @@ struct _GstMfxPluginBase
   gboolean              sinkpad_has_dmabuf;
   gboolean              srcpad_has_dmabuf;
   GstAllocator         *dmabuf_allocator;
+  GHashTable           *dmabuf_exports;
 
   gboolean              need_linear_dmabuf;
 
@@ -421,3 +421,96 @@ gst_video_info_change_format (GstVideoInfo * vip, GstVideoFormat format,
   vip->fps_n = vi.fps_n;
   vip->fps_d = vi.fps_d;
 }
+
+/* Upper bound on the NAL units tracked for an in-place conversion, beyond
+ * which the caller falls back to copying the buffer */
+#define MAX_IN_PLACE_NALS 256
+
+/* Rewrites the Annex B byte-stream held in @buffer as 4-byte length
+ * prefixed NAL units, keeping only the NAL units which follow a 3-byte
+ * start code as MSDK uses those to start the units of an encoded picture.
+ *
+ * Each kept NAL unit grows by one byte, so the result is laid out at the
+ * end of the buffer memory, using the room left after the coded data, and
+ * the units are moved from last to first so that no unread data gets
+ * overwritten. Returns FALSE with @buffer untouched if its memory cannot
+ * be written to or does not have enough room */
+gboolean
+gst_mfx_byte_stream_to_length_prefixed_in_place (GstBuffer * buffer,
+    GstMfxNalParseFunc next_nal)
+{
+  struct
+  {
+    gsize offset;
+    guint32 size;
+  } nals[MAX_IN_PLACE_NALS];
+  GstMemory *mem;
+  GstMapInfo info;
+  guint8 *nal_start_code, *nal_body, *frame_end;
+  guint32 nal_size = 0;
+  gsize out_size = 0, out_pos;
+  guint i, num_nals = 0;
+
+  g_return_val_if_fail (buffer != NULL, FALSE);
+  g_return_val_if_fail (next_nal != NULL, FALSE);
+
+  if (gst_buffer_n_memory (buffer) != 1 || !gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_memory_is_writable (mem)
+      || !gst_memory_map (mem, &info, GST_MAP_READWRITE))
+    return FALSE;
+
+  nal_start_code = info.data;
+  frame_end = info.data + info.size;
+
+  while ((frame_end > nal_start_code) &&
+      (nal_body = next_nal (nal_start_code,
+              frame_end - nal_start_code, &nal_size)) != NULL) {
+    if (!nal_size)
+      goto error;
+
+    if (nal_body - nal_start_code == 3) {
+      if (num_nals == G_N_ELEMENTS (nals))
+        goto error;
+      nals[num_nals].offset = nal_body - info.data;
+      nals[num_nals].size = nal_size;
+      out_size += nal_size + 4;
+      num_nals++;
+    }
+    nal_start_code = nal_body + nal_size;
+  }
+
+  if (!num_nals) {
+    gst_memory_unmap (mem, &info);
+    return TRUE;
+  }
+  if (out_size > info.maxsize)
+    goto error;
+
+  /* A unit may only land past the start code it replaces, otherwise its
+   * length prefix would overwrite the end of the previous unit */
+  out_pos = info.maxsize;
+  for (i = num_nals; i > 0; i--) {
+    out_pos -= nals[i - 1].size + 4;
+    if (out_pos + 3 < nals[i - 1].offset)
+      goto error;
+  }
+
+  out_pos = info.maxsize;
+  for (i = num_nals; i > 0; i--) {
+    out_pos -= nals[i - 1].size + 4;
+    memmove (info.data + out_pos + 4, info.data + nals[i - 1].offset,
+        nals[i - 1].size);
+    GST_WRITE_UINT32_BE (info.data + out_pos, nals[i - 1].size);
+  }
+  gst_memory_unmap (mem, &info);
+
+  gst_buffer_resize (buffer, out_pos, out_size);
+  return TRUE;
+
+error:
+  gst_memory_unmap (mem, &info);
+  return FALSE;
+}
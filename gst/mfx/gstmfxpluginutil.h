@@ -96,4 +96,12 @@ void
 gst_video_info_change_format(GstVideoInfo * vip, GstVideoFormat format,
     guint width, guint height);
 
+/* Helpers to repackage encoded H.264 / H.265 byte-streams */
+typedef guint8 *(*GstMfxNalParseFunc) (guint8 * buffer, gint32 len,
+    guint32 * nal_size);
+
+gboolean
+gst_mfx_byte_stream_to_length_prefixed_in_place (GstBuffer * buffer,
+    GstMfxNalParseFunc next_nal);
+
 #endif /* GST_MFX_PLUGIN_UTIL_H */
@@ -91,14 +91,21 @@ enum
   PROP_BRIGHTNESS,
   PROP_CONTRAST,
   PROP_ROTATION,
+  PROP_SCALING_MODE,
+  PROP_INTERPOLATION_METHOD,
   PROP_FRAMERATE,
   PROP_FRC_ALGORITHM,
+  PROP_MEMORY_ALIGNMENT,
+  PROP_MEMORY_HUGEPAGES,
+  PROP_MEMORY_NUMA_NODE,
 };
 
 #define DEFAULT_ASYNC_DEPTH             0
 #define DEFAULT_FORMAT                  GST_VIDEO_FORMAT_NV12
 #define DEFAULT_DEINTERLACE_MODE        GST_MFX_DEINTERLACE_MODE_BOB
 #define DEFAULT_ROTATION                GST_MFX_ROTATION_0
+#define DEFAULT_SCALING_MODE            GST_MFX_SCALING_MODE_DEFAULT
+#define DEFAULT_INTERPOLATION_METHOD    GST_MFX_INTERPOLATION_DEFAULT
 #define DEFAULT_FRC_ALG                 GST_MFX_FRC_NONE
 #define DEFAULT_BRIGHTNESS              0.0
 #define DEFAULT_SATURATION              1.0
@@ -183,6 +190,57 @@ gst_mfx_frc_algorithm_get_type (void)
   return alg;
 }
 
+GType
+gst_mfx_scaling_mode_get_type (void)
+{
+  static volatile gsize g_type = 0;
+
+  static const GEnumValue scaling_modes[] = {
+    {GST_MFX_SCALING_MODE_DEFAULT,
+        "Let the implementation choose the scaler", "auto"},
+#if MSDK_CHECK_VERSION(1,19)
+    {GST_MFX_SCALING_MODE_LOWPOWER,
+        "Fixed function scaler for throughput", "lowpower"},
+    {GST_MFX_SCALING_MODE_QUALITY,
+        "EU based scaler for quality", "quality"},
+#endif // MSDK_CHECK_VERSION
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&g_type)) {
+    GType type = g_enum_register_static ("GstMfxScalingMode", scaling_modes);
+    g_once_init_leave (&g_type, type);
+  }
+  return g_type;
+}
+
+GType
+gst_mfx_interpolation_method_get_type (void)
+{
+  static volatile gsize g_type = 0;
+
+  static const GEnumValue methods[] = {
+    {GST_MFX_INTERPOLATION_DEFAULT,
+        "Let the implementation choose the interpolation", "auto"},
+#if MSDK_CHECK_VERSION(1,33)
+    {GST_MFX_INTERPOLATION_NEAREST_NEIGHBOR,
+        "Nearest neighbor interpolation", "nearest"},
+    {GST_MFX_INTERPOLATION_BILINEAR,
+        "Bilinear interpolation", "bilinear"},
+    {GST_MFX_INTERPOLATION_ADVANCED,
+        "Advanced multi-tap interpolation", "advanced"},
+#endif // MSDK_CHECK_VERSION
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&g_type)) {
+    GType type = g_enum_register_static ("GstMfxInterpolationMethod",
+        methods);
+    g_once_init_leave (&g_type, type);
+  }
+  return g_type;
+}
+
 
 /* ------------------------------------------------------------------------ */
 /* --- GstColorBalance implementation                                   --- */
@@ -444,6 +502,8 @@ gst_mfxpostproc_ensure_filter (GstMfxPostproc * vpp)
   if (!vpp->filter)
     return FALSE;
 
+  gst_mfx_filter_set_system_memory_params (vpp->filter, &vpp->sysmem_params);
+
   if (plugin->srcpad_caps_is_raw)
     gst_mfx_task_aggregator_update_peer_memtypes (plugin->aggregator, TRUE);
 
@@ -587,7 +647,17 @@ gst_mfxpostproc_before_transform (GstBaseTransform * trans,
       gst_mfx_filter_set_hue(vpp->filter, vpp->hue);
     if (vpp->cb_changed & GST_MFX_POSTPROC_FLAG_BRIGHTNESS)
       gst_mfx_filter_set_brightness(vpp->filter, vpp->brightness);
-    gst_mfx_filter_reset(vpp->filter);
+    if (vpp->cb_changed & GST_MFX_POSTPROC_FLAG_DENOISE)
+      gst_mfx_filter_set_denoising_level(vpp->filter, vpp->denoise_level);
+    if (vpp->cb_changed & GST_MFX_POSTPROC_FLAG_DETAIL)
+      gst_mfx_filter_set_detail_level(vpp->filter, vpp->detail_level);
+    if (vpp->cb_changed & GST_MFX_POSTPROC_FLAG_SCALING) {
+      gst_mfx_filter_set_scaling_mode(vpp->filter, vpp->scaling_mode);
+      gst_mfx_filter_set_interpolation_method(vpp->filter,
+          vpp->interpolation);
+    }
+    /* Applied at the next frame boundary unless the VPP needs a reset */
+    gst_mfx_filter_update(vpp->filter);
     vpp->cb_changed = 0;
   }
 }
@@ -911,6 +981,9 @@ gst_mfxpostproc_create (GstMfxPostproc * vpp)
   if (vpp->flags & GST_MFX_POSTPROC_FLAG_DEINTERLACING)
     gst_mfx_filter_set_deinterlace_mode (vpp->filter, vpp->deinterlace_mode);
 
+  gst_mfx_filter_set_scaling_mode (vpp->filter, vpp->scaling_mode);
+  gst_mfx_filter_set_interpolation_method (vpp->filter, vpp->interpolation);
+
   if (vpp->flags & GST_MFX_POSTPROC_FLAG_FRC) {
     gst_mfx_filter_set_frc_algorithm (vpp->filter, vpp->alg);
     gst_mfx_filter_set_framerate (vpp->filter, vpp->fps_n, vpp->fps_d);
@@ -1017,12 +1090,18 @@ gst_mfxpostproc_set_property (GObject * object,
       vpp->flags |= GST_MFX_POSTPROC_FLAG_DEINTERLACING;
       break;
     case PROP_DENOISE:
-      vpp->denoise_level = g_value_get_uint (value);
-      vpp->flags |= GST_MFX_POSTPROC_FLAG_DENOISE;
+      if (vpp->denoise_level != g_value_get_uint (value)) {
+        vpp->denoise_level = g_value_get_uint (value);
+        vpp->flags |= GST_MFX_POSTPROC_FLAG_DENOISE;
+        vpp->cb_changed |= GST_MFX_POSTPROC_FLAG_DENOISE;
+      }
       break;
     case PROP_DETAIL:
-      vpp->detail_level = g_value_get_uint (value);
-      vpp->flags |= GST_MFX_POSTPROC_FLAG_DETAIL;
+      if (vpp->detail_level != g_value_get_uint (value)) {
+        vpp->detail_level = g_value_get_uint (value);
+        vpp->flags |= GST_MFX_POSTPROC_FLAG_DETAIL;
+        vpp->cb_changed |= GST_MFX_POSTPROC_FLAG_DETAIL;
+      }
       break;
     case PROP_HUE:
       if (vpp->hue != g_value_get_float (value)) {
@@ -1056,6 +1135,18 @@ gst_mfxpostproc_set_property (GObject * object,
       vpp->angle = g_value_get_enum (value);
       vpp->flags |= GST_MFX_POSTPROC_FLAG_ROTATION;
       break;
+    case PROP_SCALING_MODE:
+      if (vpp->scaling_mode != g_value_get_enum (value)) {
+        vpp->scaling_mode = g_value_get_enum (value);
+        vpp->cb_changed |= GST_MFX_POSTPROC_FLAG_SCALING;
+      }
+      break;
+    case PROP_INTERPOLATION_METHOD:
+      if (vpp->interpolation != g_value_get_enum (value)) {
+        vpp->interpolation = g_value_get_enum (value);
+        vpp->cb_changed |= GST_MFX_POSTPROC_FLAG_SCALING;
+      }
+      break;
     case PROP_FRAMERATE:
       vpp->fps_n = gst_value_get_fraction_numerator (value);
       vpp->fps_d = gst_value_get_fraction_denominator (value);
@@ -1063,6 +1154,15 @@ gst_mfxpostproc_set_property (GObject * object,
     case PROP_FRC_ALGORITHM:
       vpp->alg = g_value_get_enum (value);
       break;
+    case PROP_MEMORY_ALIGNMENT:
+      vpp->sysmem_params.alignment = g_value_get_uint (value);
+      break;
+    case PROP_MEMORY_HUGEPAGES:
+      vpp->sysmem_params.use_hugepages = g_value_get_boolean (value);
+      break;
+    case PROP_MEMORY_NUMA_NODE:
+      vpp->sysmem_params.numa_node = g_value_get_int (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1116,6 +1216,12 @@ gst_mfxpostproc_get_property (GObject * object,
     case PROP_ROTATION:
       g_value_set_enum (value, vpp->angle);
       break;
+    case PROP_SCALING_MODE:
+      g_value_set_enum (value, vpp->scaling_mode);
+      break;
+    case PROP_INTERPOLATION_METHOD:
+      g_value_set_enum (value, vpp->interpolation);
+      break;
     case PROP_FRAMERATE:
       if (vpp->fps_n && vpp->fps_d)
         gst_value_set_fraction (value, vpp->fps_n, vpp->fps_d);
@@ -1123,6 +1229,15 @@ gst_mfxpostproc_get_property (GObject * object,
     case PROP_FRC_ALGORITHM:
       g_value_set_enum (value, vpp->alg);
       break;
+    case PROP_MEMORY_ALIGNMENT:
+      g_value_set_uint (value, vpp->sysmem_params.alignment);
+      break;
+    case PROP_MEMORY_HUGEPAGES:
+      g_value_set_boolean (value, vpp->sysmem_params.use_hugepages);
+      break;
+    case PROP_MEMORY_NUMA_NODE:
+      g_value_set_int (value, vpp->sysmem_params.numa_node);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1261,7 +1376,8 @@ gst_mfxpostproc_class_init (GstMfxPostprocClass * klass)
       g_param_spec_uint ("denoise",
           "Denoising Level",
           "The level of denoising to apply",
-          0, 100, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          0, 100, 0, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstMfxPostproc:detail
@@ -1273,7 +1389,8 @@ gst_mfxpostproc_class_init (GstMfxPostprocClass * klass)
       g_param_spec_uint ("detail",
           "Detail Level",
           "The level of detail / edge enhancement to apply",
-          0, 100, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+          0, 100, 0, GST_PARAM_CONTROLLABLE |
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstMfxPostproc:hue
@@ -1346,6 +1463,36 @@ gst_mfxpostproc_class_init (GstMfxPostprocClass * klass)
           DEFAULT_ROTATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 #endif
 
+  /**
+   * GstMfxPostproc:scaling-mode
+   *
+   * The scaler used for resizing, trading quality against throughput
+   * and power, expressed in GstMfxScalingMode.
+   */
+  g_object_class_install_property (object_class,
+      PROP_SCALING_MODE,
+      g_param_spec_enum ("scaling-mode",
+          "Scaling mode",
+          "The scaler used for resizing",
+          GST_MFX_TYPE_SCALING_MODE,
+          DEFAULT_SCALING_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxPostproc:interpolation-method
+   *
+   * The interpolation method of the scaler, expressed in
+   * GstMfxInterpolationMethod. Only the software implementation honors
+   * it; the hardware scalers are selected with #GstMfxPostproc:scaling-mode.
+   */
+  g_object_class_install_property (object_class,
+      PROP_INTERPOLATION_METHOD,
+      g_param_spec_enum ("interpolation-method",
+          "Interpolation method",
+          "The interpolation method of the scaler",
+          GST_MFX_TYPE_INTERPOLATION_METHOD,
+          DEFAULT_INTERPOLATION_METHOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstMfxPostproc: frc-algorithm
    * The framerate conversion algorithm to convert framerate of the video,
@@ -1358,6 +1505,40 @@ gst_mfxpostproc_class_init (GstMfxPostprocClass * klass)
           "The algorithm type",
           GST_MFX_TYPE_FRC_ALGORITHM,
           DEFAULT_FRC_ALG, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxPostproc:memory-alignment
+   *
+   * The alignment in bytes of the VPP output surfaces in system memory,
+   * rounded up to the next power of two.
+   */
+  g_object_class_install_property (object_class,
+      PROP_MEMORY_ALIGNMENT,
+      g_param_spec_uint ("memory-alignment", "Memory alignment",
+          "Alignment in bytes of system memory surfaces (0 = default)",
+          0, 4096, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxPostproc:memory-hugepages
+   *
+   * Back the VPP output surfaces in system memory with huge pages.
+   */
+  g_object_class_install_property (object_class,
+      PROP_MEMORY_HUGEPAGES,
+      g_param_spec_boolean ("memory-hugepages", "Huge pages",
+          "Back system memory surfaces with huge pages",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxPostproc:memory-numa-node
+   *
+   * The NUMA node to bind the VPP output surfaces in system memory to.
+   */
+  g_object_class_install_property (object_class,
+      PROP_MEMORY_NUMA_NODE,
+      g_param_spec_int ("memory-numa-node", "NUMA node",
+          "NUMA node to bind system memory surfaces to (-1 = none)",
+          -1, 63, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -1366,8 +1547,11 @@ gst_mfxpostproc_init (GstMfxPostproc * vpp)
   gst_mfx_plugin_base_init (GST_MFX_PLUGIN_BASE (vpp), GST_CAT_DEFAULT);
 
   vpp->async_depth = DEFAULT_ASYNC_DEPTH;
+  vpp->sysmem_params.numa_node = -1;
   vpp->format = DEFAULT_FORMAT;
   vpp->deinterlace_mode = DEFAULT_DEINTERLACE_MODE;
+  vpp->scaling_mode = DEFAULT_SCALING_MODE;
+  vpp->interpolation = DEFAULT_INTERPOLATION_METHOD;
   vpp->keep_aspect = TRUE;
   vpp->alg = DEFAULT_FRC_ALG;
   vpp->brightness = DEFAULT_BRIGHTNESS;
@@ -64,6 +64,7 @@ typedef struct _GstMfxPostprocClass GstMfxPostprocClass;
 * @GST_MFX_POSTPROC_FLAG_DEINTERLACE: Deinterlacing.
 * @GST_MFX_POSTPROC_FLAG_ROTATION: Rotation.
 * @GST_MFX_POSTPROC_FLAG_SIZE: Video scaling.
+* @GST_MFX_POSTPROC_FLAG_SCALING: Scaler configuration.
 *
 * The set of operations that are to be performed for each frame.
 */
@@ -82,6 +83,7 @@ typedef enum
   /* Additional custom flags */
   GST_MFX_POSTPROC_FLAG_CUSTOM = 1 << 20,
   GST_MFX_POSTPROC_FLAG_SIZE = GST_MFX_POSTPROC_FLAG_CUSTOM,
+  GST_MFX_POSTPROC_FLAG_SCALING = GST_MFX_POSTPROC_FLAG_CUSTOM << 1,
 } GstMfxPostprocFlags;
 
 
@@ -97,6 +99,7 @@ struct _GstMfxPostproc
   guint                   height;
   guint                   flags;
   guint                   async_depth;
+  GstMfxSystemMemoryParams sysmem_params;
 
   GstCaps                *allowed_sinkpad_caps;
   GstVideoInfo            sinkpad_info;
@@ -128,6 +131,10 @@ struct _GstMfxPostproc
   /* Rotation angle */
   GstMfxRotation          angle;
 
+  /* Scaler */
+  GstMfxScalingMode       scaling_mode;
+  GstMfxInterpolationMethod interpolation;
+
   guint                   keep_aspect : 1;
 };
 
@@ -895,6 +895,7 @@ gst_mfxsink_stop (GstBaseSink * base_sink)
     gst_mfx_display_replace (&sink->display, NULL);
   }
 
+  gst_mfx_surface_composition_replace (&sink->composition, NULL);
   gst_mfx_composite_filter_replace (&sink->composite_filter, NULL);
   gst_mfx_display_replace (&sink->drm_display, NULL);
 
@@ -1012,7 +1013,7 @@ gst_mfxsink_show_frame (GstVideoSink * video_sink, GstBuffer * src_buffer)
   GstMfxSink *const sink = GST_MFXSINK_CAST (video_sink);
   GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (sink);
   GstMfxVideoMeta *meta;
-  GstMfxSurface *surface, *composite_surface = NULL;
+  GstMfxSurface *surface, *render_surface, *composite_surface = NULL;
   GstMfxRectangle *surface_rect = NULL;
   GstFlowReturn ret;
 
@@ -1046,7 +1047,10 @@ gst_mfxsink_show_frame (GstVideoSink * video_sink, GstBuffer * src_buffer)
         gst_mfx_composite_filter_new (plugin->aggregator,
             !gst_mfx_surface_has_video_memory (surface));
 
-    composition = gst_mfx_surface_composition_new (surface, overlay);
+    /* Unchanged overlay rectangles reuse the surfaces uploaded for the
+     * previous frame */
+    composition = gst_mfx_surface_composition_new (surface, overlay,
+        sink->composition);
     if (!composition) {
       GST_ERROR("Failed to create new surface composition");
       goto error;
@@ -1054,15 +1058,23 @@ gst_mfxsink_show_frame (GstVideoSink * video_sink, GstBuffer * src_buffer)
 
     gst_mfx_composite_filter_apply_composition (sink->composite_filter,
         composition, &composite_surface);
+    gst_mfx_surface_composition_replace (&sink->composition, composition);
   }
+  else {
+    gst_mfx_surface_composition_replace (&sink->composition, NULL);
+  }
+
+  render_surface = composite_surface ? composite_surface : surface;
 
-  if (!gst_mfxsink_render_surface (sink,
-        composite_surface ? composite_surface : surface, surface_rect))
+  /* The display reads the surface outside of the MFX sessions */
+  if (!gst_mfx_surface_sync (render_surface)
+      || !gst_mfxsink_render_surface (sink, render_surface, surface_rect))
     goto error;
 
   gst_mfx_surface_dequeue(surface);
   ret = GST_FLOW_OK;
 done:
+  gst_mfx_surface_replace (&composite_surface, NULL);
   gst_mfx_surface_composition_replace (&composition, NULL);
   gst_mfxsink_unlock (sink);
   return ret;
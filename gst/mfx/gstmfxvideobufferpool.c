@@ -40,8 +40,13 @@ struct _GstMfxVideoBufferPoolPrivate
   GstMfxDisplay *display;
   guint has_video_meta:1;
   guint use_dmabuf_memory:1;
+  guint bind_surfaces:1;
   gboolean memtype_is_system;
   gboolean is_untiled;
+
+  /* Bound surfaces detached from their buffer while still locked by the
+   * SDK, kept alive until it is done with them */
+  GList *busy_surfaces;
 };
 
 #define GST_MFX_VIDEO_BUFFER_POOL_GET_PRIVATE(obj) \
@@ -56,6 +61,8 @@ gst_mfx_video_buffer_pool_finalize (GObject * object)
 
   gst_mfx_display_unref (priv->display);
   g_clear_object (&priv->allocator);
+  g_list_free_full (priv->busy_surfaces,
+      (GDestroyNotify) gst_mfx_surface_unref);
 
   G_OBJECT_CLASS (gst_mfx_video_buffer_pool_parent_class)->finalize (object);
 }
@@ -66,6 +73,7 @@ gst_mfx_video_buffer_pool_get_options (GstBufferPool * pool)
   static const gchar *g_options[] = {
     GST_BUFFER_POOL_OPTION_VIDEO_META,
     GST_BUFFER_POOL_OPTION_MFX_VIDEO_META,
+    GST_BUFFER_POOL_OPTION_MFX_BOUND_SURFACE,
     GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT,
     NULL,
   };
@@ -125,6 +133,8 @@ gst_mfx_video_buffer_pool_set_config (GstBufferPool * pool,
 
   priv->has_video_meta = gst_buffer_pool_config_has_option (config,
       GST_BUFFER_POOL_OPTION_VIDEO_META);
+  priv->bind_surfaces = gst_buffer_pool_config_has_option (config,
+      GST_BUFFER_POOL_OPTION_MFX_BOUND_SURFACE);
 
   return
       GST_BUFFER_POOL_CLASS
@@ -188,6 +198,13 @@ gst_mfx_video_buffer_pool_alloc_buffer (GstBufferPool * pool,
   if (!mem)
     goto error_create_memory;
 
+  /* DMABuf memory is always created along with its surface */
+  if (priv->bind_surfaces && GST_MFX_IS_VIDEO_MEMORY (mem)
+      && !gst_mfx_video_memory_bind_surface (GST_MFX_VIDEO_MEMORY_CAST (mem))) {
+    gst_memory_unref (mem);
+    goto error_create_memory;
+  }
+
   gst_mfx_video_meta_replace (&meta, NULL);
   gst_buffer_append_memory (buffer, mem);
 
@@ -236,15 +253,58 @@ error_create_memory:
   }
 }
 
+static gboolean
+surface_is_busy (GstMfxSurface * surface)
+{
+  return gst_mfx_surface_get_frame_surface (surface)->Data.Locked > 0;
+}
+
+/* Keeps a reference on a bound surface that is still locked by the SDK,
+ * as it is no longer tracked by the surface pool, and drops the ones the
+ * SDK is done with */
+static void
+retire_busy_surface (GstMfxVideoBufferPool * pool, GstMfxSurface * surface)
+{
+  GstMfxVideoBufferPoolPrivate *const priv = pool->priv;
+  GList *l, *next, *idle = NULL;
+
+  GST_OBJECT_LOCK (pool);
+  for (l = priv->busy_surfaces; l; l = next) {
+    next = l->next;
+    if (!surface_is_busy (l->data)) {
+      priv->busy_surfaces = g_list_remove_link (priv->busy_surfaces, l);
+      idle = g_list_concat (l, idle);
+    }
+  }
+  if (surface)
+    priv->busy_surfaces = g_list_prepend (priv->busy_surfaces,
+        gst_mfx_surface_ref (surface));
+  GST_OBJECT_UNLOCK (pool);
+
+  g_list_free_full (idle, (GDestroyNotify) gst_mfx_surface_unref);
+}
+
 static void
 gst_mfx_video_buffer_pool_reset_buffer (GstBufferPool * pool,
     GstBuffer * buffer)
 {
+  GstMfxVideoBufferPoolPrivate *const priv =
+      GST_MFX_VIDEO_BUFFER_POOL (pool)->priv;
   GstMemory *const mem = gst_buffer_peek_memory (buffer, 0);
 
-  /* Release the underlying surface surface */
-  if (GST_MFX_IS_VIDEO_MEMORY (mem))
-    gst_mfx_video_memory_reset_surface (GST_MFX_VIDEO_MEMORY_CAST (mem));
+  /* Release the underlying surface, unless it is bound to the buffer and
+   * can be reused as is. A busy bound surface is replaced on next use */
+  if (GST_MFX_IS_VIDEO_MEMORY (mem)) {
+    GstMfxVideoMemory *const vmem = GST_MFX_VIDEO_MEMORY_CAST (mem);
+
+    if (!priv->bind_surfaces)
+      gst_mfx_video_memory_reset_surface (vmem);
+    else if (gst_mfx_video_memory_is_surface_busy (vmem)) {
+      retire_busy_surface (GST_MFX_VIDEO_BUFFER_POOL (pool),
+          gst_mfx_video_meta_get_surface (vmem->meta));
+      gst_mfx_video_memory_reset_surface (vmem);
+    }
+  }
 
   GST_BUFFER_POOL_CLASS (gst_mfx_video_buffer_pool_parent_class)->reset_buffer
       (pool, buffer);
@@ -51,6 +51,16 @@ typedef struct _GstMfxVideoBufferPoolPrivate    GstMfxVideoBufferPoolPrivate;
 #define GST_BUFFER_POOL_OPTION_MFX_VIDEO_META \
   "GstBufferPoolOptionMfxVideoMeta"
 
+/**
+ * GST_BUFFER_POOL_OPTION_MFX_BOUND_SURFACE:
+ *
+ * Binds a surface to each buffer of the pool when the buffer is
+ * allocated, instead of attaching one on first use and releasing it
+ * whenever the buffer returns to the pool.
+ */
+#define GST_BUFFER_POOL_OPTION_MFX_BOUND_SURFACE \
+  "GstBufferPoolOptionMfxBoundSurface"
+
 #ifndef GST_BUFFER_POOL_OPTION_DMABUF_MEMORY
 #define GST_BUFFER_POOL_OPTION_DMABUF_MEMORY \
   "GstBufferPoolOptionDMABUFMemory"
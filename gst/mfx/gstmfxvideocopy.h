@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2017 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFX_VIDEO_COPY_H
+#define GST_MFX_VIDEO_COPY_H
+
+/* Copy kernels of the surface downloads in gstmfxvideomemory.c. They only
+ * depend on GLib so that benchmarks/surface-download.c can build them */
+
+#include <string.h>
+#include <glib.h>
+
+/* Size of the cacheable bounce buffer used by streaming loads */
+#define STREAM_BOUNCE_SIZE 4096
+
+typedef void (*CopyFunc) (guint8 * dst, const guint8 * src, gsize size);
+
+static void
+copy_memcpy (guint8 * dst, const guint8 * src, gsize size)
+{
+  memcpy (dst, src, size);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define HAVE_STREAM_COPY 1
+# include <smmintrin.h>
+
+/* Reads uncacheable, write-combined memory (i.e. mapped VA surfaces) with
+ * MOVNTDQA streaming loads, which fetch whole cache lines at once instead
+ * of one uncached access per load. The data goes through a small bounce
+ * buffer that stays in the cache before being written to @dst */
+__attribute__ ((target ("sse4.1")))
+static void
+copy_stream_sse41 (guint8 * dst, const guint8 * src, gsize size)
+{
+  __m128i bounce[STREAM_BOUNCE_SIZE / sizeof (__m128i)];
+  gsize head, chunk, i;
+
+  head = MIN ((16 - ((guintptr) src & 15)) & 15, size);
+  memcpy (dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+
+  while (size >= 16) {
+    chunk = MIN (size & ~(gsize) 15, STREAM_BOUNCE_SIZE);
+    for (i = 0; i < chunk / 16; i++)
+      bounce[i] = _mm_stream_load_si128 ((__m128i *) src + i);
+    memcpy (dst, bounce, chunk);
+    dst += chunk;
+    src += chunk;
+    size -= chunk;
+  }
+
+  memcpy (dst, src, size);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void
+copy_stream_fence (void)
+{
+  /* Make sure the device writes are visible to the streaming loads */
+  _mm_mfence ();
+}
+#else
+static void
+copy_stream_fence (void)
+{
+}
+#endif
+
+#endif /* GST_MFX_VIDEO_COPY_H */
@@ -21,29 +21,224 @@
  */
 
 #include "gstmfxvideomemory.h"
+#include "gstmfxvideocopy.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_debug_mfxvideomemory);
 #define GST_CAT_DEFAULT gst_debug_mfxvideomemory
 
+/* Planes larger than this are downloaded by several threads */
+#define COPY_THREAD_MIN_SIZE (4 * 1024 * 1024)
+#define COPY_MAX_THREADS 4
+
+typedef struct
+{
+  CopyFunc func;
+  guint8 *dst;
+  const guint8 *src;
+  guint dst_stride;
+  guint src_stride;
+  guint row_size;
+  guint rows;
+} CopyRegion;
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint pending;
+} CopyJobs;
+
+typedef struct
+{
+  CopyRegion region;
+  CopyJobs *jobs;
+} CopyJob;
+
+#ifdef HAVE_STREAM_COPY
+static gpointer
+select_stream_copy (gpointer data)
+{
+  __builtin_cpu_init ();
+  if (!__builtin_cpu_supports ("sse4.1"))
+    return NULL;
+  GST_INFO ("using SSE4.1 streaming loads for surface downloads");
+  return copy_stream_sse41;
+}
+#else
+static gpointer
+select_stream_copy (gpointer data)
+{
+  return NULL;
+}
+#endif
+
+static CopyFunc
+get_stream_copy_func (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, select_stream_copy, NULL);
+  return (CopyFunc) once.retval;
+}
+
+static void
+copy_region (const CopyRegion * region)
+{
+  const guint8 *src = region->src;
+  guint8 *dst = region->dst;
+  guint i;
+
+  if (region->src_stride == region->dst_stride
+      && region->row_size == region->dst_stride) {
+    region->func (dst, src, (gsize) region->dst_stride * region->rows);
+    return;
+  }
+
+  for (i = 0; i < region->rows; i++) {
+    region->func (dst, src, region->row_size);
+    src += region->src_stride;
+    dst += region->dst_stride;
+  }
+}
+
+static void
+copy_job_func (gpointer data, gpointer user_data)
+{
+  CopyJob *const job = data;
+  CopyJobs *const jobs = job->jobs;
+
+  copy_region (&job->region);
+
+  g_mutex_lock (&jobs->lock);
+  if (--jobs->pending == 0)
+    g_cond_signal (&jobs->cond);
+  g_mutex_unlock (&jobs->lock);
+}
+
+static GThreadPool *
+get_copy_thread_pool (void)
+{
+  static GThreadPool *pool;
+  static gsize g_pool_init = FALSE;
+
+  if (g_once_init_enter (&g_pool_init)) {
+    guint n_threads = MIN (g_get_num_processors (), COPY_MAX_THREADS);
+
+    if (n_threads > 1)
+      pool = g_thread_pool_new (copy_job_func, NULL, n_threads - 1,
+          FALSE, NULL);
+    g_once_init_leave (&g_pool_init, TRUE);
+  }
+  return pool;
+}
+
+/* Splits large planes in bands of rows, the calling thread copies the
+ * first band itself while the other ones are handled by the pool */
+static void
+copy_plane (const CopyRegion * region)
+{
+  GThreadPool *const pool = get_copy_thread_pool ();
+  CopyJob job[COPY_MAX_THREADS];
+  CopyJobs jobs;
+  guint i, n_jobs, rows_per_job;
+
+  if (!pool || (gsize) region->row_size * region->rows < COPY_THREAD_MIN_SIZE) {
+    copy_region (region);
+    return;
+  }
+
+  n_jobs = g_thread_pool_get_max_threads (pool) + 1;
+  rows_per_job = (region->rows + n_jobs - 1) / n_jobs;
+
+  g_mutex_init (&jobs.lock);
+  g_cond_init (&jobs.cond);
+  jobs.pending = n_jobs - 1;
+
+  for (i = 0; i < n_jobs; i++) {
+    guint first_row = i * rows_per_job;
+
+    job[i].region = *region;
+    job[i].region.src += (gsize) first_row * region->src_stride;
+    job[i].region.dst += (gsize) first_row * region->dst_stride;
+    job[i].region.rows = first_row < region->rows ?
+        MIN (rows_per_job, region->rows - first_row) : 0;
+    job[i].jobs = &jobs;
+    if (i > 0)
+      g_thread_pool_push (pool, &job[i], NULL);
+  }
+
+  copy_region (&job[0].region);
+
+  g_mutex_lock (&jobs.lock);
+  while (jobs.pending > 0)
+    g_cond_wait (&jobs.cond, &jobs.lock);
+  g_mutex_unlock (&jobs.lock);
+
+  g_cond_clear (&jobs.cond);
+  g_mutex_clear (&jobs.lock);
+}
+
+/* Number of staging buffers kept around by each allocator, which is
+ * enough for a few buffers mapped concurrently downstream */
+#define MAX_STAGING_BUFFERS 4
+
+static guint8 *
+acquire_staging_buffer (GstMfxVideoAllocator * allocator)
+{
+  guint8 *data;
+
+  g_mutex_lock (&allocator->staging_lock);
+  data = g_queue_pop_head (&allocator->staging_buffers);
+  g_mutex_unlock (&allocator->staging_lock);
+
+  if (!data)
+    data = g_slice_alloc (GST_VIDEO_INFO_SIZE (&allocator->image_info));
+  return data;
+}
+
+static void
+release_staging_buffer (GstMfxVideoAllocator * allocator, guint8 * data)
+{
+  g_mutex_lock (&allocator->staging_lock);
+  if (g_queue_get_length (&allocator->staging_buffers) < MAX_STAGING_BUFFERS) {
+    g_queue_push_head (&allocator->staging_buffers, data);
+    data = NULL;
+  }
+  g_mutex_unlock (&allocator->staging_lock);
+
+  if (data)
+    g_slice_free1 (GST_VIDEO_INFO_SIZE (&allocator->image_info), data);
+}
+
 static gboolean
 copy_image (GstMfxVideoMemory * mem)
 {
-  guint i, j, src_stride, dest_stride, height, offset, num_planes, plane_size;
-  guint8 *src_plane = NULL;
+  guint i, offset, num_planes, plane_size;
+  CopyRegion region;
+  CopyFunc stream_copy = NULL;
 
   guint data_size = GST_VIDEO_INFO_SIZE (mem->image_info);
-  mem->data = g_slice_alloc (data_size);
+  mem->data = acquire_staging_buffer (GST_MFX_VIDEO_ALLOCATOR_CAST
+      (GST_MEMORY_CAST (mem)->allocator));
   if (!mem->data)
     return FALSE;
 
+  /* Streaming loads only pay off on uncached device memory mappings */
+  if (gst_mfx_surface_has_video_memory (mem->surface))
+    stream_copy = get_stream_copy_func ();
+  if (stream_copy)
+    copy_stream_fence ();
+  region.func = stream_copy ? stream_copy : copy_memcpy;
+
   num_planes = GST_VIDEO_INFO_N_PLANES (mem->image_info);
 
   for (i = 0; i < num_planes; i++) {
-    src_plane = gst_mfx_surface_get_plane (mem->surface, i);
-    src_stride = gst_mfx_surface_get_pitch (mem->surface, i);
+    region.src = gst_mfx_surface_get_plane (mem->surface, i);
+    region.src_stride = gst_mfx_surface_get_pitch (mem->surface, i);
 
-    dest_stride = GST_VIDEO_INFO_PLANE_STRIDE (mem->image_info, i);
+    region.dst_stride = GST_VIDEO_INFO_PLANE_STRIDE (mem->image_info, i);
     offset = GST_VIDEO_INFO_PLANE_OFFSET (mem->image_info, i);
+    region.dst = mem->data + offset;
 
     if (i != num_planes - 1)
       plane_size =
@@ -51,15 +246,9 @@ copy_image (GstMfxVideoMemory * mem)
     else
       plane_size = data_size - offset;
 
-    if (src_stride != dest_stride) {
-      height = plane_size / dest_stride;
-      for (j = 0; j < height; j++) {
-        memcpy (mem->data + offset, src_plane, dest_stride);
-        src_plane += src_stride;
-        offset += dest_stride;
-      }
-    } else
-      memcpy (mem->data + offset, src_plane, plane_size);
+    region.row_size = region.dst_stride;
+    region.rows = plane_size / region.dst_stride;
+    copy_plane (&region);
   }
 
   mem->new_copy = TRUE;
@@ -67,6 +256,26 @@ copy_image (GstMfxVideoMemory * mem)
   return TRUE;
 }
 
+/* Checks whether the planes of a system memory surface are already laid
+ * out as described by the negotiated video info, in which case no copy is
+ * needed */
+static gboolean
+has_matching_layout (GstMfxVideoMemory * mem)
+{
+  guint8 *const base = gst_mfx_surface_get_plane (mem->surface, 0);
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (mem->image_info); i++) {
+    if (gst_mfx_surface_get_pitch (mem->surface, i) !=
+        GST_VIDEO_INFO_PLANE_STRIDE (mem->image_info, i))
+      return FALSE;
+    if (gst_mfx_surface_get_plane (mem->surface, i) !=
+        base + GST_VIDEO_INFO_PLANE_OFFSET (mem->image_info, i))
+      return FALSE;
+  }
+  return TRUE;
+}
+
 static gboolean
 get_image_data (GstMfxVideoMemory * mem)
 {
@@ -75,8 +284,14 @@ get_image_data (GstMfxVideoMemory * mem)
   guint height = GST_VIDEO_INFO_HEIGHT (mem->image_info);
   guint aligned_height = GST_MFX_SURFACE_HEIGHT (mem->surface);
 
+  /* Mappings of device memory are uncached, so reading them in place
+   * downstream is far slower than the streaming copy */
+  if (gst_mfx_surface_has_video_memory (mem->surface))
+    return copy_image (mem);
+
   if ((width == aligned_width && height == aligned_height && !mem->image) ||
-      GST_VIDEO_INFO_N_PLANES (mem->image_info) == 1) {
+      GST_VIDEO_INFO_N_PLANES (mem->image_info) == 1 ||
+      has_matching_layout (mem)) {
     mem->data = gst_mfx_surface_get_plane (mem->surface, 0);
     mem->new_copy = FALSE;
     return TRUE;
@@ -90,9 +305,15 @@ new_surface (GstMfxVideoMemory * mem)
 {
   GstMfxVideoAllocator *const allocator =
       GST_MFX_VIDEO_ALLOCATOR_CAST (GST_MEMORY_CAST (mem)->allocator);
+  GstMfxSurface *surface;
+
+  surface = gst_mfx_surface_new_from_pool (allocator->surface_pool);
 
-  return
-      gst_mfx_surface_new_from_pool (allocator->surface_pool);
+  /* A bound surface belongs to its memory alone, the pool must not hand
+   * it out again whenever the SDK has unlocked it */
+  if (surface && mem->bound_surface)
+    gst_mfx_surface_pool_detach_surface (allocator->surface_pool, surface);
+  return surface;
 }
 
 static gboolean
@@ -211,6 +432,7 @@ gst_mfx_video_memory_new (GstAllocator * base_allocator, GstMfxVideoMeta * meta)
   mem->meta = meta ? gst_mfx_video_meta_ref (meta) : NULL;
   mem->map_type = 0;
   mem->new_copy = FALSE;
+  mem->bound_surface = FALSE;
 
   return GST_MEMORY_CAST (mem);
 }
@@ -232,6 +454,49 @@ gst_mfx_video_memory_reset_surface (GstMfxVideoMemory * mem)
     gst_mfx_video_meta_set_surface (mem->meta, NULL);
 }
 
+/**
+ * gst_mfx_video_memory_bind_surface:
+ * @mem: a #GstMfxVideoMemory
+ *
+ * Makes sure a surface is attached to @mem and its #GstMfxVideoMeta,
+ * taking a new one from the allocator surface pool if needed. From now
+ * on, the surfaces of @mem are owned by @mem rather than by the pool.
+ *
+ * Returns: %TRUE if @mem has a surface, %FALSE otherwise
+ */
+gboolean
+gst_mfx_video_memory_bind_surface (GstMfxVideoMemory * mem)
+{
+  g_return_val_if_fail (mem != NULL, FALSE);
+  g_return_val_if_fail (mem->meta != NULL, FALSE);
+
+  mem->bound_surface = TRUE;
+  return ensure_surface (mem);
+}
+
+/**
+ * gst_mfx_video_memory_is_surface_busy:
+ * @mem: a #GstMfxVideoMemory
+ *
+ * Checks whether the surface attached to @mem is still locked by an
+ * MFX session, in which case it can't be written to yet.
+ *
+ * Returns: %TRUE if the surface is in use by the SDK
+ */
+gboolean
+gst_mfx_video_memory_is_surface_busy (GstMfxVideoMemory * mem)
+{
+  GstMfxSurface *surface;
+
+  g_return_val_if_fail (mem != NULL, FALSE);
+
+  surface = mem->meta ? gst_mfx_video_meta_get_surface (mem->meta) : NULL;
+  if (!surface)
+    return FALSE;
+
+  return gst_mfx_surface_get_frame_surface (surface)->Data.Locked > 0;
+}
+
 static gpointer
 gst_mfx_video_memory_map (GstMfxVideoMemory * mem, gsize maxsize, guint flags)
 {
@@ -290,6 +555,7 @@ error_no_surface:
   return NULL;
 error_no_image:
   GST_ERROR ("failed to extract image data from video buffer");
+  gst_mfx_surface_unmap (mem->surface);
   return NULL;
 error_map_surface:
   GST_ERROR ("failed to map surface");
@@ -305,7 +571,8 @@ gst_mfx_video_memory_unmap (GstMfxVideoMemory * mem)
       break;
     case GST_MFX_SYSTEM_MEMORY_MAP_TYPE_LINEAR:
       if (mem->data && mem->new_copy)
-        g_slice_free1(GST_VIDEO_INFO_SIZE(mem->image_info), mem->data);
+        release_staging_buffer (GST_MFX_VIDEO_ALLOCATOR_CAST
+            (GST_MEMORY_CAST (mem)->allocator), mem->data);
       gst_mfx_surface_unmap(mem->surface);
       mem->data = NULL;
       break;
@@ -405,9 +672,14 @@ static void
 gst_mfx_video_allocator_finalize (GObject * object)
 {
   GstMfxVideoAllocator *const allocator = GST_MFX_VIDEO_ALLOCATOR_CAST (object);
+  guint8 *data;
 
   gst_mfx_surface_pool_replace (&allocator->surface_pool, NULL);
 
+  while ((data = g_queue_pop_head (&allocator->staging_buffers)))
+    g_slice_free1 (GST_VIDEO_INFO_SIZE (&allocator->image_info), data);
+  g_mutex_clear (&allocator->staging_lock);
+
   G_OBJECT_CLASS (gst_mfx_video_allocator_parent_class)->finalize (object);
 }
 
@@ -430,6 +702,9 @@ gst_mfx_video_allocator_init (GstMfxVideoAllocator * allocator)
 {
   GstAllocator *const base_allocator = GST_ALLOCATOR_CAST (allocator);
 
+  g_mutex_init (&allocator->staging_lock);
+  g_queue_init (&allocator->staging_buffers);
+
   base_allocator->mem_type = GST_MFX_VIDEO_MEMORY_NAME;
   base_allocator->mem_map = (GstMemoryMapFunction)
       gst_mfx_video_memory_map;
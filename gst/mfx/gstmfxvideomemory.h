@@ -98,6 +98,7 @@ struct _GstMfxVideoMemory
   guint                map_type;
   guint8              *data;
   gboolean             new_copy;
+  gboolean             bound_surface;
 };
 
 GstMemory *
@@ -114,6 +115,12 @@ gst_video_meta_unmap_mfx_surface (GstVideoMeta * meta, guint plane,
 void
 gst_mfx_video_memory_reset_surface (GstMfxVideoMemory * mem);
 
+gboolean
+gst_mfx_video_memory_bind_surface (GstMfxVideoMemory * mem);
+
+gboolean
+gst_mfx_video_memory_is_surface_busy (GstMfxVideoMemory * mem);
+
 
 /* ------------------------------------------------------------------------ */
 /* --- GstMfxVideoAllocator                                           --- */
@@ -144,6 +151,10 @@ struct _GstMfxVideoAllocator
   /*< private >*/
   GstVideoInfo         image_info;
   GstMfxSurfacePool   *surface_pool;
+
+  /* Staging buffers for system memory readback */
+  GMutex               staging_lock;
+  GQueue               staging_buffers;
 };
 
 /**
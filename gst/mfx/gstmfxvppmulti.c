@@ -0,0 +1,1110 @@
+/*
+ *  Copyright (C) 2016 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+/**
+ * SECTION:element-mfxvppmulti
+ *
+ * mfxvppmulti scales and converts its input to any number of outputs in a
+ * single pass, e.g. to feed the renditions of an adaptive streaming ladder.
+ * Each request src pad is served by its own VPP session, joined with the
+ * others, and all of them read the same input surface. With the cascade
+ * property, each output is downscaled from the next larger output instead.
+ *
+ * |[
+ * gst-launch-1.0 filesrc location=in.mp4 ! qtdemux ! h264parse ! mfxdecode !
+ *     mfxvppmulti name=vpp cascade=true
+ *     vpp.src_0 ! mfxh264enc bitrate=6000 ! mp4mux ! filesink location=720p.mp4
+ *     vpp.src_1 ! mfxh264enc bitrate=2500 ! mp4mux ! filesink location=480p.mp4
+ *     vpp.src_2 ! mfxh264enc bitrate=1000 ! mp4mux ! filesink location=360p.mp4
+ * ]| with the height of the src pads set to 720, 480 and 360.
+ */
+
+#include "gst-libs/mfx/sysdeps.h"
+#include <gst/video/video.h>
+
+#include "gstmfxvppmulti.h"
+#include "gstmfxpluginutil.h"
+#include "gstmfxvideobufferpool.h"
+#include "gstmfxvideomemory.h"
+
+#define GST_PLUGIN_NAME "mfxvppmulti"
+#define GST_PLUGIN_DESC "A multi-output video postprocessing filter"
+
+GST_DEBUG_CATEGORY_STATIC (gst_debug_mfxvppmulti);
+#define GST_CAT_DEFAULT gst_debug_mfxvppmulti
+
+/* Default templates */
+static const char gst_mfxvppmulti_sink_caps_str[] =
+    GST_MFX_MAKE_SURFACE_CAPS "; "
+    GST_VIDEO_CAPS_MAKE (GST_MFX_SUPPORTED_INPUT_FORMATS);
+
+static const char gst_mfxvppmulti_src_caps_str[] =
+    GST_MFX_MAKE_SURFACE_CAPS "; "
+    GST_VIDEO_CAPS_MAKE ("{ NV12, BGRA }");
+
+static GstStaticPadTemplate gst_mfxvppmulti_sink_factory =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (gst_mfxvppmulti_sink_caps_str));
+
+static GstStaticPadTemplate gst_mfxvppmulti_src_factory =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (gst_mfxvppmulti_src_caps_str));
+
+G_DEFINE_TYPE (GstMfxVppMultiPad, gst_mfxvppmulti_pad, GST_TYPE_PAD);
+
+G_DEFINE_TYPE_WITH_CODE (GstMfxVppMulti,
+    gst_mfxvppmulti,
+    GST_TYPE_ELEMENT,
+    GST_MFX_PLUGIN_BASE_INIT_INTERFACES);
+
+enum
+{
+  PROP_PAD_0,
+
+  PROP_PAD_WIDTH,
+  PROP_PAD_HEIGHT,
+  PROP_PAD_FORMAT,
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_ASYNC_DEPTH,
+  PROP_CASCADE,
+};
+
+#define DEFAULT_ASYNC_DEPTH             0
+#define DEFAULT_CASCADE                 FALSE
+#define DEFAULT_PAD_FORMAT              GST_VIDEO_FORMAT_UNKNOWN
+
+/* ------------------------------------------------------------------------ */
+/* --- Output pads                                                      --- */
+/* ------------------------------------------------------------------------ */
+
+static void
+gst_mfxvppmulti_pad_reset (GstMfxVppMultiPad * pad)
+{
+  gst_mfx_filter_replace (&pad->filter, NULL);
+  if (pad->pool) {
+    gst_buffer_pool_set_active (pad->pool, FALSE);
+    g_clear_object (&pad->pool);
+  }
+  gst_caps_replace (&pad->caps, NULL);
+  gst_object_replace ((GstObject **) & pad->source, NULL);
+  gst_video_info_init (&pad->info);
+  g_queue_foreach (&pad->outbufs, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&pad->outbufs);
+}
+
+static void
+gst_mfxvppmulti_pad_finalize (GObject * object)
+{
+  GstMfxVppMultiPad *const pad = GST_MFXVPPMULTI_PAD (object);
+
+  gst_mfxvppmulti_pad_reset (pad);
+
+  G_OBJECT_CLASS (gst_mfxvppmulti_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_mfxvppmulti_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMfxVppMultiPad *const pad = GST_MFXVPPMULTI_PAD (object);
+  GstObject *parent;
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_WIDTH:
+      pad->width = g_value_get_uint (value);
+      break;
+    case PROP_PAD_HEIGHT:
+      pad->height = g_value_get_uint (value);
+      break;
+    case PROP_PAD_FORMAT:
+      pad->format = g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  pad->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (pad);
+
+  /* Renegotiate the output at the next frame */
+  parent = gst_object_get_parent (GST_OBJECT (pad));
+  if (parent) {
+    GST_OBJECT_LOCK (parent);
+    GST_MFXVPPMULTI (parent)->need_configure = TRUE;
+    GST_OBJECT_UNLOCK (parent);
+    gst_object_unref (parent);
+  }
+}
+
+static void
+gst_mfxvppmulti_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstMfxVppMultiPad *const pad = GST_MFXVPPMULTI_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_WIDTH:
+      g_value_set_uint (value, pad->width);
+      break;
+    case PROP_PAD_HEIGHT:
+      g_value_set_uint (value, pad->height);
+      break;
+    case PROP_PAD_FORMAT:
+      g_value_set_enum (value, pad->format);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_mfxvppmulti_pad_class_init (GstMfxVppMultiPadClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gst_mfxvppmulti_pad_finalize;
+  object_class->set_property = gst_mfxvppmulti_pad_set_property;
+  object_class->get_property = gst_mfxvppmulti_pad_get_property;
+
+  /**
+   * GstMfxVppMultiPad:width
+   *
+   * The output width in pixels. If set to zero, the width is calculated
+   * from the height to preserve the aspect ratio, or inherited from the
+   * sink caps width.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_WIDTH,
+      g_param_spec_uint ("width",
+          "Width",
+          "Output width",
+          0, 8192, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxVppMultiPad:height
+   *
+   * The output height in pixels. If set to zero, the height is calculated
+   * from the width to preserve the aspect ratio, or inherited from the
+   * sink caps height.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_HEIGHT,
+      g_param_spec_uint ("height",
+          "Height",
+          "Output height",
+          0, 8192, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxVppMultiPad:format
+   *
+   * The output video format, or the one preferred by downstream if unset.
+   */
+  g_object_class_install_property (object_class,
+      PROP_PAD_FORMAT,
+      g_param_spec_enum ("format",
+          "Format",
+          "The forced output pixel format",
+          GST_TYPE_VIDEO_FORMAT,
+          DEFAULT_PAD_FORMAT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_mfxvppmulti_pad_init (GstMfxVppMultiPad * pad)
+{
+  pad->format = DEFAULT_PAD_FORMAT;
+  gst_video_info_init (&pad->info);
+  g_queue_init (&pad->outbufs);
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Negotiation                                                      --- */
+/* ------------------------------------------------------------------------ */
+
+static void
+find_pad_size (GstMfxVppMulti * vpp, GstMfxVppMultiPad * pad,
+    guint * width_ptr, guint * height_ptr)
+{
+  const guint src_width = GST_VIDEO_INFO_WIDTH (&vpp->sinkpad_info);
+  const guint src_height = GST_VIDEO_INFO_HEIGHT (&vpp->sinkpad_info);
+  guint width, height;
+
+  GST_OBJECT_LOCK (pad);
+  width = pad->width;
+  height = pad->height;
+  GST_OBJECT_UNLOCK (pad);
+
+  if (!width && !height) {
+    width = src_width;
+    height = src_height;
+  } else if (!width)
+    width = gst_util_uint64_scale_int (height, src_width, src_height);
+  else if (!height)
+    height = gst_util_uint64_scale_int (width, src_height, src_width);
+
+  *width_ptr = GST_ROUND_UP_2 (width);
+  *height_ptr = GST_ROUND_UP_2 (height);
+}
+
+static gboolean
+gst_mfxvppmulti_pad_update_caps (GstMfxVppMulti * vpp, GstMfxVppMultiPad * pad)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstVideoFormat out_format = GST_VIDEO_FORMAT_NV12;
+  GstMfxCapsFeature feature;
+  const gchar *feature_str;
+  GstVideoInfo vi;
+  guint width, height;
+
+  feature = gst_mfx_find_preferred_caps_feature (GST_PAD (pad),
+      &out_format, TRUE);
+  if (GST_MFX_CAPS_FEATURE_NOT_NEGOTIATED == feature)
+    return FALSE;
+
+  GST_OBJECT_LOCK (pad);
+  if (pad->format != GST_VIDEO_FORMAT_UNKNOWN)
+    out_format = pad->format;
+  GST_OBJECT_UNLOCK (pad);
+
+  if (out_format != GST_VIDEO_FORMAT_NV12
+      && out_format != GST_VIDEO_FORMAT_BGRA)
+    out_format = GST_VIDEO_FORMAT_NV12;
+
+  find_pad_size (vpp, pad, &width, &height);
+
+  vi = vpp->sinkpad_info;
+  gst_video_info_change_format (&vi, out_format, width, height);
+
+  gst_caps_replace (&pad->caps, NULL);
+  pad->caps = gst_video_info_to_caps (&vi);
+  if (!pad->caps)
+    return FALSE;
+
+  feature_str = gst_mfx_caps_feature_to_string (feature);
+  if (feature_str)
+    gst_caps_set_features (pad->caps, 0,
+        gst_caps_features_new (feature_str, NULL));
+
+  pad->info = vi;
+
+  /* Video memory input is processed into video memory output, as in
+   * mfxvpp, and read back by the video memory map if needed */
+  pad->is_system_out = plugin->sinkpad_caps_is_raw &&
+      feature != GST_MFX_CAPS_FEATURE_MFX_SURFACE;
+
+  GST_INFO_OBJECT (pad, "new src caps = %" GST_PTR_FORMAT, pad->caps);
+  return TRUE;
+}
+
+static gboolean
+gst_mfxvppmulti_pad_decide_allocation (GstMfxVppMulti * vpp,
+    GstMfxVppMultiPad * pad)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstQuery *query;
+  guint min = 0, max = 0;
+  gboolean has_video_meta;
+
+  /* The query is serialized, so downstream elements configured themselves
+   * from the caps of this output before it returns */
+  query = gst_query_new_allocation (pad->caps, TRUE);
+  if (!gst_pad_peer_query (GST_PAD (pad), query))
+    GST_DEBUG_OBJECT (pad, "peer ALLOCATION query failed");
+
+  has_video_meta = gst_query_find_allocation_meta (query,
+      GST_VIDEO_META_API_TYPE, NULL);
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, NULL, &min, &max);
+  gst_query_unref (query);
+
+  pool = gst_mfx_video_buffer_pool_new (plugin->aggregator,
+      pad->is_system_out);
+  if (!pool)
+    goto error_create_pool;
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, pad->caps,
+      GST_VIDEO_INFO_SIZE (&pad->info), min, max);
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_MFX_VIDEO_META);
+  if (has_video_meta)
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (!gst_buffer_pool_set_config (pool, config))
+    goto error_pool_config;
+
+  if (!gst_buffer_pool_set_active (pool, TRUE))
+    goto error_activate_pool;
+
+  pad->pool = pool;
+  return TRUE;
+  /* ERRORS */
+error_create_pool:
+  {
+    GST_ERROR_OBJECT (pad, "failed to create buffer pool");
+    return FALSE;
+  }
+error_pool_config:
+  {
+    GST_ERROR_OBJECT (pad, "failed to configure buffer pool");
+    gst_object_unref (pool);
+    return FALSE;
+  }
+error_activate_pool:
+  {
+    GST_ERROR_OBJECT (pad, "failed to activate buffer pool");
+    gst_object_unref (pool);
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_mfxvppmulti_pad_create (GstMfxVppMulti * vpp, GstMfxVppMultiPad * pad)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  const GstVideoInfo *in_info = pad->source ?
+      &pad->source->info : &vpp->sinkpad_info;
+
+  pad->filter = gst_mfx_filter_new (plugin->aggregator,
+      pad->source ? FALSE : plugin->sinkpad_caps_is_raw, pad->is_system_out);
+  if (!pad->filter)
+    goto error_create_filter;
+
+  gst_mfx_filter_set_frame_info_from_gst_video_info (pad->filter, in_info);
+
+  if (vpp->async_depth)
+    gst_mfx_filter_set_async_depth (pad->filter, vpp->async_depth);
+
+  gst_mfx_filter_set_size (pad->filter,
+      GST_VIDEO_INFO_WIDTH (&pad->info), GST_VIDEO_INFO_HEIGHT (&pad->info));
+
+  if (GST_VIDEO_INFO_FORMAT (in_info) != GST_VIDEO_INFO_FORMAT (&pad->info))
+    gst_mfx_filter_set_format (pad->filter,
+        gst_video_format_to_mfx_fourcc (GST_VIDEO_INFO_FORMAT (&pad->info)));
+
+  if (!gst_mfx_filter_prepare (pad->filter))
+    goto error_create_filter;
+
+  /* The new filter task is the current task of the aggregator until the
+   * downstream elements of this output are configured */
+  if (!gst_pad_push_event (GST_PAD (pad), gst_event_new_caps (pad->caps)))
+    goto error_push_caps;
+
+  return gst_mfxvppmulti_pad_decide_allocation (vpp, pad);
+  /* ERRORS */
+error_create_filter:
+  {
+    GST_ERROR_OBJECT (pad, "failed to create VPP filter");
+    return FALSE;
+  }
+error_push_caps:
+  {
+    GST_WARNING_OBJECT (pad, "failed to push caps %" GST_PTR_FORMAT,
+        pad->caps);
+    return FALSE;
+  }
+}
+
+/* Larger outputs first, so that cascaded outputs follow their source */
+static gint
+compare_pad_size (gconstpointer a, gconstpointer b)
+{
+  const GstVideoInfo *const info_a = &GST_MFXVPPMULTI_PAD (a)->info;
+  const GstVideoInfo *const info_b = &GST_MFXVPPMULTI_PAD (b)->info;
+  const guint64 area_a = (guint64) GST_VIDEO_INFO_WIDTH (info_a) *
+      GST_VIDEO_INFO_HEIGHT (info_a);
+  const guint64 area_b = (guint64) GST_VIDEO_INFO_WIDTH (info_b) *
+      GST_VIDEO_INFO_HEIGHT (info_b);
+
+  return area_a < area_b ? 1 : (area_a > area_b ? -1 : 0);
+}
+
+/* Finds the smallest configured output that can be downscaled to @pad */
+static GstMfxVppMultiPad *
+find_cascade_source (GList * pads, GstMfxVppMultiPad * pad)
+{
+  GstMfxVppMultiPad *source = NULL, *candidate;
+  GList *l;
+
+  for (l = pads; l && l->data != pad; l = l->next) {
+    candidate = l->data;
+    if (!candidate->filter || candidate->is_system_out
+        || GST_VIDEO_INFO_FORMAT (&candidate->info) != GST_VIDEO_FORMAT_NV12)
+      continue;
+    if (GST_VIDEO_INFO_WIDTH (&candidate->info) <
+        GST_VIDEO_INFO_WIDTH (&pad->info)
+        || GST_VIDEO_INFO_HEIGHT (&candidate->info) <
+        GST_VIDEO_INFO_HEIGHT (&pad->info))
+      continue;
+    source = candidate;
+  }
+  return source;
+}
+
+/* Configures the outputs flagged for negotiation and returns the list of
+ * outputs sorted in processing order */
+static GList *
+gst_mfxvppmulti_configure (GstMfxVppMulti * vpp, GList * pads)
+{
+  GstMfxVppMultiPad *pad;
+  GList *l;
+
+  for (l = pads; l; l = l->next) {
+    pad = l->data;
+
+    GST_OBJECT_LOCK (pad);
+    /* A cascaded output depends on the size of all the others */
+    if (vpp->cascade)
+      pad->need_configure = TRUE;
+    if (!pad->filter && gst_pad_is_linked (GST_PAD (pad)))
+      pad->need_configure = TRUE;
+    GST_OBJECT_UNLOCK (pad);
+
+    if (!pad->need_configure)
+      continue;
+
+    gst_mfxvppmulti_pad_reset (pad);
+    if (!gst_mfxvppmulti_pad_update_caps (vpp, pad))
+      GST_DEBUG_OBJECT (pad, "output is not linked");
+  }
+
+  pads = g_list_sort (pads, compare_pad_size);
+
+  for (l = pads; l; l = l->next) {
+    pad = l->data;
+
+    if (!pad->need_configure || !pad->caps)
+      continue;
+    pad->need_configure = FALSE;
+
+    if (vpp->cascade) {
+      GstMfxVppMultiPad *const source = find_cascade_source (pads, pad);
+      if (source)
+        pad->source = gst_object_ref (source);
+    }
+
+    if (!gst_mfxvppmulti_pad_create (vpp, pad))
+      gst_mfxvppmulti_pad_reset (pad);
+  }
+  return pads;
+}
+
+/* Returns the outputs in processing order, configured if needed */
+static GList *
+gst_mfxvppmulti_get_srcpads (GstMfxVppMulti * vpp)
+{
+  gboolean need_configure;
+  GList *pads;
+
+  GST_OBJECT_LOCK (vpp);
+  pads = g_list_copy_deep (vpp->srcpads, (GCopyFunc) gst_object_ref, NULL);
+  need_configure = vpp->need_configure;
+  vpp->need_configure = FALSE;
+  GST_OBJECT_UNLOCK (vpp);
+
+  if (need_configure)
+    return gst_mfxvppmulti_configure (vpp, pads);
+  return g_list_sort (pads, compare_pad_size);
+}
+
+static gboolean
+gst_mfxvppmulti_set_sink_caps (GstMfxVppMulti * vpp, GstCaps * caps)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstMfxTask *task;
+  GList *pads, *l;
+
+  GST_INFO_OBJECT (vpp, "new sink caps = %" GST_PTR_FORMAT, caps);
+
+  if (!gst_video_info_from_caps (&vpp->sinkpad_info, caps))
+    return FALSE;
+
+  if (!gst_mfx_plugin_base_set_caps (plugin, caps, NULL))
+    return FALSE;
+
+  /* Follow the memory type of an upstream MFX task, as in mfxvpp */
+  if (!plugin->sinkpad_has_dmabuf && !plugin->sinkpad_caps_is_raw) {
+    task = gst_mfx_task_aggregator_get_current_task (plugin->aggregator);
+    if (task) {
+      plugin->sinkpad_caps_is_raw = !gst_mfx_task_has_video_memory (task);
+      gst_mfx_task_unref (task);
+    }
+  }
+
+  GST_OBJECT_LOCK (vpp);
+  for (l = vpp->srcpads; l; l = l->next) {
+    GST_OBJECT_LOCK (l->data);
+    GST_MFXVPPMULTI_PAD (l->data)->need_configure = TRUE;
+    GST_OBJECT_UNLOCK (l->data);
+  }
+  vpp->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (vpp);
+
+  /* Negotiate the outputs right away, ahead of the first buffer */
+  pads = gst_mfxvppmulti_get_srcpads (vpp);
+  g_list_free_full (pads, gst_object_unref);
+  return TRUE;
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Data flow                                                        --- */
+/* ------------------------------------------------------------------------ */
+
+/* Queues all the outputs of @surface on @pad. A single input may give
+ * several outputs, e.g. with frame rate conversion, in which case they
+ * are spread over the input duration at the output frame rate */
+static GstFlowReturn
+gst_mfxvppmulti_process (GstMfxVppMulti * vpp, GstMfxVppMultiPad * pad,
+    GstMfxSurface * surface, GstBuffer * inbuf)
+{
+  GstMfxFilterStatus status;
+  GstMfxSurface *out_surface = NULL;
+  GstMfxVideoMeta *meta;
+  GstMfxRectangle *crop_rect;
+  GstBuffer *outbuf = NULL;
+  GstClockTime timestamp = GST_BUFFER_TIMESTAMP (inbuf);
+  GstClockTime duration = GST_BUFFER_DURATION (inbuf);
+  GstFlowReturn ret;
+  guint n = 0;
+
+  if (GST_VIDEO_INFO_FPS_N (&pad->info) > 0)
+    duration = gst_util_uint64_scale (GST_SECOND,
+        GST_VIDEO_INFO_FPS_D (&pad->info), GST_VIDEO_INFO_FPS_N (&pad->info));
+
+  do {
+    status = gst_mfx_filter_process (pad->filter, surface, &out_surface);
+    if (GST_MFX_FILTER_STATUS_ERROR_MORE_DATA == status)
+      return GST_FLOW_OK;
+    if (GST_MFX_FILTER_STATUS_SUCCESS != status
+        && GST_MFX_FILTER_STATUS_ERROR_MORE_SURFACE != status)
+      goto error_process_vpp;
+
+    ret = gst_buffer_pool_acquire_buffer (pad->pool, &outbuf, NULL);
+    if (GST_FLOW_OK != ret)
+      return ret;
+
+    meta = gst_buffer_get_mfx_video_meta (outbuf);
+    if (!meta)
+      goto error_create_meta;
+    gst_mfx_video_meta_set_surface (meta, out_surface);
+
+    crop_rect = gst_mfx_surface_get_crop_rect (out_surface);
+    if (crop_rect) {
+      GstVideoCropMeta *const crop_meta =
+          gst_buffer_add_video_crop_meta (outbuf);
+      if (crop_meta) {
+        crop_meta->x = crop_rect->x;
+        crop_meta->y = crop_rect->y;
+        crop_meta->width = crop_rect->width;
+        crop_meta->height = crop_rect->height;
+      }
+    }
+
+    if (GST_MFX_FILTER_STATUS_ERROR_MORE_SURFACE == status || n > 0) {
+      GST_BUFFER_TIMESTAMP (outbuf) = GST_CLOCK_TIME_IS_VALID (timestamp)
+          && GST_CLOCK_TIME_IS_VALID (duration) ?
+          timestamp + n * duration : timestamp;
+      GST_BUFFER_DURATION (outbuf) = duration;
+    }
+    else {
+      gst_buffer_copy_into (outbuf, inbuf, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    }
+
+    g_queue_push_tail (&pad->outbufs, outbuf);
+    n++;
+  } while (GST_MFX_FILTER_STATUS_ERROR_MORE_SURFACE == status);
+
+  return GST_FLOW_OK;
+  /* ERRORS */
+error_process_vpp:
+  {
+    GST_ERROR_OBJECT (pad, "failed to apply VPP (error %d)", status);
+    return GST_FLOW_ERROR;
+  }
+error_create_meta:
+  {
+    GST_ERROR_OBJECT (pad, "failed to create new output buffer meta");
+    gst_buffer_unref (outbuf);
+    return GST_FLOW_ERROR;
+  }
+}
+
+static GstFlowReturn
+gst_mfxvppmulti_chain (GstPad * sinkpad, GstObject * parent,
+    GstBuffer * inbuf)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (parent);
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstMfxVppMultiPad *pad;
+  GstMfxVideoMeta *meta;
+  GstMfxSurface *surface, *in_surface;
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret, pad_ret;
+  GList *pads, *l;
+
+  ret = gst_mfx_plugin_base_get_input_buffer (plugin, inbuf, &buf);
+  if (GST_FLOW_OK != ret)
+    goto done;
+
+  meta = gst_buffer_get_mfx_video_meta (buf);
+  surface = meta ? gst_mfx_video_meta_get_surface (meta) : NULL;
+  if (!surface)
+    goto error_no_surface;
+
+  pads = gst_mfxvppmulti_get_srcpads (vpp);
+
+  /* Run all the outputs before pushing any of them, so that cascaded
+   * outputs read their source surfaces while they are still referenced */
+  for (l = pads; l && GST_FLOW_OK == ret; l = l->next) {
+    GstMfxVppMultiPad *source;
+    GList *b;
+
+    pad = l->data;
+    if (!pad->filter)
+      continue;
+
+    source = pad->source;
+    if (!source) {
+      ret = gst_mfxvppmulti_process (vpp, pad, surface, inbuf);
+      continue;
+    }
+
+    /* A cascaded output is produced from every output of its source */
+    for (b = source->outbufs.head; b && GST_FLOW_OK == ret; b = b->next) {
+      meta = gst_buffer_get_mfx_video_meta (b->data);
+      in_surface = meta ? gst_mfx_video_meta_get_surface (meta) : NULL;
+      if (in_surface)
+        ret = gst_mfxvppmulti_process (vpp, pad, in_surface, b->data);
+    }
+  }
+
+  for (l = pads; l; l = l->next) {
+    GstBuffer *outbuf;
+
+    pad = l->data;
+    if (!pad->filter)
+      pad_ret = GST_FLOW_NOT_LINKED;
+    else if (!g_queue_is_empty (&pad->outbufs)) {
+      pad_ret = GST_FLOW_OK;
+      while ((outbuf = g_queue_pop_head (&pad->outbufs))) {
+        if (GST_FLOW_OK == pad_ret)
+          pad_ret = gst_pad_push (GST_PAD (pad), outbuf);
+        else
+          gst_buffer_unref (outbuf);
+      }
+    }
+    else
+      continue;
+
+    GST_OBJECT_LOCK (vpp);
+    pad_ret = gst_flow_combiner_update_pad_flow (vpp->flow_combiner,
+        GST_PAD (pad), pad_ret);
+    GST_OBJECT_UNLOCK (vpp);
+    if (GST_FLOW_OK == ret)
+      ret = pad_ret;
+  }
+  g_list_free_full (pads, gst_object_unref);
+
+  gst_mfx_surface_dequeue (surface);
+
+done:
+  gst_buffer_replace (&buf, NULL);
+  gst_buffer_unref (inbuf);
+  return ret;
+  /* ERRORS */
+error_no_surface:
+  {
+    GST_ERROR_OBJECT (vpp, "failed to get surface from buffer");
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+}
+
+static gboolean
+gst_mfxvppmulti_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:{
+      GstCaps *caps;
+
+      /* Each output negotiates caps of its own */
+      gst_event_parse_caps (event, &caps);
+      ret = gst_mfxvppmulti_set_sink_caps (vpp, caps);
+      gst_event_unref (event);
+      return ret;
+    }
+    case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK (vpp);
+      gst_flow_combiner_reset (vpp->flow_combiner);
+      GST_OBJECT_UNLOCK (vpp);
+      break;
+    default:
+      break;
+  }
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_mfxvppmulti_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_mfx_handle_context_query (query, plugin->aggregator))
+        return TRUE;
+      break;
+    case GST_QUERY_ALLOCATION:
+      return gst_mfx_plugin_base_propose_allocation (plugin, query);
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_pad_template_caps (pad);
+      if (filter) {
+        GstCaps *const out_caps =
+            gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = out_caps;
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    default:
+      break;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+gst_mfxvppmulti_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+      if (gst_mfx_handle_context_query (query, plugin->aggregator))
+        return TRUE;
+      break;
+    case GST_QUERY_CAPS:{
+      GstCaps *filter, *caps;
+
+      gst_query_parse_caps (query, &filter);
+      caps = gst_pad_get_current_caps (pad);
+      if (!caps)
+        caps = gst_pad_get_pad_template_caps (pad);
+      if (filter) {
+        GstCaps *const out_caps =
+            gst_caps_intersect_full (filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref (caps);
+        caps = out_caps;
+      }
+      gst_query_set_caps_result (query, caps);
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+    default:
+      break;
+  }
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/* ------------------------------------------------------------------------ */
+/* --- Element                                                          --- */
+/* ------------------------------------------------------------------------ */
+
+static gboolean
+copy_sticky_event (GstPad * pad, GstEvent ** event, gpointer user_data)
+{
+  GstPad *const srcpad = GST_PAD (user_data);
+
+  /* Caps are negotiated per output */
+  if (GST_EVENT_TYPE (*event) != GST_EVENT_CAPS)
+    gst_pad_store_sticky_event (srcpad, *event);
+  return TRUE;
+}
+
+static GstPad *
+gst_mfxvppmulti_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (element);
+  GstMfxPluginBase *const plugin = GST_MFX_PLUGIN_BASE (vpp);
+  GstPad *pad;
+  gchar *pad_name;
+  guint id;
+
+  GST_OBJECT_LOCK (vpp);
+  if (name && sscanf (name, "src_%u", &id) == 1) {
+    vpp->next_pad_id = MAX (vpp->next_pad_id, id + 1);
+    pad_name = g_strdup (name);
+  } else
+    pad_name = g_strdup_printf ("src_%u", vpp->next_pad_id++);
+  GST_OBJECT_UNLOCK (vpp);
+
+  pad = g_object_new (GST_TYPE_MFXVPPMULTI_PAD, "name", pad_name,
+      "direction", templ->direction, "template", templ, NULL);
+  g_free (pad_name);
+
+  gst_pad_set_query_function (pad,
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_src_query));
+
+  if (!gst_element_add_pad (element, pad)) {
+    gst_object_unref (pad);
+    return NULL;
+  }
+
+  /* Outputs requested while streaming start with the current stream */
+  gst_pad_sticky_events_foreach (plugin->sinkpad, copy_sticky_event, pad);
+
+  GST_OBJECT_LOCK (vpp);
+  GST_MFXVPPMULTI_PAD (pad)->need_configure = TRUE;
+  vpp->srcpads = g_list_append (vpp->srcpads, pad);
+  gst_flow_combiner_add_pad (vpp->flow_combiner, pad);
+  vpp->need_configure = TRUE;
+  GST_OBJECT_UNLOCK (vpp);
+
+  return pad;
+}
+
+static void
+gst_mfxvppmulti_release_pad (GstElement * element, GstPad * pad)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (element);
+
+  GstMfxVppMultiPad *const mpad = GST_MFXVPPMULTI_PAD (pad);
+  GList *l;
+
+  GST_OBJECT_LOCK (vpp);
+  vpp->srcpads = g_list_remove (vpp->srcpads, pad);
+  gst_flow_combiner_remove_pad (vpp->flow_combiner, pad);
+  /* Cascaded outputs may have used this one as source. The element still
+   * holds the pad here, so dropping their references can't finalize it */
+  for (l = vpp->srcpads; l; l = l->next) {
+    GstMfxVppMultiPad *const other = l->data;
+
+    if (other->source == mpad) {
+      gst_object_replace ((GstObject **) & other->source, NULL);
+      other->need_configure = TRUE;
+      vpp->need_configure = TRUE;
+    }
+  }
+  GST_OBJECT_UNLOCK (vpp);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+static void
+gst_mfxvppmulti_reset (GstMfxVppMulti * vpp)
+{
+  GList *pads, *l;
+
+  GST_OBJECT_LOCK (vpp);
+  pads = g_list_copy_deep (vpp->srcpads, (GCopyFunc) gst_object_ref, NULL);
+  for (l = pads; l; l = l->next)
+    GST_MFXVPPMULTI_PAD (l->data)->need_configure = TRUE;
+  vpp->need_configure = TRUE;
+  gst_flow_combiner_reset (vpp->flow_combiner);
+  GST_OBJECT_UNLOCK (vpp);
+
+  /* Deactivating the output pools may block, so not under the lock */
+  for (l = pads; l; l = l->next)
+    gst_mfxvppmulti_pad_reset (l->data);
+  g_list_free_full (pads, gst_object_unref);
+
+  gst_video_info_init (&vpp->sinkpad_info);
+}
+
+static GstStateChangeReturn
+gst_mfxvppmulti_change_state (GstElement * element, GstStateChange transition)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (gst_mfxvppmulti_parent_class)->change_state
+      (element, transition);
+  if (GST_STATE_CHANGE_FAILURE == ret)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_mfxvppmulti_reset (vpp);
+      gst_mfx_plugin_base_close (GST_MFX_PLUGIN_BASE (vpp));
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+static void
+gst_mfxvppmulti_finalize (GObject * object)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (object);
+
+  g_list_free (vpp->srcpads);
+  gst_flow_combiner_free (vpp->flow_combiner);
+  gst_mfx_plugin_base_finalize (GST_MFX_PLUGIN_BASE (vpp));
+  G_OBJECT_CLASS (gst_mfxvppmulti_parent_class)->finalize (object);
+}
+
+static void
+gst_mfxvppmulti_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (object);
+
+  GST_OBJECT_LOCK (vpp);
+  switch (prop_id) {
+    case PROP_ASYNC_DEPTH:
+      vpp->async_depth = g_value_get_uint (value);
+      break;
+    case PROP_CASCADE:
+      vpp->cascade = g_value_get_boolean (value);
+      vpp->need_configure = TRUE;
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static void
+gst_mfxvppmulti_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec)
+{
+  GstMfxVppMulti *const vpp = GST_MFXVPPMULTI (object);
+
+  GST_OBJECT_LOCK (vpp);
+  switch (prop_id) {
+    case PROP_ASYNC_DEPTH:
+      g_value_set_uint (value, vpp->async_depth);
+      break;
+    case PROP_CASCADE:
+      g_value_set_boolean (value, vpp->cascade);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (vpp);
+}
+
+static void
+gst_mfxvppmulti_class_init (GstMfxVppMultiClass * klass)
+{
+  GObjectClass *const object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *const element_class = GST_ELEMENT_CLASS (klass);
+  GstPadTemplate *pad_template;
+
+  GST_DEBUG_CATEGORY_INIT (gst_debug_mfxvppmulti,
+      GST_PLUGIN_NAME, 0, GST_PLUGIN_DESC);
+
+  gst_mfx_plugin_base_class_init (GST_MFX_PLUGIN_BASE_CLASS (klass));
+
+  object_class->finalize = gst_mfxvppmulti_finalize;
+  object_class->set_property = gst_mfxvppmulti_set_property;
+  object_class->get_property = gst_mfxvppmulti_get_property;
+  element_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_change_state);
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_mfxvppmulti_release_pad);
+
+  gst_element_class_set_static_metadata (element_class,
+      "MFX multi-output video postprocessing",
+      "Filter/Converter/Video;Filter/Converter/Video/Scaler",
+      GST_PLUGIN_DESC, "Ishmael Sameen <ishmael.visayana.sameen@intel.com>");
+
+  /* sink pad */
+  pad_template = gst_static_pad_template_get (&gst_mfxvppmulti_sink_factory);
+  gst_element_class_add_pad_template (element_class, pad_template);
+
+  /* src pads */
+  pad_template = gst_static_pad_template_get (&gst_mfxvppmulti_src_factory);
+  gst_element_class_add_pad_template (element_class, pad_template);
+
+  g_object_class_install_property (object_class,
+      PROP_ASYNC_DEPTH,
+      g_param_spec_uint ("async-depth", "Asynchronous Depth",
+          "Number of async operations before explicit sync",
+          0, 20, DEFAULT_ASYNC_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMfxVppMulti:cascade
+   *
+   * Downscale each output from the next larger NV12 output in video
+   * memory instead of the input, which lowers the memory bandwidth of
+   * deep ladders at the cost of some quality.
+   */
+  g_object_class_install_property (object_class,
+      PROP_CASCADE,
+      g_param_spec_boolean ("cascade", "Cascade",
+          "Scale each output from the next larger output",
+          DEFAULT_CASCADE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_mfxvppmulti_init (GstMfxVppMulti * vpp)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new_from_static_template (&gst_mfxvppmulti_sink_factory,
+      "sink");
+  gst_pad_set_chain_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_chain));
+  gst_pad_set_event_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_sink_event));
+  gst_pad_set_query_function (sinkpad,
+      GST_DEBUG_FUNCPTR (gst_mfxvppmulti_sink_query));
+  gst_element_add_pad (GST_ELEMENT (vpp), sinkpad);
+
+  gst_mfx_plugin_base_init (GST_MFX_PLUGIN_BASE (vpp), GST_CAT_DEFAULT);
+
+  vpp->async_depth = DEFAULT_ASYNC_DEPTH;
+  vpp->cascade = DEFAULT_CASCADE;
+  vpp->flow_combiner = gst_flow_combiner_new ();
+
+  gst_video_info_init (&vpp->sinkpad_info);
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (C) 2016 Intel Corporation
+ *    Author: Ishmael Visayana Sameen <ishmael.visayana.sameen@intel.com>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301 USA
+ */
+
+#ifndef GST_MFXVPPMULTI_H
+#define GST_MFXVPPMULTI_H
+
+#include "gstmfxpluginbase.h"
+
+#include <gst/base/gstflowcombiner.h>
+#include <gst-libs/mfx/gstmfxsurface.h>
+#include <gst-libs/mfx/gstmfxfilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MFXVPPMULTI \
+  (gst_mfxvppmulti_get_type ())
+#define GST_MFXVPPMULTI(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_MFXVPPMULTI, GstMfxVppMulti))
+#define GST_MFXVPPMULTI_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), GST_TYPE_MFXVPPMULTI, \
+  GstMfxVppMultiClass))
+#define GST_IS_MFXVPPMULTI(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_MFXVPPMULTI))
+#define GST_IS_MFXVPPMULTI_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_MFXVPPMULTI))
+
+#define GST_TYPE_MFXVPPMULTI_PAD \
+  (gst_mfxvppmulti_pad_get_type ())
+#define GST_MFXVPPMULTI_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_MFXVPPMULTI_PAD, \
+  GstMfxVppMultiPad))
+#define GST_IS_MFXVPPMULTI_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_MFXVPPMULTI_PAD))
+
+typedef struct _GstMfxVppMulti GstMfxVppMulti;
+typedef struct _GstMfxVppMultiClass GstMfxVppMultiClass;
+typedef struct _GstMfxVppMultiPad GstMfxVppMultiPad;
+typedef struct _GstMfxVppMultiPadClass GstMfxVppMultiPadClass;
+
+/**
+ * GstMfxVppMultiPad:
+ *
+ * An output of #GstMfxVppMulti, scaled and converted by its own VPP
+ * session joined to the sessions of the other outputs.
+ */
+struct _GstMfxVppMultiPad
+{
+  /*< private >*/
+  GstPad                  parent_instance;
+
+  /* Properties, protected by the object lock */
+  guint                   width;
+  guint                   height;
+  GstVideoFormat          format;
+  gboolean                need_configure;
+
+  /* Streaming thread state */
+  GstMfxFilter           *filter;
+  GstBufferPool          *pool;
+  GstCaps                *caps;
+  GstVideoInfo            info;
+  gboolean                is_system_out;
+  GstMfxVppMultiPad      *source;
+  GQueue                  outbufs;
+};
+
+struct _GstMfxVppMultiPadClass
+{
+  /*< private >*/
+  GstPadClass parent_class;
+};
+
+struct _GstMfxVppMulti
+{
+  /*< private >*/
+  GstMfxPluginBase        parent_instance;
+
+  GstVideoInfo            sinkpad_info;
+  GList                  *srcpads;
+  guint                   next_pad_id;
+  gboolean                need_configure;
+  GstFlowCombiner        *flow_combiner;
+
+  guint                   async_depth;
+  gboolean                cascade;
+};
+
+struct _GstMfxVppMultiClass
+{
+  /*< private >*/
+  GstMfxPluginBaseClass parent_class;
+};
+
+GType
+gst_mfxvppmulti_get_type (void);
+
+GType
+gst_mfxvppmulti_pad_get_type (void);
+
+G_END_DECLS
+
+#endif /* GST_MFXVPPMULTI_H */